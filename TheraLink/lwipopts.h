@@ -21,6 +21,7 @@
 #define MEM_ALIGNMENT               4
 #define MEM_SIZE                    4000
 #define MEMP_NUM_TCP_SEG            32
+#define MEMP_NUM_TCP_PCB            10     // pool HTTP (8, com /events e /ws) + /ppg.bin + folga p/ TIME_WAIT
 #define MEMP_NUM_ARP_QUEUE          10
 #define PBUF_POOL_SIZE              24
 #define LWIP_ARP                    1
@@ -47,7 +48,9 @@
 #define LWIP_UDP                    1
 #define LWIP_DNS                    1
 #define LWIP_TCP_KEEPALIVE          1
-#define LWIP_NETIF_TX_SINGLE_PBUF   1
+// 0: tcp_write() sem TCP_WRITE_FLAG_COPY referencia o buffer (stream /ppg.bin);
+// o driver cyw43 já copia a cadeia de pbufs p/ o barramento
+#define LWIP_NETIF_TX_SINGLE_PBUF   0
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
 
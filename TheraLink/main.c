@@ -14,6 +14,7 @@
 
 #include "src/cor.h"
 #include "src/oximetro.h"
+#include "src/oxi_core1.h"
 #include "src/stats.h"
 #include "src/web_ap.h"
 
@@ -31,6 +32,7 @@
 #define OXI_I2C    i2c0   // MAX3010x
 #define OXI_SDA    0
 #define OXI_SCL    1
+#define OXI_INT    16     // INT do MAX30102 (opcional; sem ele segue por polling)
 
 // Botões BitDog
 #define BUTTON_A   5
@@ -60,6 +62,16 @@ static void i2c_setup(i2c_inst_t *i2c, uint sda, uint scl, uint hz) {
     gpio_pull_up(scl);
 }
 
+// TCS34725 e MAX3010x dividem o i2c0: o core 1 é o dono durante a medição
+#define COL_BUS_WAIT_MS  50
+
+static bool cor_read_shared(float *r, float *g, float *b, float *c) {
+    if (!oxi_core1_bus_acquire(COL_BUS_WAIT_MS)) return false;
+    bool ok = cor_read_rgb_norm(r, g, b, c);
+    oxi_core1_bus_release();
+    return ok;
+}
+
 static void oled_lines(const char *l1, const char *l2, const char *l3, const char *l4) {
     web_display_set_lines(l1, l2, l3, l4);
     if (!oled_ok) return;
@@ -113,12 +125,20 @@ static const char* cor_nome(stat_color_t c) {
 }
 
 static float        bpm_final_buf = NAN;
+static float        spo2_final_buf = NAN;     // só guardado se a qualidade for ok
+static oxi_hrv_t    hrv_final_buf;
+static bool         hrv_final_ok = false;
 static stat_color_t cor_recomendada = STAT_COLOR_VERDE;
 
 // >>> NEW: token da submissão a ser atribuída à cor após validação
 static uint32_t survey_last_token = 0;
 static uint32_t survey_token_to_assign = 0;
 
+// Sessão em curso (vira um registro no log do stats.c ao salvar)
+static uint32_t session_t0 = 0;          // ms do A no menu
+static uint16_t survey_bits_buf = 0;     // respostas usadas na triagem
+static uint8_t  cor_erros = 0;           // pulseiras erradas na validação
+
 int main(void) {
     stdio_init_all();
     sleep_ms(300);
@@ -136,6 +156,10 @@ int main(void) {
     stats_init();
     web_ap_start();
 
+    // Oxímetro (aquisição + BPM) roda no core 1; aqui só comandos e status
+    oxi_core1_launch(OXI_I2C, OXI_SDA, OXI_SCL, OXI_INT);
+    oxi_status_t oxi_st = { .link = OXI_LINK_UNKNOWN, .state = OXI_IDLE, .bpm_final = NAN };
+
     bool cor_ready = false;
     bool oxi_inited = false;
 
@@ -147,6 +171,14 @@ int main(void) {
         bool a_edge = edge_press(!gpio_get(BUTTON_A), &a_prev);
         bool b_edge = edge_press(!gpio_get(BUTTON_B), &b_prev);
         bool joy_btn_edge = joystick_poll().btn_edge;
+        while (oxi_core1_pop(&oxi_st)) { }   // fica com a publicação mais recente
+        // /oxi_config: pedido vai p/ o core 1 (vale no próximo start); a em uso volta p/ a página
+        uint16_t cfg_sr, cfg_pw; uint8_t cfg_avg;
+        if (web_take_oxi_config(&cfg_sr, &cfg_avg, &cfg_pw)) {
+            oxi_config_t cfg = { cfg_sr, cfg_avg, cfg_pw };
+            oxi_core1_configure(&cfg);
+        }
+        web_set_oxi_config(oxi_st.cfg.sample_rate_hz, oxi_st.cfg.avg, oxi_st.cfg.pulse_width_us);
 
         if (st != last_st) {
             switch (st) {
@@ -176,13 +208,16 @@ int main(void) {
         case ST_ASK:
             if (a_edge) {
                 if (!oxi_inited) {
-                    bool ok = false;
-                    for (int tries=0; tries<3 && !ok; tries++) {
-                        i2c_setup(OXI_I2C, OXI_SDA, OXI_SCL, 100000);
-                        ok = oxi_init(OXI_I2C, OXI_SDA, OXI_SCL);
-                        if (!ok) sleep_ms(200);
+                    // core 1 tenta detectar (3 tentativas) e responde em oxi_st.link
+                    oxi_st.link = OXI_LINK_UNKNOWN;
+                    oxi_core1_init();
+                    uint32_t t0 = to_ms_since_boot(get_absolute_time());
+                    while (oxi_st.link == OXI_LINK_UNKNOWN &&
+                           to_ms_since_boot(get_absolute_time()) - t0 < 3000) {
+                        while (oxi_core1_pop(&oxi_st)) { }
+                        sleep_ms(10);
                     }
-                    oxi_inited = ok;
+                    oxi_inited = (oxi_st.link == OXI_LINK_OK);
                 }
                 if (!oxi_inited) {
                     oled_lines("MAX3010x nao encontrado", "Verifique cabos", "Voltando ao menu", "");
@@ -191,9 +226,16 @@ int main(void) {
                     break;
                 }
                 bpm_final_buf = NAN;
+                spo2_final_buf = NAN;
+                hrv_final_ok = false;
+                session_t0 = now_ms;
+                survey_bits_buf = 0;
+                cor_erros = 0;
                 web_set_survey_mode(false);
                 web_survey_reset();
-                oxi_start();
+                oxi_core1_start();
+                oxi_st.state = OXI_WAIT_FINGER;
+                oxi_st.bpm_final = NAN;
                 t_last = now_ms;
                 st = ST_OXI_RUN;
             } else if (joy_btn_edge) {
@@ -204,30 +246,39 @@ int main(void) {
 
         case ST_OXI_RUN: {
             if (b_edge) {
+                oxi_core1_abort();
+                web_set_oxi_live(0.f, NAN);
                 oled_lines("Oximetro cancelado", "Voltando ao menu...", "", "");
                 sleep_ms(700);
                 st = ST_ASK;
                 break;
             }
-            oxi_poll(now_ms);
             if (now_ms - t_last > 200) {
                 t_last = now_ms;
-                oxi_state_t s = oxi_get_state();
+                oxi_state_t s = oxi_st.state;
                 if (s == OXI_WAIT_FINGER) {
                     oled_lines("Oximetro ativo", "Posicione o dedo", "Aguardando...", "(B) Voltar");
                 } else if (s == OXI_SETTLE) {
                     oled_lines("Oximetro ativo", "Calibrando...", "Mantenha o dedo", "(B) Voltar");
                 } else if (s == OXI_RUN) {
-                    int n,tgt; oxi_get_progress(&n,&tgt);
-                    float live = oxi_get_bpm_live();
+                    int n = oxi_st.valid, tgt = oxi_st.target;
+                    float live = oxi_st.bpm_live;
+                    web_set_oxi_live(live, oxi_st.spo2_ok ? oxi_st.spo2_live : NAN);
                     char l2[22], l3[22];
                     snprintf(l2, sizeof l2, "BPM~ %.1f", live);
                     snprintf(l3, sizeof l3, "Validas: %d/%d", n, tgt);
                     oled_lines("Medindo...", l2, l3, "(B) Voltar");
                 } else if (s == OXI_DONE) {
-                    bpm_final_buf = oxi_get_bpm_final();
-                    char l2[22]; snprintf(l2, sizeof l2, "BPM FINAL: %.1f", bpm_final_buf);
-                    oled_lines("Concluido!", l2, "", "");
+                    bpm_final_buf = oxi_st.bpm_final;
+                    spo2_final_buf = oxi_st.spo2_ok ? oxi_st.spo2_final : NAN;
+                    hrv_final_buf = oxi_st.hrv;
+                    hrv_final_ok = oxi_st.hrv_ok;
+                    web_set_oxi_live(0.f, NAN);
+                    char l2[22], l3[22] = "", l4[22] = "";
+                    snprintf(l2, sizeof l2, "BPM FINAL: %.1f", bpm_final_buf);
+                    if (!isnan(spo2_final_buf)) snprintf(l3, sizeof l3, "SpO2: %.0f%%", spo2_final_buf);
+                    if (hrv_final_ok) snprintf(l4, sizeof l4, "RMSSD: %.0f ms", hrv_final_buf.rmssd_ms);
+                    oled_lines("Concluido!", l2, l3, l4);
                     show_until_ms = now_ms + 1500;
                     st = ST_SHOW_BPM;
                 } else if (s == OXI_ERROR) {
@@ -263,6 +314,7 @@ int main(void) {
     // Só avança se existe submissão pendente E o token mudou (e não é 0)
     if (has && tok != 0 && tok != survey_last_token) {
         survey_last_token = tok;
+        survey_bits_buf = bits;
 
         float bpm_ok = isnan(bpm_final_buf) ? 80.f : bpm_final_buf;
 
@@ -298,6 +350,7 @@ int main(void) {
         if (risk >= 6)      cor_recomendada = STAT_COLOR_VERMELHO;
         else if (risk >= 3) cor_recomendada = STAT_COLOR_AMARELO;
         else                cor_recomendada = STAT_COLOR_VERDE;
+        web_survey_set_result(tok, cor_recomendada);
 
         char l2[24]; snprintf(l2, sizeof l2, "Pegue a pulseira");
         char l3[24]; snprintf(l3, sizeof l3, "%s", cor_nome(cor_recomendada));
@@ -320,8 +373,11 @@ int main(void) {
             if ((int32_t)(show_until_ms - now_ms) <= 0 || a_edge) {
                 static bool cor_ready_once=false;
                 if (!cor_ready_once) {
+                    // core 1 ainda parando o oxímetro: tenta no próximo laço
+                    if (!oxi_core1_bus_acquire(COL_BUS_WAIT_MS)) break;
                     i2c_setup(COL_I2C, COL_SDA, COL_SCL, 100000);
                     cor_ready_once = cor_init(COL_I2C, COL_SDA, COL_SCL);
+                    oxi_core1_bus_release();
                 }
                 if (!cor_ready_once) {
                     oled_lines("TCS34725 nao encontrado", "Pulando validacao", "", "");
@@ -349,7 +405,7 @@ int main(void) {
                 t_last = now_ms;
 
                 float rf,gf,bf,cf;
-                bool have = cor_read_rgb_norm(&rf,&gf,&bf,&cf);
+                bool have = cor_read_shared(&rf,&gf,&bf,&cf);
 
                 if (!color_baseline_ready) {
                     if (have) { c0_r+=rf; c0_g+=gf; c0_b+=bf; c0_c+=cf; c0_n++; }
@@ -382,7 +438,7 @@ int main(void) {
             if (a_edge) {
                 if (!color_baseline_ready) { oled_lines("Aguarde...","Medindo ambiente","",""); sleep_ms(600); break; }
                 float rf,gf,bf,cf;
-                if (cor_read_rgb_norm(&rf,&gf,&bf,&cf)) {
+                if (cor_read_shared(&rf,&gf,&bf,&cf)) {
                     float maxc=fmaxf(rf,fmaxf(gf,bf));
                     float minc=fminf(rf,fminf(gf,bf));
                     float chroma=maxc-minc;
@@ -409,6 +465,7 @@ int main(void) {
                             stats_set_current_color(sc);
                             st = ST_SAVE_AND_DONE;
                         } else {
+                            if (cor_erros < 255) cor_erros++;
                             oled_lines("Pulseira incorreta", "Pegue a pulseira:", cor_nome(cor_recomendada), "");
                             sleep_ms(1000);
                         }
@@ -425,15 +482,29 @@ int main(void) {
             break;
         }
 
-        case ST_SAVE_AND_DONE:
-            stats_inc_color(cor_recomendada);
-            if (!isnan(bpm_final_buf)) stats_add_bpm(bpm_final_buf);
+        case ST_SAVE_AND_DONE: {
+            // um registro por triagem; os agregados do stats.c saem dele
+            stats_session_t rec = {
+                .t_start_ms  = session_t0,
+                .t_end_ms    = now_ms,
+                .bpm_x10     = stats_to_x10(bpm_final_buf),
+                .spo2_x10    = stats_to_x10(spo2_final_buf),
+                .rmssd_x10   = hrv_final_ok ? stats_to_x10(hrv_final_buf.rmssd_ms) : STATS_NA,
+                .sdnn_x10    = hrv_final_ok ? stats_to_x10(hrv_final_buf.sdnn_ms)  : STATS_NA,
+                .pnn50_x10   = hrv_final_ok ? stats_to_x10(hrv_final_buf.pnn50)    : STATS_NA,
+                .survey_bits = survey_bits_buf,
+                .color_rec   = (uint8_t)cor_recomendada,
+                .color_ok    = (uint8_t)stats_get_current_color(),  // NONE se pulou a validação
+                .wrong_tries = cor_erros,
+            };
+            stats_session_add(&rec);
             oled_lines("Registro concluido","Obrigado!","","");
             sleep_ms(900);
             stats_set_current_color((stat_color_t)STAT_COLOR_NONE);
             web_set_survey_mode(false);
             st = ST_ASK;
             break;
+        }
 
         case ST_REPORT: {
             if (now_ms - t_last > 1000) {
@@ -0,0 +1,36 @@
+#include "cbor.h"
+#include <string.h>
+
+// ====== cabeçalho: tipo maior (3 bits) + argumento no menor tamanho possível ======
+static void put_head(cbor_w_t *w, uint8_t major, uint32_t v) {
+    uint8_t b[5];
+    size_t n;
+    major <<= 5;
+    if (v < 24)          { b[0] = major | (uint8_t)v; n = 1; }
+    else if (v <= 0xFF)  { b[0] = major | 24; b[1] = (uint8_t)v; n = 2; }
+    else if (v <= 0xFFFF){ b[0] = major | 25; b[1] = (uint8_t)(v >> 8); b[2] = (uint8_t)v; n = 3; }
+    else {
+        b[0] = major | 26;
+        b[1] = (uint8_t)(v >> 24); b[2] = (uint8_t)(v >> 16);
+        b[3] = (uint8_t)(v >> 8);  b[4] = (uint8_t)v;
+        n = 5;
+    }
+    if (w->ovf || (size_t)(w->end - w->p) < n) { w->ovf = true; return; }
+    memcpy(w->p, b, n);
+    w->p += n;
+}
+
+void cbor_uint(cbor_w_t *w, uint32_t v)  { put_head(w, 0, v); }
+void cbor_array(cbor_w_t *w, uint32_t n) { put_head(w, 4, n); }
+void cbor_map(cbor_w_t *w, uint32_t n)   { put_head(w, 5, n); }
+
+// ====== float32 big-endian (tipo 7, info 26): bits copiados, sem formatar texto ======
+void cbor_f32(cbor_w_t *w, float v) {
+    uint32_t u;
+    memcpy(&u, &v, sizeof u);
+    if (w->ovf || w->end - w->p < 5) { w->ovf = true; return; }
+    w->p[0] = 0xFA;
+    w->p[1] = (uint8_t)(u >> 24); w->p[2] = (uint8_t)(u >> 16);
+    w->p[3] = (uint8_t)(u >> 8);  w->p[4] = (uint8_t)u;
+    w->p += 5;
+}
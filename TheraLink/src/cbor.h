@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Escritor CBOR (RFC 8949) mínimo: inteiros sem sinal, float32, arrays e mapas
+// de tamanho definido. Escreve num buffer fixo; passou do fim => ovf e para.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t *p, *end;
+    bool ovf;                  // faltou espaço (saída truncada, descartar)
+} cbor_w_t;
+
+static inline void cbor_init(cbor_w_t *w, void *buf, size_t len) {
+    w->p = (uint8_t *)buf; w->end = w->p + len; w->ovf = false;
+}
+
+void cbor_uint(cbor_w_t *w, uint32_t v);
+void cbor_f32(cbor_w_t *w, float v);          // sempre 0xFA + 4 B (NaN incluso)
+void cbor_array(cbor_w_t *w, uint32_t n);     // seguido de n itens
+void cbor_map(cbor_w_t *w, uint32_t n);       // seguido de n pares chave/valor
+
+#ifdef __cplusplus
+}
+#endif
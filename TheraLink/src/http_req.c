@@ -0,0 +1,195 @@
+#include "http_req.h"
+#include <string.h>
+#include <ctype.h>
+
+// cabeçalhos que o servidor lê (nome em minúsculas) -> campo no http_req_t
+typedef struct { const char *name; size_t off, size; } req_hdr_t;
+static const req_hdr_t k_hdrs[] = {
+    { "if-none-match",         offsetof(http_req_t, inm),     sizeof ((http_req_t *)0)->inm     },
+    { "connection",            offsetof(http_req_t, conn),    sizeof ((http_req_t *)0)->conn    },
+    { "upgrade",               offsetof(http_req_t, upgrade), sizeof ((http_req_t *)0)->upgrade },
+    { "sec-websocket-key",     offsetof(http_req_t, wskey),   sizeof ((http_req_t *)0)->wskey   },
+    { "sec-websocket-version", offsetof(http_req_t, wsver),   sizeof ((http_req_t *)0)->wsver   },
+    { "accept-encoding",       offsetof(http_req_t, aenc),    sizeof ((http_req_t *)0)->aenc    },
+};
+#define N_HDRS (sizeof k_hdrs / sizeof k_hdrs[0])
+#define HDR_NONE 0xFF
+
+void http_req_reset(http_req_t *r) {
+    memset(r, 0, sizeof *r);
+    r->st  = HTTP_REQ_METHOD;
+    r->hdr = HDR_NONE;
+}
+
+static void fail(http_req_t *r, uint16_t status) {
+    r->err = status;
+    r->st  = HTTP_REQ_DONE;
+}
+
+// acrescenta 1 byte em buf[size] (sempre com '\0'); false = não coube
+static bool put(char *buf, size_t size, uint8_t *n, char ch) {
+    if ((size_t)*n + 1 >= size) return false;
+    buf[(*n)++] = ch;
+    buf[*n] = '\0';
+    return true;
+}
+
+static void end_method(http_req_t *r) {
+    if      (!strcmp(r->tok, "GET"))  r->method = HTTP_M_GET;
+    else if (!strcmp(r->tok, "HEAD")) r->method = HTTP_M_HEAD;
+    else                              r->method = HTTP_M_OTHER;
+}
+
+static void end_hname(http_req_t *r) {
+    r->hdr = HDR_NONE;
+    for (size_t i = 0; i < N_HDRS; i++)
+        if (!strcmp(r->tok, k_hdrs[i].name)) { r->hdr = (uint8_t)i; break; }
+}
+
+size_t http_req_feed(http_req_t *r, const char *data, size_t len) {
+    size_t i = 0;
+    while (i < len && r->st != HTTP_REQ_DONE) {
+        char ch = data[i++];
+        if (++r->total > HTTP_REQ_MAX) { fail(r, 431); break; }
+
+        switch (r->st) {
+        case HTTP_REQ_METHOD:
+            if (ch == ' ') {
+                if (!r->n) { fail(r, 400); break; }
+                end_method(r);
+                r->n = 0; r->st = HTTP_REQ_PATH;
+            } else if (!isupper((unsigned char)ch) || !put(r->tok, 8, &r->n, ch)) fail(r, 400);
+            break;
+
+        case HTTP_REQ_PATH:
+            if (ch == ' ' || ch == '?') {
+                if (r->path[0] != '/') { fail(r, 400); break; }
+                r->n = 0; r->st = (ch == '?') ? HTTP_REQ_QUERY : HTTP_REQ_VERSION;
+            } else if (ch == '\r' || ch == '\n') fail(r, 400);         // HTTP/0.9
+            else if (!put(r->path, sizeof r->path, &r->n, ch)) fail(r, 414);
+            break;
+
+        case HTTP_REQ_QUERY:
+            if (ch == ' ') { r->n = 0; r->st = HTTP_REQ_VERSION; }
+            else if (ch == '\r' || ch == '\n') fail(r, 400);
+            else if (!put(r->query, sizeof r->query, &r->n, ch)) fail(r, 414);
+            break;
+
+        case HTTP_REQ_VERSION:
+            if (ch == '\r') break;
+            if (ch == '\n') {
+                if (strncmp(r->tok, "HTTP/1.", 7) || r->n != 8) { fail(r, 400); break; }
+                r->http10 = (r->tok[7] == '0');
+                r->n = 0; r->st = HTTP_REQ_HNAME;
+            } else if (!put(r->tok, sizeof r->tok, &r->n, ch)) fail(r, 400);
+            break;
+
+        case HTTP_REQ_HNAME:
+            if (r->n == 0 && ch == '\r') { r->st = HTTP_REQ_END; break; }
+            if (r->n == 0 && ch == '\n') { r->st = HTTP_REQ_DONE; break; }
+            if (r->n == 0 && (ch == ' ' || ch == '\t')) { r->st = HTTP_REQ_HSKIP; break; } // dobra obsoleta
+            if (ch == ':') {
+                end_hname(r);
+                r->n = 0; r->st = HTTP_REQ_HVAL;
+                if (r->hdr != HDR_NONE) ((char *)r + k_hdrs[r->hdr].off)[0] = '\0';
+            } else if (ch == '\r' || ch == '\n') fail(r, 400);          // linha sem ':'
+            else if (!put(r->tok, sizeof r->tok, &r->n, (char)tolower((unsigned char)ch)))
+                r->tok[0] = '\0';        // nome longo demais: não é nenhum dos nossos; n segue > 0
+            break;
+
+        case HTTP_REQ_HVAL:
+            if (ch == '\n') { r->n = 0; r->tok[0] = '\0'; r->st = HTTP_REQ_HNAME; break; }
+            if (ch == '\r' || r->hdr == HDR_NONE) break;
+            if (r->n == 0 && (ch == ' ' || ch == '\t')) break;
+            // valor maior que o campo é truncado (n fica parado no limite)
+            put((char *)r + k_hdrs[r->hdr].off, k_hdrs[r->hdr].size, &r->n, ch);
+            break;
+
+        case HTTP_REQ_HSKIP:
+            if (ch == '\n') { r->n = 0; r->tok[0] = '\0'; r->st = HTTP_REQ_HNAME; }
+            break;
+
+        case HTTP_REQ_END:
+            if (ch == '\n') r->st = HTTP_REQ_DONE;
+            else fail(r, 400);
+            break;
+        }
+    }
+    return i;
+}
+
+bool http_req_query(const http_req_t *r, const char *key, char *out, size_t outsz) {
+    size_t kl = strlen(key);
+    const char *p = r->query;
+    while (*p) {
+        const char *amp = strchr(p, '&');
+        size_t pl = amp ? (size_t)(amp - p) : strlen(p);
+        if (pl > kl && p[kl] == '=' && !strncmp(p, key, kl)) {
+            size_t vl = pl - kl - 1;
+            if (outsz) {
+                if (vl >= outsz) vl = outsz - 1;
+                memcpy(out, p + kl + 1, vl);
+                out[vl] = '\0';
+            }
+            return true;
+        }
+        if (!amp) break;
+        p = amp + 1;
+    }
+    return false;
+}
+
+// [p, p+n) igual a `lw` (minúsculas) sem diferenciar caixa
+static bool tok_eq(const char *p, size_t n, const char *lw) {
+    if (strlen(lw) != n) return false;
+    for (size_t i = 0; i < n; i++)
+        if (tolower((unsigned char)p[i]) != lw[i]) return false;
+    return true;
+}
+
+// q=0 (0, 0.0, 0.00, 0.000) nos parâmetros do item [p, e)
+static bool q_zero(const char *p, const char *e) {
+    for (const char *s = p; s < e; s++) {
+        if (*s != ';') continue;
+        s++;
+        while (s < e && (*s == ' ' || *s == '\t')) s++;
+        if (e - s < 2 || tolower((unsigned char)s[0]) != 'q' || s[1] != '=') continue;
+        s += 2;
+        if (s >= e || *s != '0') return false;
+        for (s++; s < e && *s != ';' && *s != ' ' && *s != '\t'; s++)
+            if (*s != '.' && *s != '0') return false;
+        return true;
+    }
+    return false;
+}
+
+bool http_req_has_token(const char *list, const char *lw) {
+    const char *p = list;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char *e = p;
+        while (*e && *e != ',') e++;
+        size_t nl = (size_t)(e - p);
+        while (nl && (p[nl-1] == ' ' || p[nl-1] == '\t')) nl--;
+        if (tok_eq(p, nl, lw)) return true;
+        p = e;
+    }
+    return false;
+}
+
+bool http_req_accepts_gzip(const http_req_t *r) {
+    const char *p = r->aenc;
+    if (!*p) return true;
+    int star = -1;                       // -1 = sem "*"; senão 0/1
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char *e = p;
+        while (*e && *e != ',') e++;
+        size_t nl = 0;
+        while (p + nl < e && p[nl] != ';' && p[nl] != ' ' && p[nl] != '\t') nl++;
+        if (tok_eq(p, nl, "gzip")) return !q_zero(p, e);   // explícito vence o "*"
+        if (nl == 1 && *p == '*') star = !q_zero(p, e);
+        p = e;
+    }
+    return star == 1;
+}
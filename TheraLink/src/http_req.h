@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Parser incremental de request HTTP/1.x (linha + cabeçalhos, sem corpo).
+// Recebe os bytes em qualquer fatiamento (pbufs), guarda só o que as rotas
+// usam em campos de tamanho fixo e nunca escreve fora deles. Não depende do lwIP.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_PATH_MAX    40     // maior rota é "/survey_state.json"
+#define HTTP_QUERY_MAX   48     // "ans=##########&t=<ms>" / "color=vermelho"
+#define HTTP_REQ_MAX     2048   // linha + cabeçalhos; passou => 431
+
+// métodos (bitmask: a tabela de rotas combina os aceitos)
+#define HTTP_M_GET    0x01
+#define HTTP_M_HEAD   0x02
+#define HTTP_M_OTHER  0x80
+
+typedef enum {
+    HTTP_REQ_METHOD = 0, HTTP_REQ_PATH, HTTP_REQ_QUERY, HTTP_REQ_VERSION,
+    HTTP_REQ_HNAME, HTTP_REQ_HVAL, HTTP_REQ_HSKIP, HTTP_REQ_END,
+    HTTP_REQ_DONE                       // request completo (ou err != 0)
+} http_req_state_t;
+
+typedef struct {
+    uint8_t  st;                        // http_req_state_t
+    uint8_t  method;                    // HTTP_M_*
+    uint8_t  hdr;                       // cabeçalho em leitura (0xFF = não interessa)
+    uint8_t  n;                         // bytes no token atual
+    bool     http10;
+    uint16_t err;                       // 0 ou status de erro (400 / 414 / 431)
+    uint16_t total;                     // bytes consumidos deste request
+    char     tok[24];                   // método / versão / nome de cabeçalho
+    char     path[HTTP_PATH_MAX];
+    char     query[HTTP_QUERY_MAX];
+    // cabeçalhos usados pelas rotas (truncados se vierem maiores)
+    char     inm[48];                   // If-None-Match
+    char     conn[32];                  // Connection ("keep-alive, Upgrade")
+    char     upgrade[16];               // Upgrade
+    char     wskey[32];                 // Sec-WebSocket-Key
+    char     wsver[4];                  // Sec-WebSocket-Version
+    char     aenc[48];                  // Accept-Encoding
+} http_req_t;
+
+void http_req_reset(http_req_t *r);
+
+// Consome bytes até o fim do request (linha em branco) ou erro; o que sobra é
+// do próximo request (pipelining). Retorna quantos bytes usou.
+size_t http_req_feed(http_req_t *r, const char *data, size_t len);
+
+static inline bool http_req_done(const http_req_t *r) { return r->st == HTTP_REQ_DONE; }
+
+// Valor de `key` na query string (sem decodificar %xx). false = ausente.
+bool http_req_query(const http_req_t *r, const char *key, char *out, size_t outsz);
+
+// Lista separada por vírgulas (Connection, Upgrade) contém `lw` (minúsculas),
+// sem diferenciar caixa
+bool http_req_has_token(const char *list, const char *lw);
+
+// Accept-Encoding admite gzip ("gzip" ou "*" sem ";q=0"; ausente = qualquer um)
+bool http_req_accepts_gzip(const http_req_t *r);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,236 @@
+#include "oxi_core1.h"
+#include <string.h>
+#include <math.h>
+#include "pico/multicore.h"
+#include "pico/mutex.h"
+#include "hardware/sync.h"
+
+#define CMD_Q_N        8      // potências de 2
+#define STATUS_Q_N     16
+#define PPG_Q_N        256    // frames do stream cru: ~5 s @50 Hz
+#define INIT_TRIES     3
+#define CORE1_IDLE_MS  1      // período do laço do core 1
+#define BUS_WAIT_MS    5000   // core 1 esperando o core 0 soltar o i2c0
+
+typedef enum { CMD_INIT = 1, CMD_START, CMD_ABORT, CMD_CONFIG, CMD_ENGINE = 0x10 } oxi_cmd_t;  // CMD_ENGINE | motor
+
+// ====== Filas SPSC (um produtor, um consumidor, sem lock) ======
+// Cada índice só é escrito por um lado; a barreira garante que o conteúdo
+// do slot fica visível no outro core antes do índice avançar.
+static uint8_t           cmd_q[CMD_Q_N];
+static oxi_config_t      cmd_cfg[CMD_Q_N];            // argumento do CMD_CONFIG, mesmo slot
+static volatile uint32_t cmd_wr=0, cmd_rd=0;          // core 0 escreve / core 1 lê
+
+static oxi_status_t      st_q[STATUS_Q_N];
+static volatile uint32_t st_wr=0, st_rd=0;            // core 1 escreve / core 0 lê
+static volatile uint32_t st_dropped=0;
+
+static bool cmd_push_cfg(uint8_t c, const oxi_config_t *cfg){
+    uint32_t wr = cmd_wr;
+    if(wr - cmd_rd >= CMD_Q_N) return false;
+    cmd_q[wr & (CMD_Q_N-1)] = c;
+    if(cfg) cmd_cfg[wr & (CMD_Q_N-1)] = *cfg;
+    __mem_fence_release();
+    cmd_wr = wr + 1;
+    return true;
+}
+static bool cmd_push(uint8_t c){ return cmd_push_cfg(c, NULL); }
+static bool cmd_pop(uint8_t *c, oxi_config_t *cfg){
+    uint32_t rd = cmd_rd;
+    if(rd == cmd_wr) return false;
+    __mem_fence_acquire();
+    *c = cmd_q[rd & (CMD_Q_N-1)];
+    if(*c == CMD_CONFIG) *cfg = cmd_cfg[rd & (CMD_Q_N-1)];
+    __mem_fence_release();
+    cmd_rd = rd + 1;
+    return true;
+}
+static bool st_push(const oxi_status_t *s){
+    uint32_t wr = st_wr;
+    if(wr - st_rd >= STATUS_Q_N){ st_dropped++; return false; } // a próxima foto corrige
+    st_q[wr & (STATUS_Q_N-1)] = *s;
+    __mem_fence_release();
+    st_wr = wr + 1;
+    return true;
+}
+
+// ====== Stream de PPG cru (core 1 -> core 0) ======
+// O consumidor só libera um frame depois do ACK TCP (tcp_write sem cópia
+// aponta p/ cá). Ring cheio => o frame do stream é descartado; a amostra
+// segue no pipeline do oxímetro normalmente.
+static oxi_ppg_frame_t   ppg_q[PPG_Q_N];
+static volatile uint32_t ppg_wr=0, ppg_rd=0;          // core 1 escreve / core 0 lê
+static volatile uint32_t ppg_drops=0;
+static volatile bool     ppg_on=false;
+static uint32_t          ppg_seq=0;                   // só o core 1
+
+static void ppg_tap(uint32_t t_ms, int32_t ir, int32_t red){
+    uint32_t seq = ppg_seq++;                         // buraco no seq = descarte
+    if(!ppg_on) return;
+    uint32_t wr = ppg_wr;
+    if(wr - ppg_rd >= PPG_Q_N){ ppg_drops++; return; }
+    oxi_ppg_frame_t *f = &ppg_q[wr & (PPG_Q_N-1)];
+    f->seq = seq; f->t_ms = t_ms; f->ir = ir; f->red = red;
+    __mem_fence_release();
+    ppg_wr = wr + 1;
+}
+
+// ====== Dono do barramento ======
+// O MAX3010x divide o i2c0 com o sensor de cor (core 0). O core 1 pega o
+// mutex no CMD_INIT/CMD_START e só solta com a medição parada (DONE, ERROR,
+// ABORT) e o INT/DMA desarmado: toda rajada DMA do IRQ do INT acontece com
+// ele na mão. O core 0 pega em volta do i2c_init()/cor_*().
+auto_init_mutex(bus_mtx);
+static bool c1_bus=false;    // só o core 1
+
+static bool c1_bus_take(void){
+    if(!c1_bus) c1_bus = mutex_enter_timeout_ms(&bus_mtx, BUS_WAIT_MS);
+    return c1_bus;
+}
+static void c1_bus_give(void){
+    if(!c1_bus) return;
+    oxi_quiesce();
+    c1_bus = false;
+    mutex_exit(&bus_mtx);
+}
+
+// ====== Core 1 ======
+static i2c_inst_t *c1_i2c;
+static uint c1_sda, c1_scl, c1_int;
+static oxi_config_t c1_cfg;  // zeros = padrão do sensor
+
+static oxi_status_t pub;     // última publicação (só o core 1 mexe)
+static bool pub_dirty=false;
+
+static void publish_if_changed(void){
+    oxi_status_t s = pub;
+    s.cmds  = cmd_rd;
+    s.state = oxi_get_state();
+    oxi_get_progress(&s.valid, &s.target);
+    s.bpm_live  = oxi_get_bpm_live();
+    s.bpm_final = oxi_get_bpm_final();
+    if(s.state == OXI_DONE) s.spo2_final = oxi_get_spo2_final(&s.spo2_ok);
+    else { s.spo2_live = oxi_get_spo2_live(&s.spo2_ok); s.spo2_final = NAN; }
+    s.hrv_ok = oxi_get_hrv(&s.hrv);
+    oxi_get_config(&s.cfg);
+
+    #define SAMEF(a,b) ((a)==(b) || (isnan(a) && isnan(b)))
+    bool same = (s.state==pub.state && s.valid==pub.valid && s.target==pub.target &&
+                 s.bpm_live==pub.bpm_live && SAMEF(s.bpm_final, pub.bpm_final) &&
+                 SAMEF(s.spo2_live, pub.spo2_live) && SAMEF(s.spo2_final, pub.spo2_final) &&
+                 s.spo2_ok==pub.spo2_ok &&
+                 s.hrv.beats==pub.hrv.beats && s.hrv.rejected==pub.hrv.rejected);
+    #undef SAMEF
+    if(same && !pub_dirty) return;
+    s.seq = pub.seq + 1;
+    if(st_push(&s)){ pub = s; pub_dirty=false; }
+    else pub_dirty=true;
+}
+
+static void do_init(void){
+    bool ok=false;
+    if(!c1_bus_take()){ pub.link = OXI_LINK_FAIL; pub_dirty = true; return; }
+    for(int tries=0; tries<INIT_TRIES && !ok; tries++){
+        ok = oxi_init(c1_i2c, c1_sda, c1_scl, &c1_cfg);
+        if(!ok) sleep_ms(200);
+    }
+    // IRQs (GPIO/DMA) ficam registradas neste core
+    if(ok) oxi_enable_int(c1_int);
+    c1_bus_give();
+    pub.link = ok ? OXI_LINK_OK : OXI_LINK_FAIL;
+    pub_dirty = true;
+}
+
+static void core1_main(void){
+    oxi_set_sample_tap(ppg_tap);
+    for(;;){
+        uint8_t c; oxi_config_t cfg;
+        while(cmd_pop(&c, &cfg)){
+            if(c==CMD_INIT)       do_init();
+            else if(c==CMD_START){
+                if(!c1_bus_take() || !oxi_start(&c1_cfg)) c1_bus_give();
+            }
+            else if(c==CMD_ABORT){ oxi_abort(); c1_bus_give(); }
+            else if(c==CMD_CONFIG){
+                // já detectado: só aceita o que o sensor suporta (senão fica a anterior)
+                if(pub.link != OXI_LINK_OK || oxi_config_valid(&cfg)) c1_cfg = cfg;
+            }
+            else if((c & 0xF0)==CMD_ENGINE) oxi_set_engine((oxi_engine_t)(c & 0x0F));
+            pub_dirty = true;
+        }
+        oxi_poll(to_ms_since_boot(get_absolute_time()));
+        oxi_state_t os = oxi_get_state();
+        if(os == OXI_DONE || os == OXI_ERROR || os == OXI_IDLE) c1_bus_give();
+        publish_if_changed();
+        sleep_ms(CORE1_IDLE_MS);
+    }
+}
+
+// ====== API (core 0) ======
+void oxi_core1_launch(i2c_inst_t *i2c, uint sda_pin, uint scl_pin, uint int_pin){
+    static bool launched=false;
+    if(launched) return;
+    c1_i2c=i2c; c1_sda=sda_pin; c1_scl=scl_pin; c1_int=int_pin;
+    memset(&pub, 0, sizeof pub);
+    pub.link = OXI_LINK_UNKNOWN;
+    pub.state = OXI_IDLE;
+    pub.bpm_final = NAN;
+    pub.spo2_live = NAN;
+    pub.spo2_final = NAN;
+    launched = true;
+    multicore_launch_core1(core1_main);
+}
+
+bool oxi_core1_init(void)  { return cmd_push(CMD_INIT);  }
+bool oxi_core1_start(void) { return cmd_push(CMD_START); }
+bool oxi_core1_abort(void) { return cmd_push(CMD_ABORT); }
+bool oxi_core1_set_engine(oxi_engine_t e) { return cmd_push((uint8_t)(CMD_ENGINE | (e & 0x0F))); }
+bool oxi_core1_configure(const oxi_config_t *cfg){
+    oxi_config_t c = {0};
+    if(cfg) c = *cfg;
+    return cmd_push_cfg(CMD_CONFIG, &c);
+}
+
+uint32_t oxi_core1_ppg_open(void){
+    ppg_on = false;
+    ppg_rd = ppg_wr;                  // descarta o que sobrou
+    __mem_fence_release();
+    ppg_on = true;
+    return ppg_rd;
+}
+void oxi_core1_ppg_close(void){ ppg_on = false; }
+
+size_t oxi_core1_ppg_peek(uint32_t from, const oxi_ppg_frame_t **out){
+    uint32_t wr = ppg_wr;
+    if(from - ppg_rd >= wr - ppg_rd) return 0;     // nada novo (ou fora da janela)
+    __mem_fence_acquire();
+    uint32_t i = from & (PPG_Q_N-1);
+    uint32_t n = wr - from;
+    if(n > PPG_Q_N - i) n = PPG_Q_N - i;           // só o trecho contíguo
+    *out = &ppg_q[i];
+    return n;
+}
+
+void oxi_core1_ppg_release(uint32_t upto){
+    __mem_fence_release();
+    ppg_rd = upto;
+}
+
+uint32_t oxi_core1_ppg_drops(void){ return ppg_drops; }
+
+bool oxi_core1_bus_acquire(uint32_t timeout_ms){ return mutex_enter_timeout_ms(&bus_mtx, timeout_ms); }
+void oxi_core1_bus_release(void){ mutex_exit(&bus_mtx); }
+
+bool oxi_core1_pop(oxi_status_t *out){
+    for(;;){
+        uint32_t rd = st_rd;
+        if(rd == st_wr) return false;
+        __mem_fence_acquire();
+        oxi_status_t s = st_q[rd & (STATUS_Q_N-1)];
+        __mem_fence_release();
+        st_rd = rd + 1;
+        if(s.cmds != cmd_wr) continue;   // anterior ao último comando
+        if(out) *out = s;
+        return true;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef OXI_CORE1_H
+#define OXI_CORE1_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "oximetro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Roda aquisição + estimativa de BPM do oxímetro no core 1.
+   O core 0 manda comandos e recebe "fotos" do estado por duas filas SPSC
+   sem lock; o core 1 é o único que toca no oximetro.c (e nas IRQs dele). */
+
+typedef enum {
+    OXI_LINK_UNKNOWN = 0,    // ainda não tentou detectar
+    OXI_LINK_OK,             // MAX3010x detectado e configurado
+    OXI_LINK_FAIL            // não respondeu no barramento
+} oxi_link_t;
+
+typedef struct {
+    uint32_t    seq;         // incrementa a cada publicação
+    uint32_t    cmds;        // comandos já processados pelo core 1
+    oxi_link_t  link;
+    oxi_state_t state;
+    int         valid;       // progresso (valid/target)
+    int         target;
+    float       bpm_live;
+    float       bpm_final;   // NAN até DONE
+    float       spo2_live;   // NAN até o 1º batimento válido
+    float       spo2_final;  // NAN até DONE
+    bool        spo2_ok;     // qualidade do SpO2 (live durante RUN, final após DONE)
+    oxi_hrv_t   hrv;         // HRV acumulada na medição (congela no DONE)
+    bool        hrv_ok;      // intervalos suficientes
+    oxi_config_t cfg;        // config de aquisição em uso (padrões resolvidos)
+} oxi_status_t;
+
+/* Frame do stream de PPG cru (/ppg.bin): 16 bytes, little-endian */
+typedef struct {
+    uint32_t seq;            // nº da amostra (buraco = frame descartado)
+    uint32_t t_ms;           // instante estimado da amostra (ms desde o boot)
+    int32_t  ir;             // contagens do ADC
+    int32_t  red;
+} oxi_ppg_frame_t;
+
+/* Sobe o core 1 (uma vez). Não mexe no sensor até oxi_core1_init(). */
+void oxi_core1_launch(i2c_inst_t *i2c, uint sda_pin, uint scl_pin, uint int_pin);
+
+/* Comandos (core 0 -> core 1). Retornam false se a fila estiver cheia. */
+bool oxi_core1_init(void);       // detecta/configura (resposta em status.link)
+bool oxi_core1_start(void);
+bool oxi_core1_abort(void);
+bool oxi_core1_set_engine(oxi_engine_t e);   // vale a partir do próximo start
+bool oxi_core1_configure(const oxi_config_t *cfg);  // idem; NULL = padrão, inválida é ignorada
+
+/* Stream das amostras cruas (core 0, um consumidor). Com o consumidor
+   atrasado o core 1 descarta frames do stream, nunca amostras do sensor.
+   open() liga o tap e devolve o índice do 1º frame; peek() dá o maior trecho
+   contíguo a partir de 'from', válido até release(upto) liberar os slots. */
+uint32_t oxi_core1_ppg_open(void);
+void     oxi_core1_ppg_close(void);
+size_t   oxi_core1_ppg_peek(uint32_t from, const oxi_ppg_frame_t **out);
+void     oxi_core1_ppg_release(uint32_t upto);
+uint32_t oxi_core1_ppg_drops(void);   // frames descartados desde o boot
+
+/* i2c0 compartilhado (core 0): pegar antes de qualquer acesso ao barramento
+   do oxímetro (sensor de cor, i2c_init) e soltar logo depois. O core 1 é o
+   dono durante a detecção e a medição inteira; acquire() espera até
+   'timeout_ms' e devolve false se a medição ainda não parou. */
+bool oxi_core1_bus_acquire(uint32_t timeout_ms);
+void oxi_core1_bus_release(void);
+
+/* Consome a próxima publicação do core 1 (core 0). Retorna false se vazia.
+   Publicações anteriores ao último comando enviado são descartadas, então
+   depois de oxi_core1_start() nunca chega um DONE da medição anterior. */
+bool oxi_core1_pop(oxi_status_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -1,51 +1,121 @@
 #include "oximetro.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "hardware/i2c.h"
-
-
-
-
+#include "hardware/gpio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+// OXI_FIXED_POINT=1: normalização/interpolação do estimador em inteiro (Q15)
+// em vez de double (o M0+ não tem FPU). Definido pelo CMake.
+#ifndef OXI_FIXED_POINT
+#define OXI_FIXED_POINT 0
+#endif
+
+// OXI_LOG=1: loga o DONE (printf com float) no core 1. Desligado por
+// padrão: stdio no core 1 concorre com o core 0 e custa ~ms. Definido pelo CMake.
+#ifndef OXI_LOG
+#define OXI_LOG 0
+#endif
 
 // ================= I2C / endereço =================
 #define I2C_ADDR 0x57
 
 // ================= Config de aquisição =================
-// MAX30102: 400 Hz, avg=8 => ~50 Hz efetivo
-#define SR_SENSOR_HZ        400
-#define AVG_SAMPLES         8
-#define FS_HZ               (SR_SENSOR_HZ / AVG_SAMPLES)     // 50 Hz (inteiro)
-#define SAMPLE_PERIOD_MS    (1000 / FS_HZ)                   // 20 ms
+// Vem de oxi_config_t em runtime (padrão MAX30102: 400 Hz, avg=8 => 50 Hz
+// efetivo). Buffers dimensionados p/ OXI_FS_MAX_HZ; o resto em cfg_apply().
+#define FS_DEFAULT_HZ       50
+
+// FIFO do sensor: drena tudo numa rajada a cada FIFO_POLL_MS
+#define FIFO_DEPTH_30102    32                               // ~640 ms @50 Hz
+#define FIFO_DEPTH_30100    16                               // ~320 ms @50 Hz
+#define FIFO_DEPTH_MAX      FIFO_DEPTH_30102
+#define FIFO_POLL_MS        100                              // ~5 amostras/rajada
+
+// Modo INT (MAX30102): A_FULL dispara com 32-15 = 17 amostras na FIFO e o
+// DMA lê exatamente essas 17 (102 B) direto do I2C para um ring. O INT só
+// solta lendo o INT_STATUS_1 (0x00): a mesma rajada termina lendo ele.
+#define IRQ_A_FULL_EMPTY    15
+#define IRQ_BURST_SAMPLES   (FIFO_DEPTH_30102 - IRQ_A_FULL_EMPTY)   // 17
+#define IRQ_RING_N          64                               // potência de 2
+#define IRQ_WATCHDOG_SAMPLES 24                              // sem INT => polling: > 17 e < 32 (FIFO)
+#define IRQ_DMA_TIMEOUT_US  50000                            // rajada travada (NACK)
 
 // ================= Gate de dedo =================
-#define FINGER_IR_MIN_30100   6000.0f
-#define FINGER_IR_MIN_30102   12000.0f
+#define FINGER_IR_MIN_30100   6000
+#define FINGER_IR_MIN_30102   12000
 #define FINGER_ON_HOLD_MS     250
 #define FINGER_OFF_HOLD_MS    300
 
 // ================= Janela / filtros =================
-#define SMOOTH_N              7    // média móvel curta (suave, sem comer picos)
+#define SMOOTH_N              7    // média móvel curta @50 Hz (máx.; escala com fs)
 #define AC_WIN_SEC            6    // 6 s de janela p/ autocorrelação
-#define AC_SAMPLES            (FS_HZ * AC_WIN_SEC)           // 300 @50 Hz
+#define AC_SAMPLES_MAX        (OXI_FS_MAX_HZ * AC_WIN_SEC)   // 600
 #define AC_RECOMP_MS          1000                           // recalcula a cada ~1 s
 
-// Banda de BPM e conversão p/ lags
+// Banda de BPM; lags = fs*60/bpm com 1 de folga em cada ponta (15..76 @50 Hz):
+// pico na borda não tem vizinho p/ a parábola nem p/ a regra do subharmônico
 #define BPM_MIN               40.0f
 #define BPM_MAX               180.0f
-#define LAG_MIN               (FS_HZ * 60 / (int)BPM_MAX)    // ~17 @50 Hz
-#define LAG_MAX               (FS_HZ * 60 / (int)BPM_MIN)    // ~75 @50 Hz
+#define LAG_MAX_MAX           (OXI_FS_MAX_HZ * 60 / (int)BPM_MIN + 1)
+#define AC_NLAGS_MAX          (LAG_MAX_MAX - (OXI_FS_MAX_HZ * 60 / (int)BPM_MAX - 1) + 1)
 
 // Qualidade e aceitação
 #define Q_MIN                 0.30f   // Rmax/R0 mínimo p/ aceitar
+#define SUBHARM_PCT           90      // 1º pico local >= 90% do máximo vence (evita 2T)
 #define BAND_TOL_FRAC         0.10f   // ±10% banda p/ estabilidade
 #define FINAL_GOOD_EST        4       // precisa de 4 estimativas boas
 
-// Timeout / settle
-#define SETTLE_SAMPLES        ((FS_HZ * 8) / 10)   // ~0.8 s
+// Índice de qualidade por segmento (SQI): segmento ruim fica fora da janela
+#define SQI_SEG_MAX           (OXI_FS_MAX_HZ / 2)   // segmento de 0.5 s
+#define SQI_PI_MIN            0.0005f // AC/DC: abaixo disso não há pulso
+#define SQI_PI_MAX            0.08f   // acima: movimento/pressão (PPG de dedo < ~5%)
+#define SQI_KURT_MAX          6.0f    // picos isolados (senoide 1.5, ruído ~3)
+#define SQI_CLIP_30102        (0x3FFFF - 0x3FF)   // perto do fundo de escala do ADC
+#define SQI_CLIP_30100        (0xFFFF - 0xFF)
+
+// Saída antecipada: DONE assim que o IC de 95% do BPM (pelos intervalos NN)
+// ficar abaixo de ±ci_bpm e OXI_CI_AGREE estimativas seguidas da
+// autocorrelação caírem nele e entre si. 0 desliga.
+#define OXI_CI_BPM_DEFAULT    2.0f
+#define OXI_CI_MIN_BEATS      HRV_MIN_BEATS   // garante HRV no DONE
+#define OXI_CI_AGREE          2               // 1 estimativa = janela parcial, pode ser sorte
+
+// Timeout (o settle dura ~0.8 s)
 #define TIMEOUT_MS            20000
 
-// Corrente LED (MAX30102). Ajuste se saturar ou faltar SNR.
-#define LED_CURR              0x5F   // ~19–25 mA
+// SpO2 (razão das razões por batimento): SpO2 ~ A - B*R, R=(AC/DC)red/(AC/DC)ir
+#define SPO2_A                110.0f
+#define SPO2_B                25.0f
+#define SPO2_R_MIN            0.30f   // fora disso: batimento descartado
+#define SPO2_R_MAX            1.40f
+#define SPO2_PI_MIN           0.001f  // índice de perfusão IR (AC/DC) mínimo
+#define SPO2_R_TOL            0.10f   // concordância entre batimentos
+#define SPO2_GOOD_BEATS       3       // batimentos concordantes p/ qualidade ok
+
+// HRV: picos sistólicos do sinal suavizado -> intervalos NN (us)
+#define HRV_DC_SHIFT          5       // linha de base IIR (fc ~0.25 Hz @50 Hz; +1 por 2x fs)
+#define HRV_ENV_SHIFT         6       // decaimento do envelope (~0.9 s p/ metade)
+#define HRV_IBI_TOL_PCT       30      // NN fora de ±30% da referência = artefato
+#define HRV_NN50_US           50000
+#define HRV_MIN_BEATS         8       // intervalos NN p/ reportar
+
+// Corrente LED inicial (o AGC do settle ajusta a partir daqui)
+#define LED_CURR              0x5F   // MAX30102: ~19 mA (0.2 mA/passo)
+#define LED_RANGE             3      // MAX30102: ADC 16384 nA
+#define LED_CURR_30100_RD     2      // MAX30100: ~7.6 mA (nibble 0..15)
+#define LED_CURR_30100_IR     4      // ~14.2 mA
+
+// AGC (OXI_SETTLE): leva o DC dos dois canais p/ AGC_LO..AGC_HI % do fundo
+// de escala, mexendo na corrente dos LEDs e, no MAX30102, na faixa do ADC
+#define AGC_BLOCK             10      // amostras por avaliação
+#define AGC_SKIP              20      // descarta após mudar (FIFO/ring com a config antiga)
+#define AGC_MAX_STEPS         6
+#define AGC_LO_PCT            25
+#define AGC_HI_PCT            75
+#define AGC_TARGET_PCT        50
 
 // ====== I2C helpers ======
 static i2c_inst_t *g_i2c = NULL;
@@ -59,17 +129,33 @@ static inline bool w8(uint8_t r, uint8_t v){
 static inline bool rn(uint8_t r, uint8_t *d, size_t n){
     int w = i2c_write_timeout_us(g_i2c, I2C_ADDR, &r, 1, true, 2000);
     if(w < 0) return false;
-    int rr = i2c_read_timeout_us(g_i2c, I2C_ADDR, d, n, false, 2000);
+    // ~90 us/byte @100 kHz: rajadas da FIFO (até 192 B) precisam de mais tempo
+    int rr = i2c_read_timeout_us(g_i2c, I2C_ADDR, d, n, false, 2000 + 100*(uint)n);
     return (rr == (int)n);
 }
 
+// ====== Config em runtime (cfg_apply) ======
+static oxi_config_t g_cfg;                       // padrões já resolvidos
+static uint8_t  reg_sr=0, reg_avg=0, reg_pw=0;   // códigos nos registradores
+static int      fs_hz=FS_DEFAULT_HZ;             // taxa efetiva (após a média da FIFO)
+static uint32_t period_us=1000000/FS_DEFAULT_HZ;
+static int      lag_min, lag_max;                // banda BPM_MAX..BPM_MIN em amostras
+static int      ac_len, ac_min;                  // janela cheia / parcial (>= 2 períodos a 40 bpm)
+static int      smooth_len=SMOOTH_N;             // ~140 ms
+static int      settle_len, sqi_len, sqi_zc_max;
+static int      hrv_dc_shift=HRV_DC_SHIFT, hrv_env_shift=HRV_ENV_SHIFT;
+static uint32_t irq_watchdog_ms=IRQ_WATCHDOG_SAMPLES*1000/FS_DEFAULT_HZ;
+
+// ====== AGC: config corrente dos LEDs/ADC (reescrita em todo init) ======
+static uint8_t agc_ir=LED_CURR, agc_rd=LED_CURR, agc_range=LED_RANGE;
+
 // ====== MAX30100 ======
 static bool max30100_init(void){
     bool ok=true;
     ok &= w8(0x06,0x40); sleep_ms(10);                 // reset
     ok &= w8(0x02,0x00); ok &= w8(0x03,0x00); ok &= w8(0x04,0x00);
-    ok &= w8(0x07,(1u<<6)|(0b011<<2)|0b11);            // SPO2: 100Hz, 16-bit
-    ok &= w8(0x09,0x24); ok &= w8(0x0A,0x24);          // ~8–10 mA
+    ok &= w8(0x07,(uint8_t)((1u<<6)|(reg_sr<<2)|reg_pw)); // SPO2: taxa/largura (cfg)
+    ok &= w8(0x09,(uint8_t)((agc_rd<<4)|agc_ir));      // LEDs (AGC)
     ok &= w8(0x06,0x03);                               // SPO2 mode
     uint8_t m=0; ok &= rn(0x06,&m,1);
     return ok && ((m&0x07)==0x03);
@@ -82,54 +168,61 @@ static bool max30100_init(void){
 
 
 }
-static bool max30100_read(uint16_t *ir, uint16_t *red){
-    uint8_t d[4];
-    if(!rn(0x05,d,4)) return false;
-    *ir =(uint16_t)((d[0]<<8)|d[1]);
-    *red=(uint16_t)((d[2]<<8)|d[3]);
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-    return true;
+// Drena a FIFO (16 x 4 bytes) numa rajada. Retorna nº de amostras ou -1.
+static int max30100_read_fifo(uint16_t *ir, uint16_t *red, uint8_t *ovf){
+    uint8_t p[3];
+    if(!rn(0x02,p,3)) return -1;                        // WR_PTR, OVF, RD_PTR
+    int n = (p[0] - p[2]) & (FIFO_DEPTH_30100-1);
+    *ovf = p[1] & 0x0F;
+    if(n==0 && *ovf) n = FIFO_DEPTH_30100;             // cheia (ponteiros iguais)
+    if(n==0) return 0;
+
+    uint8_t d[FIFO_DEPTH_30100*4];
+    if(!rn(0x05,d,(size_t)n*4)) return -1;
+    for(int i=0;i<n;i++){
+        const uint8_t *q = &d[i*4];
+        ir[i] =(uint16_t)((q[0]<<8)|q[1]);
+        red[i]=(uint16_t)((q[2]<<8)|q[3]);
+    }
+    return n;
 }
 
 // ====== MAX30102 ======
+static volatile bool g_int_en=false;  // INT (A_FULL) ligado em oxi_enable_int()
+
 static bool max30102_init(void){
     bool ok=true;
     ok &= w8(0x09,0x40); sleep_ms(10);                                 // reset
-    ok &= w8(0x08,(0b011<<5)|(1<<4)|0x00);                              // AVG=8, rollover
-    ok &= w8(0x0A,(0b11<<5)|(0b011<<2)|0b11);                           // 16384nA, 400Hz, 411us
-    ok &= w8(0x0C,LED_CURR);                                           // RED
-    ok &= w8(0x0D,LED_CURR);                                           // IR
+    ok &= w8(0x08,(uint8_t)((reg_avg<<5)|(1<<4)|(g_int_en? IRQ_A_FULL_EMPTY: 0)));  // AVG (cfg), rollover, A_FULL
+    ok &= w8(0x0A,(uint8_t)((agc_range<<5)|(reg_sr<<2)|reg_pw));       // faixa (AGC), taxa/largura (cfg)
+    ok &= w8(0x0C,agc_rd);                                             // RED
+    ok &= w8(0x0D,agc_ir);                                             // IR
     ok &= w8(0x11,(0x01)|(0x02<<4));                                   // slots: RED, IR
     ok &= w8(0x12,0x00);
+    ok &= w8(0x02,g_int_en? 0x80: 0x00);                               // A_FULL_EN
     ok &= w8(0x04,0x00); ok &= w8(0x05,0x00); ok &= w8(0x06,0x00);     // FIFO ptrs
     ok &= w8(0x09,0x03);                                               // SPO2 mode
+    uint8_t st[2]; ok &= rn(0x00,st,2);                                // limpa INT pendente (PWR_RDY)
     uint8_t m=0; ok &= rn(0x09,&m,1);
     return ok && ((m&0x07)==0x03);
 }
-static bool max30102_read(uint32_t *ir, uint32_t *red){
-    uint8_t d[6];
-    if(!rn(0x07,d,6)) return false;
-    *red = (((uint32_t)d[0]<<16)|((uint32_t)d[1]<<8)|d[2]) & 0x3FFFF;
-    *ir  = (((uint32_t)d[3]<<16)|((uint32_t)d[4]<<8)|d[5]) & 0x3FFFF;
-    return true;
-
+// Drena a FIFO (32 x 6 bytes) numa rajada. Retorna nº de amostras ou -1.
+static int max30102_read_fifo(uint32_t *ir, uint32_t *red, uint8_t *ovf){
+    uint8_t p[3];
+    if(!rn(0x04,p,3)) return -1;                        // WR_PTR, OVF, RD_PTR
+    int n = (p[0] - p[2]) & (FIFO_DEPTH_30102-1);
+    *ovf = p[1] & 0x1F;
+    if(n==0 && *ovf) n = FIFO_DEPTH_30102;             // cheia (ponteiros iguais)
+    if(n==0) return 0;
+
+    static uint8_t d[FIFO_DEPTH_30102*6];
+    if(!rn(0x07,d,(size_t)n*6)) return -1;
+    for(int i=0;i<n;i++){
+        const uint8_t *q = &d[i*6];
+        red[i] = (((uint32_t)q[0]<<16)|((uint32_t)q[1]<<8)|q[2]) & 0x3FFFF;
+        ir[i]  = (((uint32_t)q[3]<<16)|((uint32_t)q[4]<<8)|q[5]) & 0x3FFFF;
+    }
+    return n;
 }
 
 // ====== Estado/variáveis ======
@@ -137,110 +230,509 @@ static oxi_state_t g_state = OXI_IDLE;
 static bool g_is30102=false, g_inited=false;
 
 static uint32_t sample_last_ms=0;
+static uint32_t fifo_ovf_total=0;     // amostras perdidas (overflow da FIFO)
+static oxi_timing_t g_timing;         // jitter por rajada (polling ou INT)
+static uint32_t timing_last_us=0;
 static uint32_t settle_done_ms=0;
 
+// settle: variância dos canais + AGC
+static int     st_n=0;
+static int64_t st_s_ir=0, st_s2_ir=0, st_s_rd=0, st_s2_rd=0;
+static int     agc_n=0, agc_skip=0;
+static int64_t agc_s_ir=0, agc_s_rd=0;
+static oxi_agc_t g_agc;
+static void agc_publish(void){
+    g_agc.led_ir = agc_ir; g_agc.led_red = agc_rd;
+    g_agc.adc_range = g_is30102 ? agc_range : 0;
+}
+
 static float bpm_live=0.0f, bpm_final=NAN;
 static int   good_estimates=0;
+static float ci_bpm = OXI_CI_BPM_DEFAULT;     // meia-largura alvo (0 = só a regra de 4 estáveis)
+static float ci_est[OXI_CI_AGREE];            // estimativas seguidas dentro do IC
+static int   ci_n=0;
 
 // finger debounce
 static bool finger_on=false;
 static uint32_t finger_on_ms=0, finger_off_ms=0;
 
+// tap das amostras cruas (stream p/ análise offline)
+static oxi_sample_tap_t g_tap = NULL;
+
+// motor de estimativa: o pedido vale a partir do próximo oxi_start()
+static oxi_engine_t engine_req = OXI_ENGINE_ACF, engine_run = OXI_ENGINE_ACF;
+
 // escolha de canal
 typedef enum { CH_IR=0, CH_RED=1 } chan_t;
 static chan_t use_ch = CH_IR;
 
-// suavização curta
-static float smooth_q[SMOOTH_N];
-static int   smooth_n=0, smooth_head=0;
-static float smooth_sum=0;
-
-// buffer de autocorrelação (6 s)
-static float ac_buf[AC_SAMPLES];
-static int   ac_n=0, ac_head=0;
+// suavização curta (amostras cruas são inteiras: soma cabe exata em int32)
+static int32_t smooth_q[SMOOTH_N];
+static int     smooth_n=0, smooth_head=0;
+static int32_t smooth_sum=0;
+
+// buffer de autocorrelação (6 s) + somas móveis por lag
+// ac_buf guarda a soma inteira da média móvel (escala smooth_len, não altera R[k]/R[0])
+static int32_t ac_buf[AC_SAMPLES_MAX];
+static int     ac_n=0, ac_head=0;
+static int64_t ac_sum=0;              // sum x[i]
+static int64_t ac_s0=0;               // sum x[i]^2
+static int64_t ac_sk[AC_NLAGS_MAX];   // sum x[i]*x[i+k], k em [lag_min..lag_max]
 static uint32_t ac_last_ms=0;
 
+// SpO2: só acumuladores por batimento (min/max/soma dos 2 canais), O(1)
+// por amostra; o segmento tem ~1 período (lag do BPM ao vivo).
+static int32_t sp_ir_f=0, sp_rd_f=0;          // IIR curto, escala x16
+static int32_t sp_ir_min, sp_ir_max, sp_rd_min, sp_rd_max;
+static int32_t sp_ir_sum, sp_rd_sum;
+static int     sp_n=0, sp_seg_len=FS_DEFAULT_HZ;       // 60 bpm até a 1ª estimativa
+static int     sp_good=0;
+static float   sp_r_ema=0.0f;
+static float   spo2_live=NAN, spo2_final=NAN;
+static bool    spo2_final_ok=false;
+
+// HRV: detector de picos (inverte o PPG: sístole = mínimo do sinal cru)
+// + acumuladores O(1) por batimento. Tempo em amostras Q8 (interpolação
+// parabólica no pico), sem buffer de batimentos.
+static int32_t pk_dc;                          // linha de base, escala x16
+static int32_t pk_env, pk_last;                // envelope e amostra anterior
+static int32_t pk_val, pk_l, pk_r;             // pico corrente e vizinhos
+static int32_t pk_i, pk_n;                     // índice do pico / amostras
+static int32_t pk_t_q8;                        // último pico aceito (<0: nenhum)
+static bool    pk_above;
+
+static int32_t hrv_k;                          // 1º NN (desloca as somas)
+static int32_t hrv_prev;                       // NN anterior (0: cadeia quebrada)
+static int64_t hrv_s, hrv_s2, hrv_sd2;         // sum(d), sum(d^2), sum(dNN^2)
+static uint16_t hrv_n, hrv_nd, hrv_nn50, hrv_rej;
+static oxi_hrv_t hrv_out;
+
+// SQI: segura um segmento cru antes de alimentar o pipeline
+static int32_t sq_ir[SQI_SEG_MAX], sq_rd[SQI_SEG_MAX];
+static int     sq_n=0;
+static bool    sq_gap=false;                   // buraco no tempo dentro do segmento
+
 // histórico de estimativas p/ final
 #define EST_BUF 8
 static float bpm_hist[EST_BUF];
 static int   est_n=0;
 
 // ====== helpers ======
-static inline float finger_gate_min(void){
+static inline int32_t finger_gate_min(void){
     return g_is30102 ? FINGER_IR_MIN_30102 : FINGER_IR_MIN_30100;
 }
-static inline float smooth_push(float x){
-    if(smooth_n<SMOOTH_N){ smooth_q[smooth_head]=x; smooth_sum+=x; smooth_head=(smooth_head+1)%SMOOTH_N; smooth_n++; }
-    else { smooth_sum -= smooth_q[smooth_head]; smooth_q[smooth_head]=x; smooth_sum += x; smooth_head=(smooth_head+1)%SMOOTH_N; }
-    return smooth_sum / (float)smooth_n;
+// devolve a soma da janela curta (média = soma/smooth_n)
+static inline int32_t smooth_push(int32_t x){
+    if(smooth_n<smooth_len){ smooth_q[smooth_head]=x; smooth_sum+=x; smooth_head=(smooth_head+1)%smooth_len; smooth_n++; }
+    else { smooth_sum -= smooth_q[smooth_head]; smooth_q[smooth_head]=x; smooth_sum += x; smooth_head=(smooth_head+1)%smooth_len; }
+    return smooth_sum;
 }
-static inline void ac_push(float y){
-    if(ac_n<AC_SAMPLES){ ac_buf[ac_head]=y; ac_head=(ac_head+1)%AC_SAMPLES; ac_n++; }
-    else { ac_buf[ac_head]=y; ac_head=(ac_head+1)%AC_SAMPLES; }
+// empurra amostra na janela atualizando as somas por lag em O(lags):
+// remove os produtos da amostra que sai e soma os da que entra.
+// Tudo inteiro (|x| < 2^21, produtos < 2^42) => sem deriva acumulada.
+// Com o motor Goertzel as somas por lag não são usadas e ficam paradas.
+static void ac_push(int32_t y){
+    bool lags = (engine_run == OXI_ENGINE_ACF);
+    if(ac_n == ac_len){
+        // janela cheia: ac_head aponta p/ a amostra mais antiga
+        int64_t old = ac_buf[ac_head];
+        ac_s0  -= old*old;
+        ac_sum -= old;
+        for(int k=lag_min; k<=lag_max && lags; k++){
+            int idx = ac_head + k; if(idx >= ac_len) idx -= ac_len;
+            ac_sk[k-lag_min] -= old * (int64_t)ac_buf[idx];
+        }
+    }
+    int prev = (ac_n == ac_len) ? ac_len-1 : ac_n; // amostras anteriores na janela
+    int64_t v = y;
+    for(int k=lag_min; k<=lag_max && k<=prev && lags; k++){
+        int idx = ac_head - k; if(idx < 0) idx += ac_len;
+        ac_sk[k-lag_min] += v * (int64_t)ac_buf[idx];
+    }
+    ac_buf[ac_head] = y;
+    ac_s0  += v*v;
+    ac_sum += v;
+    ac_head = (ac_head+1)%ac_len;
+    if(ac_n < ac_len) ac_n++;
 }
-static void reset_buffers(void){
+// o detector roda sobre a mesma suavização: buraco no sinal recomeça os dois
+static void pk_reset(void){
+    pk_n=0; pk_above=false; pk_t_q8=-1; pk_env=0;
+    hrv_prev=0;
+}
+static void ac_reset(void){
     smooth_n=0; smooth_head=0; smooth_sum=0;
     ac_n=0; ac_head=0;
-    est_n=0; good_estimates=0;
+    ac_sum=0; ac_s0=0; memset(ac_sk, 0, sizeof(ac_sk));
+    pk_reset();
+    sq_n=0; sq_gap=false;
+}
+static void hrv_reset(void){
+    hrv_k=0; hrv_prev=0;
+    hrv_s=0; hrv_s2=0; hrv_sd2=0;
+    hrv_n=0; hrv_nd=0; hrv_nn50=0; hrv_rej=0;
+    memset(&hrv_out, 0, sizeof hrv_out);
+}
+static void spo2_reset(void){
+    sp_ir_f=0; sp_rd_f=0; sp_n=0; sp_seg_len=fs_hz;
+    sp_good=0; sp_r_ema=0.0f;
+    spo2_live=NAN; spo2_final=NAN; spo2_final_ok=false;
+}
+static void reset_buffers(void){
+    ac_reset();
+    spo2_reset();
+    hrv_reset();
+    est_n=0; good_estimates=0; ci_n=0;
     bpm_live=0.0f; bpm_final=NAN;
 }
 
-// calcula média da janela
-static void ac_copy_demean(float *dst){
-    // copia em ordem temporal e remove média
-    double s=0;
-    for(int i=0;i<ac_n;i++){
-        int idx = (ac_head - ac_n + i + AC_SAMPLES) % AC_SAMPLES;
-        float v = ac_buf[idx];
-        dst[i] = v;
-        s += v;
+// fecha um segmento (~1 batimento): R = (AC/DC)red / (AC/DC)ir
+static void spo2_beat(void){
+    int32_t ac_ir = sp_ir_max - sp_ir_min, ac_rd = sp_rd_max - sp_rd_min;
+    if(ac_ir <= 0 || ac_rd <= 0 || sp_ir_sum <= 0 || sp_rd_sum <= 0){ sp_good=0; return; }
+    // DC = soma/n nos dois canais: o n cancela na razão. min/max estão na
+    // escala x16 do IIR e a soma em x1: o 16 cancela em r, não no PI
+    float pi_ir = (float)ac_ir * (float)sp_n / (16.0f * (float)sp_ir_sum);
+    float r = ((float)ac_rd * (float)sp_ir_sum) / ((float)ac_ir * (float)sp_rd_sum);
+    if(pi_ir < SPO2_PI_MIN || r < SPO2_R_MIN || r > SPO2_R_MAX){ sp_good=0; return; }
+
+    if(sp_good==0 || fabsf(r - sp_r_ema) > SPO2_R_TOL){ sp_r_ema = r; sp_good = 1; }
+    else { sp_r_ema = 0.75f*sp_r_ema + 0.25f*r; sp_good++; }
+    float v = SPO2_A - SPO2_B*sp_r_ema;
+    spo2_live = v > 100.0f ? 100.0f : v;
+}
+
+// por amostra: só IIR + min/max/soma (inteiro)
+static inline void spo2_push(int32_t ir, int32_t red){
+    if(sp_ir_f==0){ sp_ir_f = ir<<4; sp_rd_f = red<<4; }
+    sp_ir_f += ((ir<<4) - sp_ir_f) >> 2;
+    sp_rd_f += ((red<<4) - sp_rd_f) >> 2;
+    if(sp_n==0){
+        sp_ir_min=sp_ir_max=sp_ir_f; sp_rd_min=sp_rd_max=sp_rd_f;
+        sp_ir_sum=0; sp_rd_sum=0;
     }
-    float mean = (float)(s / (double)ac_n);
-    for(int i=0;i<ac_n;i++) dst[i] -= mean;
+    if(sp_ir_f < sp_ir_min) sp_ir_min=sp_ir_f;
+    if(sp_ir_f > sp_ir_max) sp_ir_max=sp_ir_f;
+    if(sp_rd_f < sp_rd_min) sp_rd_min=sp_rd_f;
+    if(sp_rd_f > sp_rd_max) sp_rd_max=sp_rd_f;
+    sp_ir_sum += sp_ir_f >> 4; sp_rd_sum += sp_rd_f >> 4;
+    if(++sp_n >= sp_seg_len){ spo2_beat(); sp_n=0; }
+}
+
+// um intervalo entre picos: valida e atualiza SDNN/RMSSD/pNN50 em O(1)
+static void hrv_ibi(int32_t ibi){
+    if(ibi < (int32_t)(60000000.0f/BPM_MAX) || ibi > (int32_t)(60000000.0f/BPM_MIN)){
+        hrv_rej++; hrv_prev=0; return;
+    }
+    // referência: média dos NN aceitos (ou o anterior no começo)
+    int32_t ref = (hrv_n >= 3) ? (int32_t)(hrv_k + hrv_s/hrv_n) : hrv_prev;
+    if(ref > 0 && (int64_t)abs(ibi - ref)*100 > (int64_t)ref*HRV_IBI_TOL_PCT){
+        hrv_rej++; hrv_prev=0; return;
+    }
+    if(hrv_n == 0) hrv_k = ibi;
+    if(hrv_n == UINT16_MAX) return;
+    int64_t d = ibi - hrv_k;
+    hrv_s += d; hrv_s2 += d*d; hrv_n++;
+    if(hrv_prev > 0){
+        int64_t dd = ibi - hrv_prev;
+        hrv_sd2 += dd*dd; hrv_nd++;
+        if(dd > HRV_NN50_US || dd < -HRV_NN50_US) hrv_nn50++;
+    }
+    hrv_prev = ibi;
+
+    // resumo em float só 1x por batimento (n*S2 - S^2 exato em int64)
+    hrv_out.beats    = hrv_n;
+    hrv_out.rejected = hrv_rej;
+    hrv_out.mean_ibi_ms = ((float)hrv_k + (float)hrv_s/(float)hrv_n) * 1e-3f;
+    hrv_out.sdnn_ms  = (hrv_n > 1) ? sqrtf((float)(hrv_n*hrv_s2 - hrv_s*hrv_s) / ((float)hrv_n*(float)(hrv_n-1))) * 1e-3f : 0.0f;
+    hrv_out.rmssd_ms = hrv_nd ? sqrtf((float)hrv_sd2 / (float)hrv_nd) * 1e-3f : 0.0f;
+    hrv_out.pnn50    = hrv_nd ? 100.0f*(float)hrv_nn50 / (float)hrv_nd : 0.0f;
+}
 
+// IC de 95% do BPM médio pelos NN: BPM = 60/mean, h = 1.96*BPM*(SDNN/mean)/sqrt(n).
+// Pronto quando h <= ci_bpm e a estimativa da autocorrelação cai dentro de ±ci_bpm.
+static bool hrv_ci_ok(float est_bpm){
+    if(ci_bpm <= 0.0f || hrv_out.beats < OXI_CI_MIN_BEATS) return false;
+    float mean = hrv_out.mean_ibi_ms;
+    if(mean <= 0.0f) return false;
+    float bpm = 60000.0f / mean;
+    float h = 1.96f * bpm * (hrv_out.sdnn_ms / mean) / sqrtf((float)hrv_out.beats);
+    return h <= ci_bpm && fabsf(est_bpm - bpm) <= ci_bpm;
 }
 
-// autocorrelação normalizada na banda de lags
+// mais uma estimativa p/ a saída antecipada: true quando as OXI_CI_AGREE
+// últimas estão no IC e a ±ci_bpm umas das outras (*out = média delas)
+static bool ci_agree(float est_bpm, float *out){
+    if(!hrv_ci_ok(est_bpm)){ ci_n = 0; return false; }
+    for(int i=0;i<ci_n;i++){
+        if(fabsf(est_bpm - ci_est[i]) > ci_bpm){ ci_n = 0; break; }
+    }
+    ci_est[ci_n++] = est_bpm;
+    if(ci_n < OXI_CI_AGREE) return false;
+    float acc = 0.0f;
+    for(int i=0;i<ci_n;i++) acc += ci_est[i];
+    *out = acc / (float)ci_n;
+    ci_n = 0;
+    return true;
+}
+
+// pico confirmado: refina no vértice da parábola dos 3 pontos e mede o NN
+static void pk_commit(void){
+    int32_t den = pk_l - 2*pk_val + pk_r;            // <= 0 no máximo
+    int32_t off = 0;
+    if(den < 0){
+        off = (int32_t)(((int64_t)(pk_l - pk_r) * 128) / den);
+        if(off > 128) off = 128;
+        if(off < -128) off = -128;
+    }
+    int32_t t = pk_i*256 + off;
+    if(pk_t_q8 >= 0){
+        if(t - pk_t_q8 < lag_min*256) return;        // refratário: fica o primeiro
+        hrv_ibi((int32_t)(((int64_t)(t - pk_t_q8) * 1000000) / (fs_hz*256)));
+    }
+    pk_t_q8 = t;
+}
+
+// por amostra (soma da média móvel): passa-alta IIR + limiar de meio envelope
+static inline void pk_push(int32_t x){
+    if(pk_n == 0) pk_dc = x*16;
+    pk_dc += (x*16 - pk_dc) >> hrv_dc_shift;
+    int32_t hp = (pk_dc >> 4) - x;                   // invertido: sístole p/ cima
+    int32_t i = pk_n++;
+
+    pk_env -= pk_env >> hrv_env_shift;
+    if(hp > pk_env) pk_env = hp;
+    if(i < fs_hz){ pk_last = hp; return; }
+
+    if(hp > pk_env/2){
+        if(!pk_above){ pk_above=true; pk_val=INT32_MIN; }
+        if(hp > pk_val){ pk_val=hp; pk_l=pk_last; pk_r=hp; pk_i=i; }
+        else if(i == pk_i+1) pk_r=hp;
+    }else if(pk_above){
+        pk_above=false;
+        if(i == pk_i+1) pk_r=hp;
+        pk_commit();
+    }
+    pk_last = hp;
+}
+
+// ====== SQI (qualidade por segmento) ======
+// Cada sqi_len amostras: clipping, índice de perfusão, curtose e cruzamentos
+// por zero (com histerese) do canal escolhido. Segmento bom segue p/ a
+// suavização/ACF/picos/SpO2; segmento ruim é só pulado: a janela emenda
+// (estraga só os pares que cruzam a emenda) em vez de recomeçar do zero.
+static bool sqi_good(void){
+    if(sq_gap) return false;
+    const int32_t clip = g_is30102 ? SQI_CLIP_30102 : SQI_CLIP_30100;
+    const int32_t *x = (use_ch==CH_IR) ? sq_ir : sq_rd;
+
+    int32_t mn = x[0], mx = x[0];
+    int64_t sum = 0;
+    for(int i=0;i<sqi_len;i++){
+        if(sq_ir[i] >= clip || sq_rd[i] >= clip) return false;
+        if(x[i] < mn) mn = x[i];
+        if(x[i] > mx) mx = x[i];
+        sum += x[i];
+    }
+    if(sum <= 0) return false;
+    float mean = (float)sum / (float)sqi_len;
+    float pi = (float)(mx - mn) / mean;
+    if(pi < SQI_PI_MIN || pi > SQI_PI_MAX) return false;
+
+    float m2 = 0.0f, m4 = 0.0f;
+    for(int i=0;i<sqi_len;i++){
+        float d = (float)x[i] - mean, d2 = d*d;
+        m2 += d2; m4 += d2*d2;
+    }
+    if(m2 <= 0.0f) return false;
+    if(m4 * (float)sqi_len > SQI_KURT_MAX * m2 * m2) return false;  // m4/m2^2 (normalizado)
+
+    // cruzamentos numa média de 4 (corta o ruído de amostra) com histerese de 1 sigma
+    float h = sqrtf(m2 / (float)sqi_len);
+    int zc = 0, side = 0;
+    int64_t b4 = (int64_t)x[0] + x[1] + x[2];
+    for(int i=3;i<sqi_len;i++){
+        b4 += x[i];
+        float d = (float)b4 * 0.25f - mean;
+        b4 -= x[i-3];
+        int sd = d > h ? 1 : (d < -h ? -1 : 0);
+        if(sd && sd != side){ if(side) zc++; side = sd; }
+    }
+    return zc <= sqi_zc_max;
+}
+
+static void sqi_feed(int32_t ir, int32_t red){
+    int32_t raw = (use_ch==CH_IR) ? ir : red;
+    smooth_push(raw); // suaviza alto-freq
+    spo2_push(ir, red);
+    // enche janela de autocorrelação (6s) só com a média móvel cheia
+    if(smooth_n == smooth_len){ ac_push(smooth_sum); pk_push(smooth_sum); }
+}
+
+// segmento descartado: a média móvel recomeça, o detector perde o batimento
+// em curso (sem NN que cruze o buraco) e o segmento de SpO2 aberto é jogado fora
+static void sqi_mask(void){
+    smooth_n=0; smooth_head=0; smooth_sum=0;
+    pk_above=false; pk_t_q8=-1; hrv_prev=0;
+    sp_n=0;
+}
+
+static void sqi_push(int32_t ir, int32_t red){
+    sq_ir[sq_n] = ir; sq_rd[sq_n] = red;
+    if(++sq_n < sqi_len) return;
+    sq_n = 0;
+    g_timing.sqi_segments++;
+    if(sqi_good()){
+        for(int i=0;i<sqi_len;i++) sqi_feed(sq_ir[i], sq_rd[i]);
+    }else{
+        g_timing.sqi_masked++;
+        sqi_mask();
+    }
+    sq_gap = false;
+}
+
+// encerra a medição com o BPM final (e congela o SpO2)
+static void finish(float bpm, uint32_t now_ms){
+    g_timing.run_ms = now_ms - settle_done_ms;
+#if OXI_LOG
+    printf("oxi: DONE %.1f bpm em %lu ms (LED ir=%u red=%u faixa=%u passos=%u dc=%ld/%ld)\n",
+           bpm, (unsigned long)g_timing.run_ms, g_agc.led_ir, g_agc.led_red, g_agc.adc_range,
+           g_agc.steps, (long)g_agc.dc_ir, (long)g_agc.dc_red);
+#endif
+    bpm_final = bpm;
+    spo2_final = spo2_live;
+    spo2_final_ok = (sp_good >= SPO2_GOOD_BEATS);
+    g_state = OXI_DONE;
+}
+
+#if OXI_FIXED_POINT
+// Versão inteira: trabalha com N*R[k] (int64, exato) e só normaliza por R[0]
+// no pico e vizinhos, em Q15. |x| < 2^21 (smooth_len <= 7) e N <= 600 (100 Hz)
+// => todos os termos < 2^62.
+static inline int32_t ac_q15(int64_t v, int64_t r0, int sh){
+    return (int32_t)(((v >> sh) * 32768) / (r0 >> sh));
+}
+
+// Janela crescente: a partir de ac_min, sobre as ac_n amostras que
+// houver. R[k] é normalizado por (N-k) pares (não viesado): com N pequeno o
+// viés N-k puxaria o pico p/ lags curtos (BPM alto).
+static bool ac_estimate_bpm(float *out_bpm, float *out_q){
+    if(ac_n < ac_min) return false;
+
+    const int64_t N = ac_n;
+    int64_t tot = ac_sum;
+    int64_t t2n = (tot*tot) / N;      // T^2/N
+
+    // energia no zero-lag: N*R[0] = N*S0 - T^2
+    int64_t r0 = N*ac_s0 - tot*tot;
+    if(r0 <= 0) return false;
+
+    // N*R[k] = N*S[k] - T*(A+B) + n*T^2/N, depois /(N-k); R[0] idem /N
+    static int64_t r[AC_NLAGS_MAX];
+    int64_t head=0, tail=0;
+    int first = (ac_n == ac_len) ? ac_head : 0;   // mais antiga
+    for(int k=1; k<=lag_max; k++){
+        int ih = first + (k-1);            if(ih >= ac_len) ih -= ac_len;
+        int it = first + (int)(N - k);     if(it >= ac_len) it -= ac_len;
+        head += ac_buf[ih];
+        tail += ac_buf[it];
+        if(k < lag_min) continue;
+        int64_t ab = (tot - tail) + (tot - head);
+        r[k-lag_min] = (N*ac_sk[k-lag_min] - tot*ab + (N - k)*t2n) / (N - k);
+    }
+    r0 /= N;
+    if(r0 <= 0) return false;
+
+    // busca pelo pico em k in [lag_min..lag_max] (R[0] > 0 não muda o argmax)
+    int best_k = lag_min;
+    for(int k=lag_min+1; k<=lag_max; k++){
+        if(r[k-lag_min] > r[best_k-lag_min]) best_k = k;
+    }
+    // sem viés, R[T] ~ R[2T]: fica com o primeiro pico local quase tão alto
+    int64_t rb = r[best_k-lag_min];
+    for(int k=lag_min+1; k<best_k && rb > 0; k++){
+        int64_t v = r[k-lag_min];
+        if(v >= r[k-1-lag_min] && v >= r[k+1-lag_min] && v*100 >= rb*SUBHARM_PCT){ best_k = k; break; }
+    }
+
+    // reduz p/ 30 bits antes de dividir (|R[k]| <= R[0])
+    int sh = 0;
+    while((r0 >> sh) > 0x3FFFFFFF) sh++;
+    int32_t qk = ac_q15(r[best_k-lag_min], r0, sh);
+
+    if(best_k> lag_min && best_k< lag_max){
+        // interpolação parabólica em Q15: delta = (a-c) / (2*(a-2b+c))
+        int32_t qa = ac_q15(r[best_k-1-lag_min], r0, sh);
+        int32_t qc = ac_q15(r[best_k+1-lag_min], r0, sh);
+        int32_t denom = qa - 2*qk + qc;
+        int32_t delta = 0;
+        if(denom != 0) delta = (int32_t)(((int64_t)(qa - qc) * 16384) / denom);
+        if(delta < -32768) delta = -32768;
+        if(delta >  32768) delta =  32768;
+        int32_t k_q15 = (best_k << 15) + delta;
+
+        // BPM = 60*Fs/k, em Q8
+        int32_t bpm_q8 = (int32_t)(((int64_t)(60 * fs_hz) << 23) / k_q15);
+        *out_bpm = (float)bpm_q8 * (1.0f/256.0f);
+    } else {
+        *out_bpm = (float)((60 * fs_hz * 256) / best_k) * (1.0f/256.0f);
+    }
+    *out_q = (float)qk * (1.0f/32768.0f); // qualidade ~ correlação no pico
+
+    return true;
+}
+#else
+// autocorrelação normalizada na banda de lags, a partir das somas móveis.
+// Com m = média da janela, n = N-k, A = sum x[0..n-1], B = sum x[k..N-1]:
+//   R[k] = sum (x[i]-m)(x[i+k]-m) = S[k] - m*(A+B) + n*m^2
+// A e B saem da soma total menos as k amostras das pontas => O(lag_max).
+// Janela crescente (>= ac_min); R[k]/(N-k) contra R[0]/N, sem viés.
 static bool ac_estimate_bpm(float *out_bpm, float *out_q){
-    if(ac_n < AC_SAMPLES) return false; // precisa janela cheia p/ estabilidade
+    if(ac_n < ac_min) return false;
 
-    // cópia de trabalho
-    static float x[AC_SAMPLES];
-    ac_copy_demean(x);
+    const int N = ac_n;
+    double tot  = (double)ac_sum;
+    double mean = tot / (double)N;
 
-    // energia no zero-lag (R[0])
-    double r0=0.0;
-    for(int i=0;i<AC_SAMPLES;i++){ r0 += (double)x[i]*(double)x[i]; }
+    // energia no zero-lag (R[0]/N)
+    double r0 = ((double)ac_s0 - mean*tot) / (double)N;
     if(r0 <= 1e-6) return false;
 
+    static double r[AC_NLAGS_MAX];
+    int64_t head=0, tail=0;           // soma das k primeiras / k últimas amostras
+    int first = (ac_n == ac_len) ? ac_head : 0;   // mais antiga
+    for(int k=1; k<=lag_max; k++){
+        int ih = first + (k-1);            if(ih >= ac_len) ih -= ac_len;
+        int it = first + (N - k);          if(it >= ac_len) it -= ac_len;
+        head += ac_buf[ih];
+        tail += ac_buf[it];
+        if(k < lag_min) continue;
+        double a = (double)(ac_sum - tail);
+        double b = (double)(ac_sum - head);
+        double n = (double)(N - k);
+        // normaliza por R0 (mantém escala comparável)
+        r[k-lag_min] = ((double)ac_sk[k-lag_min] - mean*(a+b) + n*mean*mean) / (n*r0);
+    }
+
     int best_k = 0;
     double best_r = -1e30;
 
-    // busca pelo pico em k in [LAG_MIN..LAG_MAX]
-    for(int k=LAG_MIN; k<=LAG_MAX; k++){
-        double rk=0.0;
-        int n = AC_SAMPLES - k;
-        for(int i=0;i<n; i++){
-            rk += (double)x[i]*(double)x[i+k];
-        }
-        // normaliza por R0 e por n (mantém escala comparável)
-        rk /= r0;
-        if(rk > best_r){
-            best_r = rk;
+    // busca pelo pico em k in [lag_min..lag_max]
+    for(int k=lag_min; k<=lag_max; k++){
+        if(r[k-lag_min] > best_r){
+            best_r = r[k-lag_min];
             best_k = k;
         }
     }
+    // sem viés, R[T] ~ R[2T]: fica com o primeiro pico local quase tão alto
+    for(int k=lag_min+1; k<best_k && best_r > 0.0; k++){
+        double v = r[k-lag_min];
+        if(v >= r[k-1-lag_min] && v >= r[k+1-lag_min] && v*100.0 >= best_r*SUBHARM_PCT){ best_k = k; best_r = v; break; }
+    }
 
     // interpolação parabólica p/ subamostra (melhora ~1–2 bpm)
-    if(best_k> LAG_MIN && best_k< LAG_MAX){
-        double rkm1=0.0, rkp1=0.0, rkk=0.0;
-        int n0 = AC_SAMPLES - (best_k-1);
-        for(int i=0;i<n0;i++) rkm1 += (double)x[i]*(double)x[i+best_k-1];
-        int n1 = AC_SAMPLES - best_k;
-        for(int i=0;i<n1;i++) rkk  += (double)x[i]*(double)x[i+best_k];
-        int n2 = AC_SAMPLES - (best_k+1);
-        for(int i=0;i<n2;i++) rkp1 += (double)x[i]*(double)x[i+best_k+1];
-        rkm1/=r0; rkk/=r0; rkp1/=r0;
+    if(best_k> lag_min && best_k< lag_max){
+        double rkm1 = r[best_k-1-lag_min], rkk = r[best_k-lag_min], rkp1 = r[best_k+1-lag_min];
         double denom = (rkm1 - 2.0*rkk + rkp1);
         double delta = 0.0;
         if(fabs(denom) > 1e-9) delta = 0.5*(rkm1 - rkp1)/denom; // -b/2a
@@ -250,37 +742,286 @@ static bool ac_estimate_bpm(float *out_bpm, float *out_q){
         if(delta >  1.0) k_refined = (double)best_k + 1.0;
 
         // BPM = 60*Fs/k
-        float bpm = (float)(60.0 * (double)FS_HZ / k_refined);
+        float bpm = (float)(60.0 * (double)fs_hz / k_refined);
         *out_bpm = bpm;
         *out_q   = (float)rkk; // qualidade ~ correlação no pico
     } else {
-        float bpm = (float)(60.0f * (float)FS_HZ / (float)best_k);
+        float bpm = (float)(60.0f * (float)fs_hz / (float)best_k);
         *out_bpm = bpm;
         *out_q   = (float)best_r;
     }
 
+    return true;
+}
+#endif
+
+// ====== Motor espectral (banco de Goertzel) ======
+// Potência em GZ_NBINS frequências da banda BPM_MIN..BPM_MAX sobre a mesma
+// janela (ac_buf), decimada 2x (soma de pares => fs_hz/2). Laço inteiro
+// (coeficientes Q29, estado int64); float só p/ a potência de cada bin.
+// Janela retangular: lóbulo principal de ±60/T bpm (±10 @6 s), refinado
+// por interpolação parabólica entre bins.
+#define GZ_STEP_BPM           2
+#define GZ_NBINS              (((int)BPM_MAX - (int)BPM_MIN) / GZ_STEP_BPM + 1)   // 71
+#define GZ_DECIM              2
+#define GZ_SUBHARM_PCT        30      // metade da freq. com >=30% da potência => era o 2º harmônico
+
+static int32_t gz_coef[GZ_NBINS];     // 2*cos(w) em Q29
+static int32_t gz_y[AC_SAMPLES_MAX / GZ_DECIM];
+static float   gz_p[GZ_NBINS];
+static bool    gz_ready=false;
+
+static void gz_init(void){
+    const double fs = (double)fs_hz / GZ_DECIM;
+    for(int b=0; b<GZ_NBINS; b++){
+        double w = 6.283185307179586 * ((double)BPM_MIN + b*GZ_STEP_BPM) / 60.0 / fs;
+        gz_coef[b] = (int32_t)lround(2.0*cos(w) * (double)(1<<29));
+    }
+    gz_ready = true;
+}
 
+static bool gz_estimate_bpm(float *out_bpm, float *out_q){
+    if(ac_n < ac_min) return false;
+    if(!gz_ready) gz_init();
+
+    // pares completos mais recentes (descarta a mais antiga se ac_n for ímpar)
+    int first = (ac_n == ac_len) ? ac_head : 0;
+    int64_t tot = ac_sum;
+    if(ac_n & 1){ tot -= ac_buf[first]; if(++first >= ac_len) first -= ac_len; }
+    const int M = ac_n / GZ_DECIM;
+    const int32_t mean2 = (int32_t)((tot * GZ_DECIM) / (M * GZ_DECIM));
+
+    int32_t amax = 0;
+    for(int j=0, i=first; j<M; j++){
+        int32_t a = ac_buf[i]; if(++i >= ac_len) i -= ac_len;
+        int32_t b = ac_buf[i]; if(++i >= ac_len) i -= ac_len;
+        int32_t y = a + b - mean2;
+        gz_y[j] = y;
+        int32_t ay = y < 0 ? -y : y;
+        if(ay > amax) amax = ay;
+    }
+    // |y| < 2^18 => estado < 2^28 (ganho do ressonador ~M/(2 sin w)), c*s < 2^59
+    int sh = 0;
+    while((amax >> sh) >= (1<<18)) sh++;
+    int64_t e = 0;
+    for(int j=0; j<M; j++){ gz_y[j] >>= sh; e += (int64_t)gz_y[j]*gz_y[j]; }
+    if(e <= 0) return false;
+
+    int best = 0;
+    for(int b=0; b<GZ_NBINS; b++){
+        const int64_t c = gz_coef[b];
+        int64_t s1=0, s2=0;
+        for(int j=0; j<M; j++){
+            int64_t s0 = gz_y[j] + ((c*s1) >> 29) - s2;
+            s2 = s1; s1 = s0;
+        }
+        float f1 = (float)s1, f2 = (float)s2, cf = (float)c * (1.0f/(float)(1<<29));
+        gz_p[b] = f1*f1 + f2*f2 - cf*f1*f2;
+        if(gz_p[b] > gz_p[best]) best = b;
+    }
 
+    // 2º harmônico mais forte que a fundamental: volta p/ a metade
+    float bpm_best = BPM_MIN + best*GZ_STEP_BPM;
+    int hb = (int)((bpm_best*0.5f - BPM_MIN) / GZ_STEP_BPM + 0.5f);
+    if(bpm_best*0.5f >= BPM_MIN && hb >= 0){
+        int lo = hb > 0 ? hb-1 : 0, hi = hb+1 < GZ_NBINS ? hb+1 : GZ_NBINS-1;
+        int hm = lo;
+        for(int b=lo+1; b<=hi; b++) if(gz_p[b] > gz_p[hm]) hm = b;
+        if(gz_p[hm]*100.0f >= gz_p[best]*GZ_SUBHARM_PCT) best = hm;
+    }
 
-
+    float delta = 0.0f;
+    if(best > 0 && best < GZ_NBINS-1){
+        float a = gz_p[best-1], b = gz_p[best], c = gz_p[best+1];
+        float den = a - 2.0f*b + c;
+        if(den < 0.0f) delta = 0.5f*(a - c)/den;
+        if(delta < -1.0f) delta = -1.0f;
+        if(delta >  1.0f) delta =  1.0f;
+    }
+    *out_bpm = BPM_MIN + ((float)best + delta)*GZ_STEP_BPM;
+    // fração da energia no tom: 2|X|^2/(M*E) = 1 p/ senoide pura
+    *out_q = 2.0f*gz_p[best] / ((float)M * (float)e);
     return true;
 }
 
-// ====== Leitura sample ======
-static bool read_sample(float *ir_f, float *red_f){
-    if(!g_inited) return false;
+// ====== Jitter de aquisição ======
+// Para cada rajada de n amostras, |dt - n*T| mede o quanto o carimbo de tempo
+// da amostra mais nova se afasta do relógio do sensor (polling: até ~1 período).
+static void timing_note_batch(uint32_t t_us, int n){
+    if(g_timing.batches){
+        int32_t e = (int32_t)(t_us - timing_last_us) - (int32_t)(n*period_us);
+        uint32_t ae = (uint32_t)(e < 0 ? -e : e);
+        if(ae > g_timing.jitter_max_us) g_timing.jitter_max_us = ae;
+        // média móvel exponencial (1/16) p/ não precisar de soma longa
+        g_timing.jitter_mean_us += ((int32_t)ae - (int32_t)g_timing.jitter_mean_us) / 16;
+    }
+    timing_last_us = t_us;
+    g_timing.batches++;
+    g_timing.samples += (uint32_t)n;
+}
+
+// ====== Aquisição por interrupção (INT + DMA) ======
+// GPIO IRQ no INT (A_FULL) dispara uma leitura I2C por DMA: o canal TX envia
+// o endereço 0x07 + 102 comandos de leitura ao IC_DATA_CMD e depois 0x00 + 1
+// leitura (INT_STATUS_1, que solta o INT p/ a próxima borda); o canal RX
+// copia os bytes para dma_buf. No fim do RX (DMA_IRQ_1) as amostras vão p/ o
+// ring, que o oxi_poll() consome. Assim o instante de cada rajada não
+// depende do laço principal (OLED, HTTP...).
+typedef struct { int32_t ir, red; uint32_t t_ms; } oxi_raw_t;
+
+static uint g_int_pin=0;
+static volatile bool g_int_armed=false;      // aceita INT (medição ativa)
+static volatile bool dma_busy=false;
+static volatile uint32_t dma_start_us=0, dma_start_ms=0, int_last_ms=0;
+static int dma_tx=-1, dma_rx=-1;
+static dma_channel_config dma_tx_cfg, dma_rx_cfg;
+static uint32_t dma_cmd[1 + IRQ_BURST_SAMPLES*6 + 2];
+static uint8_t  dma_buf[IRQ_BURST_SAMPLES*6 + 1];        // FIFO + INT_STATUS_1
+
+static oxi_raw_t ring[IRQ_RING_N];
+static volatile uint32_t ring_wr=0, ring_rd=0;   // SPSC: IRQ escreve, oxi_poll lê
+
+static void dma_burst_start(void){
+    i2c_hw_t *hw = i2c_get_hw(g_i2c);
+    hw->enable = 0; hw->tar = I2C_ADDR; hw->enable = 1;
+    dma_busy = true;
+    dma_start_us = time_us_32();
+    dma_start_ms = to_ms_since_boot(get_absolute_time());
+    dma_channel_configure(dma_rx, &dma_rx_cfg, dma_buf, &hw->data_cmd, sizeof dma_buf, false);
+    dma_channel_configure(dma_tx, &dma_tx_cfg, &hw->data_cmd, dma_cmd, count_of(dma_cmd), false);
+    dma_start_channel_mask((1u << dma_rx) | (1u << dma_tx));
+}
+
+static void oxi_int_cb(uint gpio, uint32_t events){
+    (void)events;
+    if(gpio != g_int_pin || !g_int_armed || dma_busy) return;
+    dma_burst_start();
+}
+
+static void oxi_dma_irq(void){
+    if(dma_rx < 0 || !dma_channel_get_irq1_status((uint)dma_rx)) return;
+    dma_channel_acknowledge_irq1((uint)dma_rx);
+
+    // A_FULL disparou com a 17ª amostra: ela é de ~dma_start
+    uint32_t t_us = dma_start_us;
+    uint32_t t_ms = dma_start_ms;
+    for(int i=0;i<IRQ_BURST_SAMPLES;i++){
+        if(ring_wr - ring_rd >= IRQ_RING_N){ g_timing.ring_drops++; continue; }
+        const uint8_t *q = &dma_buf[i*6];
+        oxi_raw_t *e = &ring[ring_wr & (IRQ_RING_N-1)];
+        e->red = (int32_t)((((uint32_t)q[0]<<16)|((uint32_t)q[1]<<8)|q[2]) & 0x3FFFF);
+        e->ir  = (int32_t)((((uint32_t)q[3]<<16)|((uint32_t)q[4]<<8)|q[5]) & 0x3FFFF);
+        e->t_ms = t_ms - (uint32_t)(IRQ_BURST_SAMPLES-1-i)*period_us/1000;
+        ring_wr++;
+    }
+    timing_note_batch(t_us, IRQ_BURST_SAMPLES);
+    int_last_ms = t_ms;
+    dma_busy = false;
+}
+
+// rajada travada (ex.: NACK): aborta os canais e limpa o abort do I2C
+static void dma_check_stuck(void){
+    if(!dma_busy || (time_us_32() - dma_start_us) < IRQ_DMA_TIMEOUT_US) return;
+    dma_channel_abort((uint)dma_tx);
+    dma_channel_abort((uint)dma_rx);
+    (void)i2c_get_hw(g_i2c)->clr_tx_abrt;
+    g_timing.dma_errors++;
+    dma_busy = false;
+}
+
+// espera a rajada em curso acabar (ou a dá por travada); chamar com INT desarmado
+static void dma_wait_idle(void){
+    uint32_t t0 = time_us_32();
+    while(dma_busy && (time_us_32() - t0) < IRQ_DMA_TIMEOUT_US) tight_loop_contents();
+    dma_check_stuck();
+}
+
+// ====== Leitura da FIFO ======
+// Lê todas as amostras pendentes (mais antiga primeiro). Retorna nº ou -1.
+static int read_samples(int32_t *ir_o, int32_t *red_o, uint8_t *ovf){
+    if(!g_inited) return -1;
+    int n;
     if(g_is30102){
-        uint32_t ir32, rd32; if(!max30102_read(&ir32, &rd32)) return false;
-        *ir_f = (float)ir32; *red_f = (float)rd32;
+        uint32_t ir32[FIFO_DEPTH_30102], rd32[FIFO_DEPTH_30102];
+        n = max30102_read_fifo(ir32, rd32, ovf);
+        for(int i=0;i<n;i++){ ir_o[i]=(int32_t)ir32[i]; red_o[i]=(int32_t)rd32[i]; }
     } else {
-        uint16_t ir16, rd16; if(!max30100_read(&ir16, &rd16)) return false;
-        *ir_f = (float)ir16; *red_f = (float)rd16;
+        uint16_t ir16[FIFO_DEPTH_30100], rd16[FIFO_DEPTH_30100];
+        n = max30100_read_fifo(ir16, rd16, ovf);
+        for(int i=0;i<n;i++){ ir_o[i]=ir16[i]; red_o[i]=rd16[i]; }
     }
+    return n;
+}
+
+// ====== Config de aquisição ======
+// códigos = índice na tabela; taxa máxima por largura de pulso no modo SpO2
+static const uint16_t SR_30102[8] = {50,100,200,400,800,1000,1600,3200};
+static const uint16_t PW_30102[4] = {69,118,215,411};
+static const uint16_t SR_MAX_30102[4] = {1600,1000,800,400};
+static const uint16_t SR_30100[8] = {50,100,167,200,400,600,800,1000};
+static const uint16_t PW_30100[4] = {200,400,800,1600};
+static const uint16_t SR_MAX_30100[4] = {1000,400,200,100};
+
+static int cfg_code(const uint16_t *t, int n, uint16_t v){
+    for(int i=0;i<n;i++) if(t[i]==v) return i;
+    return -1;
+}
+
+// preenche os padrões do sensor detectado e valida; 'out' só se ok
+static bool cfg_resolve(const oxi_config_t *in, oxi_config_t *out){
+    oxi_config_t c = {0};
+    if(in) c = *in;
+    if(!c.sample_rate_hz) c.sample_rate_hz = g_is30102 ? 400 : 50;
+    if(!c.avg)            c.avg            = g_is30102 ? 8 : 1;
+    if(!c.pulse_width_us) c.pulse_width_us = g_is30102 ? 411 : 1600;
+
+    int sr = cfg_code(g_is30102 ? SR_30102 : SR_30100, 8, c.sample_rate_hz);
+    int pw = cfg_code(g_is30102 ? PW_30102 : PW_30100, 4, c.pulse_width_us);
+    if(sr < 0 || pw < 0) return false;
+    if(c.sample_rate_hz > (g_is30102 ? SR_MAX_30102 : SR_MAX_30100)[pw]) return false;
+    if(g_is30102 ? (c.avg > 32 || (c.avg & (c.avg-1))) : c.avg != 1) return false;
+    if(c.sample_rate_hz % c.avg) return false;
+    int fs = c.sample_rate_hz / c.avg;
+    if(fs < OXI_FS_MIN_HZ || fs > OXI_FS_MAX_HZ) return false;
+    if(out) *out = c;
     return true;
 }
 
+// deriva janelas/lags da taxa efetiva; só com a aquisição parada
+static void cfg_apply(const oxi_config_t *c){
+    g_cfg = *c;
+    reg_sr  = (uint8_t)cfg_code(g_is30102 ? SR_30102 : SR_30100, 8, c->sample_rate_hz);
+    reg_pw  = (uint8_t)cfg_code(g_is30102 ? PW_30102 : PW_30100, 4, c->pulse_width_us);
+    reg_avg = 0; while((1u<<reg_avg) < c->avg) reg_avg++;
+
+    fs_hz      = c->sample_rate_hz / c->avg;
+    period_us  = 1000000u / (uint32_t)fs_hz;
+    lag_min    = fs_hz * 60 / (int)BPM_MAX - 1;   // 25 Hz: 180 bpm = 8.3 => 7
+    lag_max    = fs_hz * 60 / (int)BPM_MIN + 1;
+    ac_len     = fs_hz * AC_WIN_SEC;
+    ac_min     = 2 * lag_max;
+    settle_len = (fs_hz * 8) / 10;
+    sqi_len    = fs_hz / 2;
+    sqi_zc_max = (2 * (int)BPM_MAX * sqi_len) / (60 * fs_hz) + 2;
+
+    // mesma duração (~140 ms) da média curta; teto SMOOTH_N segura o int64 do estimador
+    smooth_len = (fs_hz * SMOOTH_N + FS_DEFAULT_HZ/2) / FS_DEFAULT_HZ;
+    if(smooth_len < 3) smooth_len = 3;
+    if(smooth_len > SMOOTH_N) smooth_len = SMOOTH_N;
+
+    // constantes de tempo dos IIR do detector de picos: ±1 shift por oitava
+    int oct = (fs_hz >= 71) ? 1 : (fs_hz < 36) ? -1 : 0;
+    hrv_dc_shift  = HRV_DC_SHIFT + oct;
+    hrv_env_shift = HRV_ENV_SHIFT + oct;
+
+    // INT parado: drena antes da FIFO encher (240 ms @100 Hz, 960 ms @25 Hz)
+    irq_watchdog_ms = (uint32_t)IRQ_WATCHDOG_SAMPLES * period_us / 1000;
+
+    gz_ready = false;                  // coeficientes dependem de fs
+}
+
 // ====== API ======
-bool oxi_init(i2c_inst_t *i2c, uint sda_pin, uint scl_pin){
+bool oxi_init(i2c_inst_t *i2c, uint sda_pin, uint scl_pin, const oxi_config_t *cfg){
     g_i2c=i2c; g_sda=sda_pin; g_scl=scl_pin;
 
 
@@ -295,6 +1036,11 @@ bool oxi_init(i2c_inst_t *i2c, uint sda_pin, uint scl_pin){
 
     uint8_t part=0; bool ok_part = rn(0xFF,&part,1);
     g_is30102 = ok_part && (part==0x15);
+    if(!g_is30102){ agc_ir=LED_CURR_30100_IR; agc_rd=LED_CURR_30100_RD; }
+
+    oxi_config_t c;
+    if(!cfg_resolve(cfg, &c)){ g_inited=false; g_state=OXI_ERROR; return false; }
+    cfg_apply(&c);
 
 
     bool init_ok = g_is30102 ? max30102_init() : max30100_init();
@@ -309,34 +1055,162 @@ bool oxi_init(i2c_inst_t *i2c, uint sda_pin, uint scl_pin){
     return true;
 }
 
-void oxi_start(void){
-    if(!g_inited){ g_state=OXI_ERROR; return; }
+bool oxi_start(const oxi_config_t *cfg){
+    if(!g_inited){ g_state=OXI_ERROR; return false; }
+    oxi_config_t c = g_cfg;
+    if(cfg && !cfg_resolve(cfg, &c)) return false;
+    // não mexe no barramento com rajada DMA em curso
+    g_int_armed=false;
+    dma_wait_idle();
+    cfg_apply(&c);
+    // cada medição começa da corrente padrão
+    if(g_is30102){ agc_ir=LED_CURR; agc_rd=LED_CURR; agc_range=LED_RANGE; }
+    else { agc_ir=LED_CURR_30100_IR; agc_rd=LED_CURR_30100_RD; agc_range=0; }
+    memset(&g_agc, 0, sizeof g_agc);
+    agc_publish();
     if(g_is30102) max30102_init(); else max30100_init();
 
-    sample_last_ms=0; settle_done_ms=0;
+    sample_last_ms=0; settle_done_ms=0; fifo_ovf_total=0;
+    memset(&g_timing, 0, sizeof g_timing);
+    g_timing.irq_mode = g_int_en;
+    ring_rd = ring_wr;
+    int_last_ms = to_ms_since_boot(get_absolute_time());
     finger_on=false; finger_on_ms=0; finger_off_ms=0;
     use_ch = CH_IR;
+    engine_run = engine_req;
     reset_buffers();
     g_state=OXI_WAIT_FINGER;
+    g_int_armed = g_int_en;
+    if(g_int_en) gpio_set_irq_enabled(g_int_pin, GPIO_IRQ_EDGE_FALL, true);   // oxi_quiesce() desliga
+    return true;
 }
 
-void oxi_abort(void){ g_state=OXI_IDLE; }
+void oxi_get_config(oxi_config_t *out){ if(out) *out = g_cfg; }
 
+bool oxi_config_valid(const oxi_config_t *cfg){
+    return g_inited && cfg_resolve(cfg, NULL);
+}
 
+void oxi_quiesce(void){
+    g_int_armed=false;
+    if(g_int_en) gpio_set_irq_enabled(g_int_pin, GPIO_IRQ_EDGE_FALL, false);
+    dma_wait_idle();
+}
 
-void oxi_poll(uint32_t now_ms){
-    if(g_state==OXI_IDLE || g_state==OXI_ERROR || g_state==OXI_DONE) return;
-    if(now_ms - sample_last_ms < SAMPLE_PERIOD_MS) return;
-    sample_last_ms = now_ms;
+void oxi_abort(void){ oxi_quiesce(); g_state=OXI_IDLE; }
 
-    float ir=0, red=0;
-    if(!read_sample(&ir, &red)) return;
+bool oxi_enable_int(uint int_pin){
+    if(!g_inited || !g_is30102) return false;   // MAX30100: segue por polling
+    if(g_int_en) return true;
 
+    int tx = dma_claim_unused_channel(false);
+    int rx = dma_claim_unused_channel(false);
+    if(tx < 0 || rx < 0){
+        if(tx >= 0) dma_channel_unclaim((uint)tx);
+        if(rx >= 0) dma_channel_unclaim((uint)rx);
+        return false;
+    }
+    dma_tx = tx; dma_rx = rx;
+
+    // comandos: endereço do FIFO_DATA e 102 leituras (RESTART na 1ª); depois
+    // endereço do INT_STATUS_1 e 1 leitura com STOP
+    int c = 0;
+    dma_cmd[c++] = 0x07;
+    for(int i=0;i<IRQ_BURST_SAMPLES*6;i++) dma_cmd[c++] = I2C_IC_DATA_CMD_CMD_BITS | (i==0 ? I2C_IC_DATA_CMD_RESTART_BITS : 0);
+    dma_cmd[c++] = 0x00 | I2C_IC_DATA_CMD_RESTART_BITS;
+    dma_cmd[c++] = I2C_IC_DATA_CMD_CMD_BITS | I2C_IC_DATA_CMD_RESTART_BITS | I2C_IC_DATA_CMD_STOP_BITS;
+
+    dma_tx_cfg = dma_channel_get_default_config((uint)dma_tx);
+    channel_config_set_transfer_data_size(&dma_tx_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma_tx_cfg, true);
+    channel_config_set_write_increment(&dma_tx_cfg, false);
+    channel_config_set_dreq(&dma_tx_cfg, i2c_get_dreq(g_i2c, true));
+
+    dma_rx_cfg = dma_channel_get_default_config((uint)dma_rx);
+    channel_config_set_transfer_data_size(&dma_rx_cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&dma_rx_cfg, false);
+    channel_config_set_write_increment(&dma_rx_cfg, true);
+    channel_config_set_dreq(&dma_rx_cfg, i2c_get_dreq(g_i2c, false));
+
+    dma_channel_set_irq1_enabled((uint)dma_rx, true);
+    irq_add_shared_handler(DMA_IRQ_1, oxi_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    // INT é open-drain ativo em baixo
+    g_int_pin = int_pin;
+    gpio_init(int_pin);
+    gpio_set_dir(int_pin, GPIO_IN);
+    gpio_pull_up(int_pin);
+    g_int_en = true;
+    if(!max30102_init()){ g_int_en=false; return false; }
+    gpio_set_irq_enabled_with_callback(int_pin, GPIO_IRQ_EDGE_FALL, true, oxi_int_cb);
+    return true;
+}
 
 
 
+// ====== AGC ======
+static void settle_reset(void){
+    st_n=0; st_s_ir=st_s2_ir=st_s_rd=st_s2_rd=0;
+}
+
+// escreve no sensor sem disputar o barramento com uma rajada DMA em curso
+static void agc_write(void){
+    bool armed = g_int_armed;
+    g_int_armed = false;
+    dma_wait_idle();
+    if(g_is30102){
+        w8(0x0A,(uint8_t)((agc_range<<5)|(reg_sr<<2)|reg_pw));
+        w8(0x0C,agc_rd);
+        w8(0x0D,agc_ir);
+    }else{
+        w8(0x09,(uint8_t)((agc_rd<<4)|agc_ir));
+    }
+    g_int_armed = armed;
+}
+
+// corrente desejada p/ levar o DC ao alvo (proporcional; saturado => metade)
+static int agc_want(int cur, int32_t dc, int32_t fs){
+    if(dc >= fs - fs/64) return cur/2;
+    if(dc*100 >= fs*AGC_LO_PCT && dc*100 <= fs*AGC_HI_PCT) return cur;
+    if(dc < 1) dc = 1;
+    return (int)(((int64_t)cur * fs * AGC_TARGET_PCT) / ((int64_t)dc * 100));
+}
+
+// um passo do laço; true se mudou algo (e escreveu no sensor)
+static bool agc_step(int32_t dc_ir, int32_t dc_rd){
+    if(g_agc.steps >= AGC_MAX_STEPS) return false;
+    const int32_t fs = g_is30102 ? 0x3FFFF : 0xFFFF;
+    const int lmax = g_is30102 ? 0xFF : 0x0F;
+    int ir = agc_want(agc_ir, dc_ir, fs);
+    int rd = agc_want(agc_rd, dc_rd, fs);
+    int range = agc_range;
+
+    // MAX30102: LED no limite => troca a faixa do ADC (cada passo dobra/divide as contagens)
+    if(g_is30102){
+        if((ir > lmax || rd > lmax) && range > 0){ range--; ir /= 2; rd /= 2; }
+        else if((ir < 1 || rd < 1) && range < 3){ range++; ir *= 2; rd *= 2; }
+    }
+    if(ir < 1) ir = 1;
+    if(rd < 1) rd = 1;
+    if(ir > lmax) ir = lmax;
+    if(rd > lmax) rd = lmax;
+    if(ir == agc_ir && rd == agc_rd && range == agc_range) return false;
+
+    agc_ir = (uint8_t)ir; agc_rd = (uint8_t)rd; agc_range = (uint8_t)range;
+    agc_write();
+    agc_publish();
+    g_agc.steps++;
+    return true;
+}
+
+// processa uma amostra (gate de dedo + máquina de estados); now_ms = instante da amostra
+static void process_sample(int32_t ir, int32_t red, uint32_t now_ms){
+    if(g_state==OXI_IDLE || g_state==OXI_ERROR || g_state==OXI_DONE) return;
+    if(g_tap) g_tap(now_ms, ir, red);
+
     // finger gate no IR cru
-    float gate = finger_gate_min();
+    int32_t gate = finger_gate_min();
     if(ir > gate){
         if(!finger_on){
             if(finger_on_ms==0) finger_on_ms=now_ms;
@@ -360,100 +1234,119 @@ void oxi_poll(uint32_t now_ms){
         if(finger_on){
             g_state=OXI_SETTLE;
             reset_buffers();
-
+            settle_reset();
+            agc_n=0; agc_skip=0; agc_s_ir=0; agc_s_rd=0;
+            g_agc.steps=0;
         }
         break;
 
 
     case OXI_SETTLE: {
-        static int sc=0;
-        static double s_ir=0, s2_ir=0, s_rd=0, s2_rd=0;
+        // AGC: amostras logo após uma mudança ainda são da config antiga
+        if(agc_skip){ agc_skip--; break; }
+        agc_s_ir += ir; agc_s_rd += red;
+        if(++agc_n == AGC_BLOCK){
+            bool changed = agc_step((int32_t)(agc_s_ir/AGC_BLOCK), (int32_t)(agc_s_rd/AGC_BLOCK));
+            agc_n=0; agc_s_ir=0; agc_s_rd=0;
+            if(changed){ agc_skip=AGC_SKIP; settle_reset(); break; }
+        }
 
-        s_ir  += ir; s2_ir += (double)ir*(double)ir;
-        s_rd  += red; s2_rd += (double)red*(double)red;
-        sc++;
+        st_s_ir  += ir; st_s2_ir += (int64_t)ir*ir;
+        st_s_rd  += red; st_s2_rd += (int64_t)red*red;
+        st_n++;
 
-        if(sc >= SETTLE_SAMPLES){
-            double m_ir = s_ir / sc, var_ir = fmax(1.0, (s2_ir/sc) - m_ir*m_ir);
-            double m_rd = s_rd / sc, var_rd = fmax(1.0, (s2_rd/sc) - m_rd*m_rd);
+        if(st_n >= settle_len){
+            // compara variâncias escaladas por n^2 (n*S2 - S^2), tudo inteiro
+            int64_t var_ir = (int64_t)st_n*st_s2_ir - st_s_ir*st_s_ir;
+            int64_t var_rd = (int64_t)st_n*st_s2_rd - st_s_rd*st_s_rd;
             use_ch = (var_ir >= var_rd) ? CH_IR : CH_RED;
 
-            sc=0; s_ir=s2_ir=s_rd=s2_rd=0;
+            g_agc.dc_ir = (int32_t)(st_s_ir/st_n);
+            g_agc.dc_red = (int32_t)(st_s_rd/st_n);
+            settle_reset();
             settle_done_ms=now_ms;
             g_state=OXI_RUN;
-
         }
         break;
     }
 
     case OXI_RUN: {
-        float raw = (use_ch==CH_IR) ? ir : red;
-        float y = smooth_push(raw); // suaviza alto-freq
-
-        // enche janela de autocorrelação (6s)
-        ac_push(y);
+        // qualidade por segmento; só segmentos bons entram na janela
+        sqi_push(ir, red);
 
-        // recalcula ~1x/s quando a janela está cheia
-        if(ac_n == AC_SAMPLES && (now_ms - ac_last_ms) >= AC_RECOMP_MS){
+        // recalcula ~1x/s já com a janela parcial (cresce até ac_len)
+        if(ac_n >= ac_min && (now_ms - ac_last_ms) >= AC_RECOMP_MS){
             ac_last_ms = now_ms;
             float est_bpm=0, q=0;
-            if(ac_estimate_bpm(&est_bpm, &q)){
+            uint32_t t0 = time_us_32();
+            bool got = (engine_run == OXI_ENGINE_GOERTZEL) ? gz_estimate_bpm(&est_bpm, &q)
+                                                           : ac_estimate_bpm(&est_bpm, &q);
+            uint32_t dt = time_us_32() - t0;
+            g_timing.estimates++;
+            if(dt > g_timing.estimate_us_max) g_timing.estimate_us_max = dt;
+            // estimativa ruim quebra a sequência da saída antecipada
+            if(!got || est_bpm<BPM_MIN || est_bpm>BPM_MAX || q<Q_MIN) ci_n = 0;
+            if(got){
                 // valida banda e qualidade
                 if(est_bpm>=BPM_MIN && est_bpm<=BPM_MAX && q>=Q_MIN){
                     // suaviza BPM live (EMA)
                     if(bpm_live<=0) bpm_live=est_bpm;
                     else bpm_live = 0.7f*bpm_live + 0.3f*est_bpm;
+                    sp_seg_len = (int)(60.0f*(float)fs_hz/bpm_live + 0.5f); // ~1 batimento
 
-                    // guarda no histórico p/ final
-                    if(est_n<EST_BUF) bpm_hist[est_n++]=est_bpm;
-                    else { for(int i=1;i<EST_BUF;i++) bpm_hist[i-1]=bpm_hist[i]; bpm_hist[EST_BUF-1]=est_bpm; }
-
-                    // checa estabilidade: últimas 4 dentro de ±10% do mediano
-                    if(est_n>=4){
-                        // calcula mediana
-                        float tmp[EST_BUF];
-                        for(int i=0;i<est_n;i++) tmp[i]=bpm_hist[i];
-                        for(int i=1;i<est_n;i++){ float x=tmp[i]; int j=i; while(j>0 && tmp[j-1]>x){tmp[j]=tmp[j-1]; j--; } tmp[j]=x; }
-                        float med = (est_n&1)? tmp[est_n/2]: 0.5f*(tmp[est_n/2-1]+tmp[est_n/2]);
-
-                        int ok=0;
-                        for(int i=est_n-4;i<est_n;i++){
-                            if(i<0) continue;
-                            float dev = fabsf(bpm_hist[i]-med)/fmaxf(1.0f, med);
-                            if(dev <= BAND_TOL_FRAC) ok++;
-                        }
-                        if(ok>=4) good_estimates++;
-
-                        if(good_estimates >= FINAL_GOOD_EST){
-                            // média aparada das últimas estimativas
-                            int n = est_n<6? est_n: 6; // usa até 6 mais recentes
-                            float arr[6];
-                            for(int i=0;i<n;i++) arr[i]=bpm_hist[est_n-n+i];
-                            // ordena
-                            for(int i=1;i<n;i++){ float x=arr[i]; int j=i; while(j>0 && arr[j-1]>x){arr[j]=arr[j-1]; j--; } arr[j]=x; }
-                            int s= (n>=4)? 1: 0, e=(n>=4)? n-1: n; // corta 1 em cada ponta se der
-                            double acc=0; for(int i=s;i<e;i++) acc+=arr[i];
-                            bpm_final = (float)(acc / (e-s));
-                            g_state = OXI_DONE;
+                    // saída antecipada: IC pelos batimentos já fechou
+                    float early;
+                    if(ci_agree(est_bpm, &early)){
+                        finish(early, now_ms);
+                    }
+                    // regra de estabilidade (fallback): só com a janela cheia
+                    else if(ac_n == ac_len){
+                        // guarda no histórico p/ final
+                        if(est_n<EST_BUF) bpm_hist[est_n++]=est_bpm;
+                        else { for(int i=1;i<EST_BUF;i++) bpm_hist[i-1]=bpm_hist[i]; bpm_hist[EST_BUF-1]=est_bpm; }
+
+                        // checa estabilidade: últimas 4 dentro de ±10% do mediano
+                        if(est_n>=4){
+                            // calcula mediana
+                            float tmp[EST_BUF];
+                            for(int i=0;i<est_n;i++) tmp[i]=bpm_hist[i];
+                            for(int i=1;i<est_n;i++){ float x=tmp[i]; int j=i; while(j>0 && tmp[j-1]>x){tmp[j]=tmp[j-1]; j--; } tmp[j]=x; }
+                            float med = (est_n&1)? tmp[est_n/2]: 0.5f*(tmp[est_n/2-1]+tmp[est_n/2]);
+
+                            int ok=0;
+                            for(int i=est_n-4;i<est_n;i++){
+                                if(i<0) continue;
+                                float dev = fabsf(bpm_hist[i]-med)/fmaxf(1.0f, med);
+                                if(dev <= BAND_TOL_FRAC) ok++;
+                            }
+                            if(ok>=4) good_estimates++;
+
+                            if(good_estimates >= FINAL_GOOD_EST){
+                                // média aparada das últimas estimativas
+                                int n = est_n<6? est_n: 6; // usa até 6 mais recentes
+                                float arr[6];
+                                for(int i=0;i<n;i++) arr[i]=bpm_hist[est_n-n+i];
+                                // ordena
+                                for(int i=1;i<n;i++){ float x=arr[i]; int j=i; while(j>0 && arr[j-1]>x){arr[j]=arr[j-1]; j--; } arr[j]=x; }
+                                int s= (n>=4)? 1: 0, e=(n>=4)? n-1: n; // corta 1 em cada ponta se der
+                                double acc=0; for(int i=s;i<e;i++) acc+=arr[i];
+                                finish((float)(acc / (e-s)), now_ms);
+                            }
                         }
                     }
                 }
             }
+        }
 
-            // timeout p/ não travar
-            if((now_ms - settle_done_ms) > TIMEOUT_MS && g_state==OXI_RUN){
-                if(est_n>=3){
-                    // fallback: média simples das estimativas
-                    double acc=0; for(int i=0;i<est_n;i++) acc+=bpm_hist[i];
-                    bpm_final = (float)(acc/est_n);
-                    g_state=OXI_DONE;
-                }else{
-                    g_state=OXI_WAIT_FINGER;
-                    reset_buffers();
-                }
-
-
-
+        // timeout p/ não travar (também quando a janela não chega a encher)
+        if((now_ms - settle_done_ms) > TIMEOUT_MS && g_state==OXI_RUN){
+            if(est_n>=3){
+                // fallback: média simples das estimativas
+                double acc=0; for(int i=0;i<est_n;i++) acc+=bpm_hist[i];
+                finish((float)(acc/est_n), now_ms);
+            }else{
+                g_state=OXI_WAIT_FINGER;
+                reset_buffers();
             }
         }
         break;
@@ -466,13 +1359,108 @@ void oxi_poll(uint32_t now_ms){
     }
 }
 
+// modo INT: consome o ring preenchido pelo DMA
+static void poll_ring(uint32_t now_ms){
+    static uint32_t drops_seen=0;
+    dma_check_stuck();
+    // ring cheio perdeu amostras: buraco no tempo p/ o SQI
+    uint32_t drops = g_timing.ring_drops;
+    if(drops < drops_seen) drops_seen = 0;               // zerado no oxi_start()
+    if(drops != drops_seen){ drops_seen = drops; if(g_state==OXI_RUN) sq_gap = true; }
+    while(ring_rd != ring_wr){
+        const oxi_raw_t *e = &ring[ring_rd & (IRQ_RING_N-1)];
+        process_sample(e->ir, e->red, e->t_ms);
+        ring_rd++;
+    }
+    if(g_state==OXI_IDLE || g_state==OXI_ERROR || g_state==OXI_DONE){ g_int_armed=false; return; }
+
+    // INT baixo sem rajada e já deu tempo de juntar 17: a borda veio com o
+    // INT desarmado (agc_write) e outra só vem depois de ler o status.
+    // Nenhuma IRQ chega aqui no meio: sem borda nova com o INT baixo e o
+    // DMA_IRQ só com rajada em curso. (INT preso em baixo: 1 rajada a cada 17.)
+    if(!dma_busy && !gpio_get(g_int_pin) &&
+       (now_ms - int_last_ms) * 1000u >= (uint32_t)IRQ_BURST_SAMPLES * period_us){ dma_burst_start(); return; }
+
+    // INT não veio (pino solto): drena por polling no próximo oxi_poll(),
+    // sem IRQ no meio p/ não disputar o barramento
+    if(!dma_busy && (now_ms - int_last_ms) >= irq_watchdog_ms){
+        gpio_set_irq_enabled(g_int_pin, GPIO_IRQ_EDGE_FALL, false);
+        int_last_ms = now_ms;
+        sample_last_ms = 0;
+        g_int_armed = false;
+        g_timing.irq_fallbacks++;
+    }
+}
+
+static void poll_once(uint32_t now_ms){
+    if(g_int_armed){ poll_ring(now_ms); return; }
+    if(now_ms - sample_last_ms < FIFO_POLL_MS) return;
+    sample_last_ms = now_ms;
+
+    int32_t ir[FIFO_DEPTH_MAX], red[FIFO_DEPTH_MAX];
+    uint8_t ovf=0;
+    int n = read_samples(ir, red, &ovf);
+    if(g_int_en){
+        // fallback do modo INT: depois de drenar, o INT_STATUS_1 solta o INT
+        // (o próximo A_FULL volta a dar borda) e as interrupções voltam
+        uint8_t st; rn(0x00,&st,1);
+        g_int_armed = true;
+        gpio_set_irq_enabled(g_int_pin, GPIO_IRQ_EDGE_FALL, true);
+    }
+    if(n <= 0) return;
+    timing_note_batch(time_us_32(), n);
+    fifo_ovf_total += ovf;
+    // buraco no tempo: o segmento corrente é descartado pelo SQI
+    if(ovf && g_state==OXI_RUN) sq_gap = true;
+
+    // a mais recente foi amostrada ~agora; as anteriores a cada período
+    for(int i=0;i<n;i++){
+        uint32_t t = now_ms - (uint32_t)(n-1-i)*period_us/1000;
+        process_sample(ir[i], red[i], t);
+    }
+}
+
+// mede o custo de CPU de cada chamada (inclui I2C bloqueante no polling)
+void oxi_poll(uint32_t now_ms){
+    if(g_state==OXI_IDLE || g_state==OXI_ERROR || g_state==OXI_DONE) return;
+    uint32_t t0 = time_us_32();
+    poll_once(now_ms);
+    uint32_t dt = time_us_32() - t0;
+    g_timing.poll_calls++;
+    g_timing.poll_us_total += dt;
+    if(dt > g_timing.poll_us_max) g_timing.poll_us_max = dt;
+}
+
 oxi_state_t oxi_get_state(void){ return g_state; }
 
 
 
+// o caminho mais adiantado: regra das estáveis ou saída antecipada (cada
+// estimativa concordante no IC vale FINAL_GOOD_EST/OXI_CI_AGREE)
 void oxi_get_progress(int *valid_count, int *target_valid){
-    if(valid_count)  *valid_count  = (good_estimates>FINAL_GOOD_EST? FINAL_GOOD_EST: good_estimates);
+    int n = good_estimates, e = ci_n * FINAL_GOOD_EST / OXI_CI_AGREE;
+    if(e > n) n = e;
+    if(valid_count)  *valid_count  = (n>FINAL_GOOD_EST? FINAL_GOOD_EST: n);
     if(target_valid) *target_valid = FINAL_GOOD_EST;
 }
 float oxi_get_bpm_live(void){ return bpm_live; }
-float oxi_get_bpm_final(void){ return bpm_final; }
\ No newline at end of file
+float oxi_get_bpm_final(void){ return bpm_final; }
+float oxi_get_spo2_live(bool *good){
+    if(good) *good = (sp_good >= SPO2_GOOD_BEATS);
+    return spo2_live;
+}
+float oxi_get_spo2_final(bool *good){
+    if(good) *good = spo2_final_ok;
+    return spo2_final;
+}
+bool oxi_get_hrv(oxi_hrv_t *out){
+    if(out) *out = hrv_out;
+    return hrv_out.beats >= HRV_MIN_BEATS && hrv_nd >= HRV_MIN_BEATS-1;
+}
+void oxi_get_agc(oxi_agc_t *out){ if(out) *out = g_agc; }
+void oxi_set_engine(oxi_engine_t e){ engine_req = e; }
+oxi_engine_t oxi_get_engine(void){ return engine_req; }
+void oxi_set_sample_tap(oxi_sample_tap_t tap){ g_tap = tap; }
+void oxi_set_early_ci(float half_width_bpm){ ci_bpm = half_width_bpm > 0.0f ? half_width_bpm : 0.0f; }
+uint32_t oxi_get_fifo_overflows(void){ return fifo_ovf_total; }
+void oxi_get_timing(oxi_timing_t *out){ if(out) *out = g_timing; }
\ No newline at end of file
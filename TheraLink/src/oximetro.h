@@ -19,25 +19,107 @@ typedef enum {
     OXI_ERROR
 } oxi_state_t;
 
+/* Estatísticas de tempo da aquisição (por rajada lida da FIFO) e custo de CPU.
+   jitter = |intervalo entre rajadas - n_amostras * período|, em us. */
+typedef struct {
+    bool     irq_mode;        // true = INT + DMA; false = polling do laço
+    uint32_t batches;         // rajadas lidas
+    uint32_t samples;         // amostras entregues ao pipeline
+    uint32_t jitter_max_us;   // pior caso
+    uint32_t jitter_mean_us;  // média (EMA 1/16)
+    uint32_t ring_drops;      // amostras descartadas com o ring cheio (modo INT)
+    uint32_t dma_errors;      // rajadas DMA abortadas (NACK/timeout)
+    uint32_t irq_fallbacks;   // INT parado: drenagens por polling do watchdog
+    uint32_t poll_calls;      // chamadas de oxi_poll() com medição ativa
+    uint32_t poll_us_max;     // CPU da pior chamada
+    uint64_t poll_us_total;
+    uint32_t estimates;       // estimativas de BPM calculadas
+    uint32_t estimate_us_max; // CPU da pior estimativa
+    uint32_t run_ms;          // fim do settle -> DONE (0 até terminar)
+    uint32_t sqi_segments;    // segmentos de 0.5 s avaliados pelo SQI
+    uint32_t sqi_masked;      // ... descartados (movimento/clipping/sem pulso)
+} oxi_timing_t;
+
+/* Controle automático dos LEDs (AGC) feito no OXI_SETTLE: corrente e faixa
+   do ADC escolhidas p/ o DC ficar entre 25% e 75% do fundo de escala. */
+typedef struct {
+    uint8_t  led_ir;          // MAX30102: 0..255 (0.2 mA/passo); MAX30100: 0..15
+    uint8_t  led_red;
+    uint8_t  adc_range;       // MAX30102: 0..3 (2048..16384 nA); MAX30100: 0
+    uint8_t  steps;           // ajustes feitos nesta medição
+    int32_t  dc_ir;           // DC no fim do settle (contagens do ADC)
+    int32_t  dc_red;
+} oxi_agc_t;
+
+/* Motor de estimativa do BPM sobre a janela de 6 s */
+typedef enum {
+    OXI_ENGINE_ACF = 0,       // autocorrelação (somas por lag incrementais)
+    OXI_ENGINE_GOERTZEL       // banco de Goertzel na banda 40–180 bpm
+} oxi_engine_t;
+
+/* Variabilidade da frequência cardíaca, batimento a batimento, acumulada
+   desde o início da fase RUN (intervalos NN entre picos sistólicos). */
+typedef struct {
+    uint16_t beats;           // intervalos NN aceitos
+    uint16_t rejected;        // descartados (fora da banda / artefato / ectópico)
+    float    mean_ibi_ms;
+    float    sdnn_ms;         // desvio-padrão dos NN
+    float    rmssd_ms;        // raiz da média dos quadrados das diferenças sucessivas
+    float    pnn50;           // % de diferenças sucessivas > 50 ms
+} oxi_hrv_t;
+
+/* Config de aquisição. Campo 0 = padrão do sensor detectado:
+   MAX30102 400 Hz / avg 8 / 411 us; MAX30100 50 Hz / avg 1 / 1600 us.
+   A taxa efetiva (sample_rate_hz / avg) precisa ser inteira e ficar em
+   OXI_FS_MIN_HZ..OXI_FS_MAX_HZ; janelas e lags saem dela em runtime. */
+#define OXI_FS_MIN_HZ   25
+#define OXI_FS_MAX_HZ   100
+
+typedef struct {
+    uint16_t sample_rate_hz;  // ADC. MAX30102: 50..3200; MAX30100: 50..1000
+    uint8_t  avg;             // média na FIFO. MAX30102: 1,2,4,8,16,32; MAX30100: 1
+    uint16_t pulse_width_us;  // MAX30102: 69/118/215/411; MAX30100: 200/400/800/1600
+} oxi_config_t;
+
 /* Inicializa contexto do oxímetro (define barramento/pinos e tenta detectar MAX30100/30102).
-   Retorna true se o dispositivo foi detectado e configurado. */
-bool oxi_init(i2c_inst_t *i2c, uint sda_pin, uint scl_pin);
+   'cfg' NULL = padrão. Retorna true se o dispositivo foi detectado e
+   configurado; false também se 'cfg' não for suportado pelo sensor. */
+bool oxi_init(i2c_inst_t *i2c, uint sda_pin, uint scl_pin, const oxi_config_t *cfg);
+
+/* Liga a aquisição por interrupção (só MAX30102): o pino INT (A_FULL) dispara
+   uma leitura da FIFO por DMA, fora do laço principal. Chamar após oxi_init().
+   Se o INT não chegar, oxi_poll() volta a drenar por polling. */
+bool oxi_enable_int(uint int_pin);
 
-/* Começa uma nova medição (limpa buffers/estado) */
-void oxi_start(void);
+/* Começa uma nova medição (limpa buffers/estado). 'cfg' NULL mantém a
+   config atual; config inválida p/ o sensor => false e nada muda. */
+bool oxi_start(const oxi_config_t *cfg);
 
-/* Cancela/para a medição atual e volta ao estado IDLE */
+/* Config em uso, já com os padrões resolvidos. Valida uma config contra o
+   sensor detectado (false antes do oxi_init). */
+void oxi_get_config(oxi_config_t *out);
+bool oxi_config_valid(const oxi_config_t *cfg);
+
+/* Cancela/para a medição atual e volta ao estado IDLE (faz oxi_quiesce()) */
 void oxi_abort(void);
 
+/* Desarma o INT e espera a rajada DMA em curso: depois disso o oxímetro só
+   volta ao barramento em oxi_poll() de uma medição ativa. Não muda o estado
+   (chamar após o DONE/ERROR antes de outro usar o mesmo I2C). */
+void oxi_quiesce(void);
+
 /* Deve ser chamado periodicamente (ex.: a cada ~10–20 ms).
    'now_ms' = to_ms_since_boot(get_absolute_time()).
-   Não bloqueia. */
+   A cada ~100 ms drena a FIFO do sensor numa rajada I2C e processa todas
+   as amostras pendentes; a FIFO segura ~640 ms (MAX30102) / ~320 ms (MAX30100)
+   de atraso do laço principal sem perder amostras. Não bloqueia. */
 void oxi_poll(uint32_t now_ms);
 
 /* Estado atual */
 oxi_state_t oxi_get_state(void);
 
-/* Progresso: retorna (valid_count, target) */
+/* Progresso: retorna (valid_count, target). Vale o caminho mais adiantado:
+   estimativas estáveis ou saída antecipada (ver oxi_set_early_ci). */
 void oxi_get_progress(int *valid_count, int *target_valid);
 
 /* Última estimativa “suave” (durante RUN) */
@@ -46,6 +128,45 @@ float oxi_get_bpm_live(void);
 /* Resultado final (após DONE). Retorna NAN se não houver. */
 float oxi_get_bpm_final(void);
 
+/* SpO2 (%) estimado por batimento (razão das razões RED/IR). NAN se ainda não
+   houver. '*good' (opcional) = qualidade ok: perfusão suficiente e últimos
+   batimentos concordantes. */
+float oxi_get_spo2_live(bool *good);
+
+/* SpO2 congelado no DONE (NAN se não houver) + flag de qualidade */
+float oxi_get_spo2_final(bool *good);
+
+/* HRV da medição corrente (congela no DONE). Retorna true quando já há
+   intervalos suficientes p/ os índices fazerem sentido. */
+bool oxi_get_hrv(oxi_hrv_t *out);
+
+/* Config de LED/ADC que o AGC deixou na medição corrente (também vai p/ o
+   stdout junto com o tempo até o DONE). */
+void oxi_get_agc(oxi_agc_t *out);
+
+/* Escolhe o motor de estimativa; vale a partir do próximo oxi_start().
+   Chamar no core que roda o oxímetro. */
+void oxi_set_engine(oxi_engine_t e);
+oxi_engine_t oxi_get_engine(void);
+
+/* Saída antecipada: a medição termina assim que o IC de 95% do BPM (pelos
+   intervalos batimento a batimento) tiver meia-largura <= half_width_bpm e 2
+   estimativas seguidas da autocorrelação caírem nele (BPM final = média
+   delas); senão segue a regra das 4 estimativas estáveis.
+   0 desliga. Padrão: 2 bpm. Chamar no core que roda o oxímetro. */
+void oxi_set_early_ci(float half_width_bpm);
+
+/* Tap das amostras cruas entregues ao pipeline (medição ativa). Roda dentro
+   de oxi_poll(), no core do oxímetro: não pode bloquear. NULL desliga. */
+typedef void (*oxi_sample_tap_t)(uint32_t t_ms, int32_t ir, int32_t red);
+void oxi_set_sample_tap(oxi_sample_tap_t tap);
+
+/* Amostras perdidas por overflow da FIFO desde o último oxi_start() */
+uint32_t oxi_get_fifo_overflows(void);
+
+/* Jitter/contadores da aquisição desde o último oxi_start() */
+void oxi_get_timing(oxi_timing_t *out);
+
 
 
 #ifdef __cplusplus
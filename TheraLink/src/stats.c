@@ -3,7 +3,10 @@
 #include <math.h>
 #include <stdio.h>
 
+#include "hardware/sync.h"
+
 #define MAX_BPM_SAMPLES 64
+#define JOURNAL_LEN     32   // últimas mudanças lembradas p/ o ?since= (potência de 2)
 
 // --------- Globais (gerais) ----------
 static float    s_bpm_buf[MAX_BPM_SAMPLES];
@@ -11,6 +14,12 @@ static uint32_t s_bpm_n = 0;
 
 static uint32_t s_cor[STAT_COLOR_COUNT] = {0};
 
+static uint32_t s_spo2_count = 0;
+static double   s_spo2_sum   = 0.0;
+
+static uint32_t s_hrv_count = 0;
+static double   s_rmssd_sum = 0.0, s_sdnn_sum = 0.0, s_pnn50_sum = 0.0;
+
 static uint32_t s_ans_count = 0;
 static double   s_ans_sum   = 0.0;
 
@@ -22,10 +31,30 @@ static double   s_humor_sum   = 0.0;
 
 static uint32_t s_sample_id = 0;
 
+// Journal de mudanças: uma entrada por sample_id (slot = id % JOURNAL_LEN)
+typedef struct {
+    uint32_t id;
+    uint8_t  fields;   // STAT_F_*
+    uint8_t  color;    // stat_color_t ou STAT_COLOR_NONE
+} journal_ent_t;
+static journal_ent_t s_journal[JOURNAL_LEN];
+
+// Log por sessão (ring; slot = id % STATS_SESSION_MAX)
+static stats_session_t s_sess[STATS_SESSION_MAX];
+static uint32_t        s_sess_last = 0;
+
 // --------- Por cor ----------
 static float    s_bpm_c[STAT_COLOR_COUNT][MAX_BPM_SAMPLES];
 static uint32_t s_bpm_n_c[STAT_COLOR_COUNT] = {0};
 
+static uint32_t s_spo2_count_c[STAT_COLOR_COUNT]   = {0};
+static double   s_spo2_sum_c[STAT_COLOR_COUNT]     = {0.0, 0.0, 0.0};
+
+static uint32_t s_hrv_count_c[STAT_COLOR_COUNT]    = {0};
+static double   s_rmssd_sum_c[STAT_COLOR_COUNT]    = {0.0, 0.0, 0.0};
+static double   s_sdnn_sum_c[STAT_COLOR_COUNT]     = {0.0, 0.0, 0.0};
+static double   s_pnn50_sum_c[STAT_COLOR_COUNT]    = {0.0, 0.0, 0.0};
+
 static uint32_t s_ans_count_c[STAT_COLOR_COUNT]    = {0};
 static double   s_ans_sum_c[STAT_COLOR_COUNT]      = {0.0, 0.0, 0.0};
 
@@ -69,6 +98,16 @@ static void push_bpm_buf(float *buf, uint32_t *pn, float bpm) {
     }
 }
 
+// main loop e callbacks do lwIP (survey) escrevem: seção crítica curta
+static void journal_note(uint8_t fields, stat_color_t color) {
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t id = s_sample_id + 1;
+    journal_ent_t *e = &s_journal[id % JOURNAL_LEN];
+    e->id = id; e->fields = fields; e->color = (uint8_t)color;
+    s_sample_id = id;
+    restore_interrupts(irq);
+}
+
 // --------- API ----------
 void appstats_init(void) {
     memset(s_bpm_buf, 0, sizeof(s_bpm_buf));
@@ -76,6 +115,8 @@ void appstats_init(void) {
 
     memset(s_cor, 0, sizeof(s_cor));
 
+    s_spo2_count = 0;  s_spo2_sum = 0.0;
+    s_hrv_count = 0;   s_rmssd_sum = s_sdnn_sum = s_pnn50_sum = 0.0;
     s_ans_count = 0;   s_ans_sum = 0.0;
     s_energy_count = 0; s_energy_sum = 0.0;
     s_humor_count = 0;  s_humor_sum = 0.0;
@@ -83,6 +124,14 @@ void appstats_init(void) {
     memset(s_bpm_c, 0, sizeof(s_bpm_c));
     memset(s_bpm_n_c, 0, sizeof(s_bpm_n_c));
 
+    memset(s_spo2_count_c, 0, sizeof(s_spo2_count_c));
+    memset(s_spo2_sum_c,   0, sizeof(s_spo2_sum_c));
+
+    memset(s_hrv_count_c, 0, sizeof(s_hrv_count_c));
+    memset(s_rmssd_sum_c, 0, sizeof(s_rmssd_sum_c));
+    memset(s_sdnn_sum_c,  0, sizeof(s_sdnn_sum_c));
+    memset(s_pnn50_sum_c, 0, sizeof(s_pnn50_sum_c));
+
     memset(s_ans_count_c, 0, sizeof(s_ans_count_c));
     memset(s_ans_sum_c,   0, sizeof(s_ans_sum_c));
 
@@ -93,6 +142,9 @@ void appstats_init(void) {
     memset(s_humor_sum_c,   0, sizeof(s_humor_sum_c));
 
     s_sample_id = 0;
+    memset(s_journal, 0, sizeof(s_journal));
+    memset(s_sess, 0, sizeof(s_sess));
+    s_sess_last = 0;
     s_current_color = (stat_color_t)STAT_COLOR_NONE;
 }
 
@@ -116,13 +168,41 @@ void appstats_add_bpm(float bpm) {
     if ((unsigned)s_current_color < STAT_COLOR_COUNT) {
         push_bpm_buf(s_bpm_c[s_current_color], &s_bpm_n_c[s_current_color], bpm);
     }
-    s_sample_id++;
+    journal_note(STAT_F_BPM, s_current_color);
+}
+
+void appstats_add_spo2(float spo2) {
+    if (!(spo2 >= 50.0f && spo2 <= 100.0f)) return;
+    s_spo2_sum   += (double)spo2;
+    s_spo2_count += 1;
+
+    if ((unsigned)s_current_color < STAT_COLOR_COUNT) {
+        s_spo2_sum_c[s_current_color]   += (double)spo2;
+        s_spo2_count_c[s_current_color] += 1;
+    }
+    journal_note(STAT_F_SPO2, s_current_color);
+}
+
+void appstats_add_hrv(float rmssd_ms, float sdnn_ms, float pnn50) {
+    if (!(rmssd_ms >= 0.0f && sdnn_ms >= 0.0f && pnn50 >= 0.0f && pnn50 <= 100.0f)) return;
+    s_rmssd_sum += (double)rmssd_ms;
+    s_sdnn_sum  += (double)sdnn_ms;
+    s_pnn50_sum += (double)pnn50;
+    s_hrv_count += 1;
+
+    if ((unsigned)s_current_color < STAT_COLOR_COUNT) {
+        s_rmssd_sum_c[s_current_color] += (double)rmssd_ms;
+        s_sdnn_sum_c[s_current_color]  += (double)sdnn_ms;
+        s_pnn50_sum_c[s_current_color] += (double)pnn50;
+        s_hrv_count_c[s_current_color] += 1;
+    }
+    journal_note(STAT_F_HRV, s_current_color);
 }
 
 void appstats_inc_color(stat_color_t c) {
     if ((unsigned)c < STAT_COLOR_COUNT) {
         s_cor[c]++;
-        s_sample_id++;
+        journal_note(STAT_F_CORES, c);
     }
 }
 
@@ -135,7 +215,7 @@ void appstats_add_anxiety(uint8_t level) {
         s_ans_sum_c[s_current_color]   += (double)level;
         s_ans_count_c[s_current_color] += 1;
     }
-    s_sample_id++;
+    journal_note(STAT_F_MOOD, s_current_color);
 }
 
 void appstats_add_energy(uint8_t level) {
@@ -147,7 +227,7 @@ void appstats_add_energy(uint8_t level) {
         s_energy_sum_c[s_current_color]   += (double)level;
         s_energy_count_c[s_current_color] += 1;
     }
-    s_sample_id++;
+    journal_note(STAT_F_MOOD, s_current_color);
 }
 
 void appstats_add_humor(uint8_t level) {
@@ -159,7 +239,31 @@ void appstats_add_humor(uint8_t level) {
         s_humor_sum_c[s_current_color]   += (double)level;
         s_humor_count_c[s_current_color] += 1;
     }
-    s_sample_id++;
+    journal_note(STAT_F_MOOD, s_current_color);
+}
+
+uint32_t appstats_get_sample_id(void) { return s_sample_id; }
+
+void appstats_note_change(uint8_t fields, stat_color_t color) {
+    journal_note(fields, color);
+}
+
+bool appstats_changes_since(uint32_t since, stat_color_t color, uint8_t *fields) {
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t cur = s_sample_id;
+    uint8_t f = 0;
+    bool ok = (since <= cur && cur - since <= JOURNAL_LEN);
+    for (uint32_t id = since + 1; ok && id <= cur; id++) {
+        const journal_ent_t *e = &s_journal[id % JOURNAL_LEN];
+        if (e->id != id) { ok = false; break; }
+        // mudança sem cor conta em toda visão; com cor, só na geral e na dela
+        if (e->color == (uint8_t)STAT_COLOR_NONE || (unsigned)color >= STAT_COLOR_COUNT ||
+            e->color == (uint8_t)color)
+            f |= e->fields;
+    }
+    restore_interrupts(irq);
+    if (fields) *fields = ok ? f : STAT_F_ALL;
+    return ok;
 }
 
 static void fill_snapshot_overall(stats_snapshot_t *out) {
@@ -168,6 +272,14 @@ static void fill_snapshot_overall(stats_snapshot_t *out) {
     out->bpm_count = s_bpm_n;
     out->bpm_mean_trimmed = trimmed_mean_1(s_bpm_buf, s_bpm_n);
 
+    out->spo2_count = s_spo2_count;
+    out->spo2_mean  = (s_spo2_count ? (float)(s_spo2_sum / (double)s_spo2_count) : NAN);
+
+    out->hrv_count  = s_hrv_count;
+    out->rmssd_mean = (s_hrv_count ? (float)(s_rmssd_sum / (double)s_hrv_count) : NAN);
+    out->sdnn_mean  = (s_hrv_count ? (float)(s_sdnn_sum  / (double)s_hrv_count) : NAN);
+    out->pnn50_mean = (s_hrv_count ? (float)(s_pnn50_sum / (double)s_hrv_count) : NAN);
+
     out->cor_verde    = s_cor[STAT_COLOR_VERDE];
     out->cor_amarelo  = s_cor[STAT_COLOR_AMARELO];
     out->cor_vermelho = s_cor[STAT_COLOR_VERMELHO];
@@ -200,6 +312,17 @@ void appstats_get_snapshot_by_color(stat_color_t color, stats_snapshot_t *out) {
     out->bpm_count = s_bpm_n_c[color];
     out->bpm_mean_trimmed = trimmed_mean_1(s_bpm_c[color], s_bpm_n_c[color]);
 
+    // SpO2 filtrado por cor
+    out->spo2_count = s_spo2_count_c[color];
+    out->spo2_mean  = (s_spo2_count_c[color] ? (float)(s_spo2_sum_c[color] / (double)s_spo2_count_c[color]) : NAN);
+
+    // HRV filtrada por cor
+    uint32_t hn = s_hrv_count_c[color];
+    out->hrv_count  = hn;
+    out->rmssd_mean = (hn ? (float)(s_rmssd_sum_c[color] / (double)hn) : NAN);
+    out->sdnn_mean  = (hn ? (float)(s_sdnn_sum_c[color]  / (double)hn) : NAN);
+    out->pnn50_mean = (hn ? (float)(s_pnn50_sum_c[color] / (double)hn) : NAN);
+
     // Contagem de cores: mantém só a da cor filtrada
     out->cor_verde    = (color == STAT_COLOR_VERDE   ? s_cor[STAT_COLOR_VERDE]   : 0);
     out->cor_amarelo  = (color == STAT_COLOR_AMARELO ? s_cor[STAT_COLOR_AMARELO] : 0);
@@ -216,6 +339,40 @@ void appstats_get_snapshot_by_color(stat_color_t color, stats_snapshot_t *out) {
     out->humor_mean  = (s_humor_count_c[color] ? (float)(s_humor_sum_c[color] / (double)s_humor_count_c[color]) : NAN);
 }
 
+// --------- Log por sessão ----------
+static float from_x10(uint16_t v) { return (float)v / 10.0f; }
+
+uint32_t appstats_session_add(stats_session_t *rec) {
+    if (!rec) return 0;
+    // leitores (/sessions.csv) rodam nos callbacks do lwIP: registro entra inteiro
+    uint32_t irq = save_and_disable_interrupts();
+    rec->id = s_sess_last + 1;
+    s_sess[rec->id % STATS_SESSION_MAX] = *rec;
+    s_sess_last = rec->id;
+    restore_interrupts(irq);
+
+    // agregados saem do próprio registro: O(1), sem reler o log
+    stat_color_t prev = s_current_color;
+    stats_inc_color((stat_color_t)rec->color_rec);
+    s_current_color = ((unsigned)rec->color_ok < STAT_COLOR_COUNT)
+                    ? (stat_color_t)rec->color_ok : (stat_color_t)STAT_COLOR_NONE;
+    if (rec->bpm_x10 != STATS_NA)  stats_add_bpm(from_x10(rec->bpm_x10));
+    if (rec->spo2_x10 != STATS_NA) stats_add_spo2(from_x10(rec->spo2_x10));
+    if (rec->rmssd_x10 != STATS_NA && rec->sdnn_x10 != STATS_NA && rec->pnn50_x10 != STATS_NA)
+        stats_add_hrv(from_x10(rec->rmssd_x10), from_x10(rec->sdnn_x10), from_x10(rec->pnn50_x10));
+    s_current_color = prev;
+    return rec->id;
+}
+
+bool appstats_session_get(uint32_t id, stats_session_t *out) {
+    const stats_session_t *r = &s_sess[id % STATS_SESSION_MAX];
+    if (id == 0 || r->id != id) return false;   // nunca gravado ou já sobrescrito
+    if (out) *out = *r;
+    return true;
+}
+
+uint32_t appstats_session_last_id(void) { return s_sess_last; }
+
 // CSV agregado para /download.csv
 size_t appstats_dump_csv(char *dst, size_t maxlen) {
     if (!dst || maxlen == 0) return 0;
@@ -228,24 +385,30 @@ size_t appstats_dump_csv(char *dst, size_t maxlen) {
     double ans_mean = isnan(s.ans_mean)         ? 0.0 : s.ans_mean;
     double ene_mean = isnan(s.energy_mean)      ? 0.0 : s.energy_mean;
     double hum_mean = isnan(s.humor_mean)       ? 0.0 : s.humor_mean;
+    double spo2_mean = isnan(s.spo2_mean)       ? 0.0 : s.spo2_mean;
+    double rmssd     = isnan(s.rmssd_mean)      ? 0.0 : s.rmssd_mean;
+    double sdnn      = isnan(s.sdnn_mean)       ? 0.0 : s.sdnn_mean;
+    double pnn50     = isnan(s.pnn50_mean)      ? 0.0 : s.pnn50_mean;
 
     size_t total = 0;
 
     int w = snprintf(dst + total, (total < maxlen) ? (maxlen - total) : 0,
-                     "bpm_mean,bpm_n,ans_mean,ans_n,energy_mean,energy_n,humor_mean,humor_n,cores_verde,cores_amarelo,cores_vermelho\r\n");
+                     "bpm_mean,bpm_n,ans_mean,ans_n,energy_mean,energy_n,humor_mean,humor_n,cores_verde,cores_amarelo,cores_vermelho,spo2_mean,spo2_n,rmssd_mean,sdnn_mean,pnn50_mean,hrv_n\r\n");
     if (w < 0) return total;
     total += (size_t)((w > 0) ? w : 0);
     if (total >= maxlen) return maxlen;
 
     w = snprintf(dst + total, (total < maxlen) ? (maxlen - total) : 0,
-                 "%.3f,%lu,%.3f,%lu,%.3f,%lu,%.3f,%lu,%lu,%lu,%lu\r\n",
+                 "%.3f,%lu,%.3f,%lu,%.3f,%lu,%.3f,%lu,%lu,%lu,%lu,%.1f,%lu,%.1f,%.1f,%.1f,%lu\r\n",
                  bpm_mean,  (unsigned long)s.bpm_count,
                  ans_mean,  (unsigned long)s.ans_count,
                  ene_mean,  (unsigned long)s.energy_count,
                  hum_mean,  (unsigned long)s.humor_count,
                  (unsigned long)s.cor_verde,
                  (unsigned long)s.cor_amarelo,
-                 (unsigned long)s.cor_vermelho);
+                 (unsigned long)s.cor_vermelho,
+                 spo2_mean, (unsigned long)s.spo2_count,
+                 rmssd, sdnn, pnn50, (unsigned long)s.hrv_count);
     if (w < 0) return total;
     total += (size_t)((w > 0) ? w : 0);
 
@@ -2,6 +2,8 @@
 #define stats_init                   appstats_init
 #define stats_set_current_color      appstats_set_current_color
 #define stats_add_bpm                appstats_add_bpm
+#define stats_add_spo2               appstats_add_spo2
+#define stats_add_hrv                appstats_add_hrv
 #define stats_inc_color              appstats_inc_color
 #define stats_add_anxiety            appstats_add_anxiety
 #define stats_add_energy             appstats_add_energy
@@ -9,6 +11,12 @@
 #define stats_get_snapshot           appstats_get_snapshot
 #define stats_get_snapshot_by_color  appstats_get_snapshot_by_color
 #define stats_dump_csv               appstats_dump_csv
+#define stats_get_sample_id          appstats_get_sample_id
+#define stats_note_change            appstats_note_change
+#define stats_changes_since          appstats_changes_since
+#define stats_session_add            appstats_session_add
+#define stats_session_get            appstats_session_get
+#define stats_session_last_id        appstats_session_last_id
 // NEW: getter da cor corrente do ciclo
 #define stats_get_current_color      appstats_get_current_color
 
@@ -37,6 +45,14 @@ typedef struct {
     float     bpm_mean_trimmed;  // média “robusta” p/ exibição
     uint32_t  bpm_count;         // quantos BPMs acumulados
 
+    float     spo2_mean;         // SpO2 médio (%), só medições com qualidade ok
+    uint32_t  spo2_count;
+
+    float     rmssd_mean;        // HRV média por medição (ms / ms / %)
+    float     sdnn_mean;
+    float     pnn50_mean;
+    uint32_t  hrv_count;
+
     uint32_t  cor_verde;         // contagem por cor
     uint32_t  cor_amarelo;
     uint32_t  cor_vermelho;
@@ -60,11 +76,34 @@ void   stats_set_current_color(stat_color_t c);
 stat_color_t stats_get_current_color(void);
 
 void   stats_add_bpm(float bpm);
+void   stats_add_spo2(float spo2);
+void   stats_add_hrv(float rmssd_ms, float sdnn_ms, float pnn50);
 void   stats_inc_color(stat_color_t c);
 void   stats_add_anxiety(uint8_t level);
 void   stats_add_energy(uint8_t level);
 void   stats_add_humor(uint8_t level);
 
+// Versão dos agregados (sobe a cada dado novo); barato, sem montar snapshot
+uint32_t stats_get_sample_id(void);
+
+// Grupos de campos do /stats.json p/ o journal de mudanças (?since=)
+#define STAT_F_BPM     0x01u   // bpm_mean / bpm_n
+#define STAT_F_SPO2    0x02u   // spo2_mean / spo2_n
+#define STAT_F_HRV     0x04u   // rmssd / sdnn / pnn50 / hrv_n
+#define STAT_F_CORES   0x08u   // contagem por cor
+#define STAT_F_MOOD    0x10u   // ansiedade / energia / humor (só no CSV)
+#define STAT_F_LIVE    0x20u   // bpm_live / spo2_live (web_ap.c)
+#define STAT_F_SURVEY  0x40u   // agregados do questionário (web_ap.c)
+#define STAT_F_ALL     0x7Fu
+
+// Registra mudança feita fora do stats.c (sobe o sample_id); color = cor afetada
+// ou STAT_COLOR_NONE (vale p/ todas as visões)
+void   stats_note_change(uint8_t fields, stat_color_t color);
+
+// Grupos que mudaram depois de `since` na visão `color` (STAT_COLOR_NONE = geral).
+// false = journal não alcança `since` (antigo demais/de outro boot): mande tudo
+bool   stats_changes_since(uint32_t since, stat_color_t color, uint8_t *fields);
+
 // Snapshot geral (todas as cores)
 void   stats_get_snapshot(stats_snapshot_t *out);
 
@@ -73,3 +112,37 @@ void   stats_get_snapshot_by_color(stat_color_t color, stats_snapshot_t *out);
 
 // Gera CSV agregado para download (/download.csv)
 size_t stats_dump_csv(char *dst, size_t maxlen);
+
+// ====== Log por sessão (uma triagem completa = um registro) ======
+#define STATS_SESSION_MAX  64        // ring em RAM; passou disso a mais antiga sai
+#define STATS_NA           0xFFFFu   // campo ×10 sem dado
+
+typedef struct {
+    uint32_t id;                     // 1.. desde o boot (slot = id % STATS_SESSION_MAX)
+    uint32_t t_start_ms;             // A no menu / registro gravado (ms desde o boot)
+    uint32_t t_end_ms;
+    uint16_t bpm_x10;                // BPM final ×10
+    uint16_t spo2_x10;               // SpO2 ×10 (só com qualidade ok)
+    uint16_t rmssd_x10, sdnn_x10, pnn50_x10;   // HRV ×10 (ms / ms / %)
+    uint16_t survey_bits;            // bit i = "Sim" na pergunta i (10 bits)
+    uint8_t  color_rec;              // stat_color_t recomendada pela triagem
+    uint8_t  color_ok;               // validada no sensor (STAT_COLOR_NONE = sem validação)
+    uint8_t  wrong_tries;            // pulseiras erradas antes da certa
+} stats_session_t;
+
+// float -> ×10 (NaN/negativo => STATS_NA)
+static inline uint16_t stats_to_x10(float v) {
+    if (!(v >= 0.0f)) return STATS_NA;
+    float x = v * 10.0f + 0.5f;
+    return (x >= (float)STATS_NA) ? (uint16_t)(STATS_NA - 1) : (uint16_t)x;
+}
+
+// Grava o registro (O(1); id atribuído aqui e devolvido) e soma nos agregados
+// a partir dele: cor recomendada, BPM/SpO2/HRV na cor validada
+uint32_t stats_session_add(stats_session_t *rec);
+
+// Registro `id` se ainda está no ring
+bool   stats_session_get(uint32_t id, stats_session_t *out);
+
+// Último id gravado (0 = nenhum); o mais antigo no ring é last - MAX + 1
+uint32_t stats_session_last_id(void);
@@ -3,13 +3,21 @@
 //   /display         -> Espelho do OLED (redireciona p/ /survey via /survey_state.json)
 //   /oled.json       -> JSON com as 4 linhas do OLED
 //   /stats.json      -> Métricas + "survey" agregado (aceita ?color=verde|amarelo|vermelho)
+//   /stats.cbor      -> Mesmo conteúdo (geral + cada cor) em CBOR p/ coletores
 //   /download.csv    -> CSV agregado (stats.c)
+//   /sessions.csv    -> CSV com um registro por triagem (log em RAM do stats.c)
 //   /survey          -> Questionário (10 perguntas sim/não)
 //   /survey_submit   -> Submissão (?ans=10 bits)
 //   /survey_state.json -> {"mode":0|1}
+//   /ppg.bin         -> Stream binário das amostras cruas do oxímetro (1 cliente)
+//   /events          -> SSE: oled / mode / stats empurrados na mudança (?color=, ?stats=0)
+//   /ws              -> WebSocket do /survey: envia respostas, recebe ack/oled/mode/resultado
+//   sondas de portal cativo (/generate_204, /hotspot-detect.html, ...) -> 302 p/ /
+//   demais caminhos -> 404; método fora da rota -> 405 (HEAD aceito nas rotas GET comuns)
 
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <math.h>
@@ -24,6 +32,11 @@
 #include "dnsserver/dnsserver.h"
 
 #include "stats.h"
+#include "oxi_core1.h"
+#include "web_pages.h"
+#include "ws.h"
+#include "http_req.h"
+#include "cbor.h"
 #include "web_ap.h"
 
 #ifndef CYW43_AUTH_WPA2_AES_PSK
@@ -34,20 +47,77 @@
 #define AP_PASS   ""
 #define HTTP_PORT 80
 
+#define HTTP_CONN_MAX     8      // conexões HTTP simultâneas (pool fixo, inclui /events e /ws)
+#define HTTP_RESP_SIZE    1024   // cabeçalho + JSON/CSV/chunk por conexão (HTML vem da flash)
+#define HTTP_POLL_TICKS   2      // tcp_poll a cada ~1 s
+#define HTTP_IDLE_TICKS   10     // ~10 s sem progresso => aborta
+#define HTTP_KA_TICKS     5      // keep-alive parado ~5 s sem request => fecha
+#define HTTP_HDR_MAX      320    // cabeçalho da resposta, montado na frente do corpo
+#define HTTP_GEN_FRAG     128    // maior pedaço que um gerador solta por chamada (1 linha do CSV)
+#define SSE_MAX           3      // clientes /events simultâneos (o resto do pool fica p/ GETs)
+#define SSE_POLL_TICKS    1      // /events confere mudanças a cada ~500 ms
+#define SSE_KA_TICKS      30     // ~15 s sem evento => comentário keepalive
+#define SSE_STALL_TICKS   20     // ~10 s sem ACK com dados na fila => aborta
+#define WS_MAX            2      // clientes /ws (1 celular + folga p/ aba recarregada)
+#define WS_RX_MAX         136    // maior frame aceito do cliente: 2 + 4 (máscara) + 125
+#define WS_PING_TICKS     15     // ~15 s sem frame nosso => ping
+#define WS_DEAD_TICKS     40     // ~40 s sem nada do cliente (nem ACK) => aborta
+
 static dhcp_server_t s_dhcp;
 static dns_server_t  s_dns;
 
+static void push_notify(void);       // empurra mudanças p/ os clientes do /events e /ws
+
 /* ---------- Estado OLED (espelho) ---------- */
 typedef struct {
     char l1[32], l2[32], l3[32], l4[32];
 } oled_state_t;
 static oled_state_t g_oled = { "", "", "", "" };
+static uint32_t s_oled_ver = 0;      // ETag do /oled.json
 
 void web_display_set_lines(const char *l1, const char *l2, const char *l3, const char *l4) {
-    snprintf(g_oled.l1, sizeof g_oled.l1, "%s", l1 ? l1 : "");
-    snprintf(g_oled.l2, sizeof g_oled.l2, "%s", l2 ? l2 : "");
-    snprintf(g_oled.l3, sizeof g_oled.l3, "%s", l3 ? l3 : "");
-    snprintf(g_oled.l4, sizeof g_oled.l4, "%s", l4 ? l4 : "");
+    oled_state_t o;
+    snprintf(o.l1, sizeof o.l1, "%s", l1 ? l1 : "");
+    snprintf(o.l2, sizeof o.l2, "%s", l2 ? l2 : "");
+    snprintf(o.l3, sizeof o.l3, "%s", l3 ? l3 : "");
+    snprintf(o.l4, sizeof o.l4, "%s", l4 ? l4 : "");
+    if (strcmp(o.l1, g_oled.l1) || strcmp(o.l2, g_oled.l2) ||
+        strcmp(o.l3, g_oled.l3) || strcmp(o.l4, g_oled.l4)) {
+        g_oled = o;
+        s_oled_ver++;
+        push_notify();
+    }
+}
+
+/* ---------- Oxímetro ao vivo ---------- */
+static float g_bpm_live  = 0.f;
+static float g_spo2_live = NAN;
+
+void web_set_oxi_live(float bpm_live, float spo2_live) {
+    bool same_spo2 = (spo2_live == g_spo2_live) || (isnan(spo2_live) && isnan(g_spo2_live));
+    if (bpm_live == g_bpm_live && same_spo2) return;
+    g_bpm_live  = bpm_live;
+    g_spo2_live = spo2_live;
+    stats_note_change(STAT_F_LIVE, (stat_color_t)STAT_COLOR_NONE);
+    push_notify();
+}
+
+/* ---------- Oxímetro: config de aquisição (/oxi_config) ----------
+   O pedido fica pendente até o laço principal consumir (web_take_oxi_config)
+   e mandar p/ o core 1; a config em uso volta por web_set_oxi_config. */
+static volatile bool s_oxicfg_has = false;
+static uint16_t      s_oxicfg_req[3];          // sr, avg, pw pedidos (0 = padrão)
+static uint16_t      s_oxicfg_cur[3];          // em uso (status do core 1)
+
+void web_set_oxi_config(uint16_t sample_rate_hz, uint8_t avg, uint16_t pulse_width_us) {
+    s_oxicfg_cur[0] = sample_rate_hz; s_oxicfg_cur[1] = avg; s_oxicfg_cur[2] = pulse_width_us;
+}
+
+bool web_take_oxi_config(uint16_t *sample_rate_hz, uint8_t *avg, uint16_t *pulse_width_us) {
+    if (!s_oxicfg_has) return false;
+    *sample_rate_hz = s_oxicfg_req[0]; *avg = (uint8_t)s_oxicfg_req[1]; *pulse_width_us = s_oxicfg_req[2];
+    s_oxicfg_has = false; // consumiu
+    return true;
 }
 
 /* ---------- Survey (estado + agregados em RAM) ---------- */
@@ -62,6 +132,11 @@ static uint32_t        s_svy_last_token = 0;  // token da última submissão (pa
 static uint32_t        s_svy_n         = 0;   // nº envios (global)
 static uint32_t        s_svy_yes[10]   = {0}; // contagem "Sim" global
 
+/* Resultado da triagem (main.c) p/ o celular que respondeu via /ws */
+static uint32_t        s_svy_res_token = 0;
+static stat_color_t    s_svy_res_color = STAT_COLOR_VERDE;
+static uint32_t        s_svy_res_ver   = 0;
+
 /* NEW: por cor */
 static stat_color_t    s_svy_color_latched = (stat_color_t)STAT_COLOR_NONE; // reservado
 static uint32_t        s_svy_n_c[STAT_COLOR_COUNT] = {0};                   // nº envios por cor
@@ -77,6 +152,7 @@ static inline void bits_to_str10(uint16_t bits, char out[11]) {
 /* ================== API usada pelo main.c ================== */
 // Liga/desliga o “modo survey” (o /display redireciona para /survey)
 void web_set_survey_mode(bool on) {
+    bool was = s_survey_mode;
     if (on) {
         s_survey_mode = true;
         s_survey_has  = false;      // limpa pendência anterior
@@ -84,6 +160,7 @@ void web_set_survey_mode(bool on) {
     } else {
         s_survey_mode = false;
     }
+    if (was != on) push_notify();
 }
 
 
@@ -119,6 +196,17 @@ void web_assign_survey_token_to_color(uint32_t token, stat_color_t color) {
     for (int i = 0; i < 10; i++) {
         if (bits & (1u << i)) s_svy_yes_c[color][i] += 1;
     }
+    stats_note_change(STAT_F_SURVEY, color);
+    push_notify();
+}
+
+// Cor recomendada p/ a submissão `token` (vai p/ o cliente /ws que a enviou)
+void web_survey_set_result(uint32_t token, stat_color_t color) {
+    if (!((unsigned)color < STAT_COLOR_COUNT) || token == 0) return;
+    s_svy_res_token = token;
+    s_svy_res_color = color;
+    s_svy_res_ver++;
+    push_notify();
 }
 
 /* ============ Wrappers p/ compatibilidade antiga ============ */
@@ -130,295 +218,508 @@ bool web_take_survey(char out_bits_10[11]) {
     return true;
 }
 
-/* ---------- TX state ---------- */
-typedef struct { const char *buf; u16_t len; u16_t off; } http_tx_t;
-static http_tx_t g_tx = {0};
-static char g_resp[8192];
+/* ---------- Conexões (pool fixo, uma por tcp_arg) ---------- */
+// estado do gerador do /stats.json: valores congelados no início da resposta
+typedef struct {
+    uint8_t step, i;             // campo atual / índice dentro de yes[] e rate[]
+    uint8_t fields;              // STAT_F_* a mandar (delta do ?since=)
+    uint32_t sid;                // sample_id do snapshot (cursor do próximo ?since=)
+    uint32_t tx_drops;           // web_tx_drops() no snapshot
+    float bpm_live, bpm_mean, spo2_live, spo2_mean, rmssd, sdnn, pnn50;
+    uint32_t bpm_n, spo2_n, hrv_n, cores[3];
+    uint32_t n, yes[10];
+    uint16_t last_bits;
+} json_stats_gen_t;
+
+typedef struct http_conn http_conn_t;
+// corpo gerado aos pedaços: escreve até cap bytes em out e avança; 0 = fim
+typedef size_t (*http_gen_fn)(http_conn_t *c, char *out, size_t cap);
+
+struct http_conn {
+    struct tcp_pcb *pcb;         // NULL = slot livre
+    const char *buf; u16_t len; u16_t off;       // cabeçalho/corpo em resp (copiado)
+    const uint8_t *rom; uint32_t rom_len, rom_off;  // corpo estático na flash (sem cópia)
+    http_gen_fn gen;             // corpo gerado sob demanda (chunked); NULL = nenhum
+    uint8_t idle;                // ticks do tcp_poll sem progresso
+    struct pbuf *rx;             // bytes recebidos ainda não consumidos (sem tcp_recved)
+    bool keep;                   // keep-alive: não fecha depois da resposta
+    bool eof;                    // cliente mandou FIN: fecha depois da resposta
+    bool head;                   // HEAD: só o cabeçalho
+    bool chunk_ok;               // cliente HTTP/1.1: aceita Transfer-Encoding: chunked
+    bool sse;                    // conexão presa no /events
+    bool ws;                     // conexão WebSocket (/ws)
+    bool sse_stats;              // false com ?stats=0 (display só quer oled/mode)
+    bool sse_has; stat_color_t sse_col;          // filtro ?color= do stream
+    uint32_t ev_oled, sse_sid;                   // versões já enviadas (SSE e WS)
+    uint32_t ws_token, ev_ack, ev_res;           // submissão deste cliente / ack e resultado enviados
+    uint8_t ev_mode, ev_ka;
+    bool dirty;                  // frame descartado: o próximo poll reenvia o estado inteiro
+    union {
+        http_req_t req;          // request em parse (HTTP)
+        json_stats_gen_t js;     // /stats.json saindo (o request já foi lido)
+        struct { uint32_t next, last; bool hdr; } sess;   // /sessions.csv: próximo id / último
+        struct {                 // frame do cliente ainda incompleto (WS)
+            u16_t ws_rx_len;
+            uint8_t ws_rx[WS_RX_MAX];
+        };
+    };
+    char resp[HTTP_RESP_SIZE];
+};
+static http_conn_t s_conn[HTTP_CONN_MAX];
+static uint8_t s_sse_n = 0;          // slots com sse = true
+static uint8_t s_ws_n  = 0;          // slots com ws = true
+static uint32_t s_tx_drops = 0;      // respostas/frames que não couberam inteiros (nada saiu)
+
+static void sse_push(http_conn_t *c);
+static void sse_resync(http_conn_t *c);
+static void ws_push(http_conn_t *c);
+static void ws_resync(http_conn_t *c);
+static bool ws_send(http_conn_t *c, uint8_t op, const void *data, size_t len);
+static void http_error(http_conn_t *c, int status, uint8_t allow);
+
+static const char k_busy[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Retry-After: 5\r\n"
+    "Connection: close\r\n\r\n";
+
+static const char k_sse_ka[] = ": ka\n\n";
+
+static const char k_bad_req[] =
+    "HTTP/1.1 400 Bad Request\r\n"
+    "Connection: close\r\n\r\n";
+
+static const char k_ws_version[] =
+    "HTTP/1.1 426 Upgrade Required\r\n"
+    "Sec-WebSocket-Version: 13\r\n"
+    "Connection: close\r\n\r\n";
+
+static const char k_too_big[] =
+    "HTTP/1.1 500 Internal Server Error\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n\r\n";
+
+// frame/resposta que não coube: nada dele sai; SSE/WS reenviam o estado no poll
+static void tx_drop(http_conn_t *c) {
+    s_tx_drops++;
+    c->dirty = true;
+}
+
+uint32_t web_tx_drops(void) { return s_tx_drops; }
+
+// corpo vai direto p/ cá; http_reply() põe o cabeçalho logo antes
+#define HTTP_BODY(c)    ((c)->resp + HTTP_HDR_MAX)
+#define HTTP_BODY_SIZE  (HTTP_RESP_SIZE - HTTP_HDR_MAX)
+
+static http_conn_t *http_conn_alloc(struct tcp_pcb *pcb) {
+    for (int i = 0; i < HTTP_CONN_MAX; i++) {
+        http_conn_t *c = &s_conn[i];
+        if (c->pcb) continue;
+        c->pcb = pcb; c->buf = NULL; c->len = c->off = 0; c->idle = 0;
+        c->rom = NULL; c->rom_len = c->rom_off = 0; c->gen = NULL;
+        c->rx = NULL; c->keep = c->eof = c->head = c->chunk_ok = false;
+        http_req_reset(&c->req);
+        c->sse = c->ws = c->dirty = false;
+        return c;
+    }
+    return NULL;
+}
+
+// pool cheio: fecha o keep-alive parado há mais tempo p/ dar lugar a uma conexão nova
+static bool http_evict_idle(void);
 
-static bool http_send_chunk(struct tcp_pcb *tpcb) {
-    while (g_tx.off < g_tx.len) {
+// solta o pcb dos callbacks e devolve o slot (pcb NULL = já liberado pelo lwIP)
+static void http_conn_free(http_conn_t *c) {
+    struct tcp_pcb *pcb = c->pcb;
+    c->pcb = NULL;
+    if (c->sse) { c->sse = false; s_sse_n--; }
+    if (c->ws)  { c->ws  = false; s_ws_n--;  }
+    if (c->rx)  { pbuf_free(c->rx); c->rx = NULL; }
+    if (!pcb) return;
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL); tcp_sent(pcb, NULL);
+    tcp_err(pcb, NULL);  tcp_poll(pcb, NULL, 0);
+}
+
+// fecha com FIN; sem memória p/ o FIN => RST (retorna ERR_ABRT)
+static err_t http_close(http_conn_t *c) {
+    struct tcp_pcb *pcb = c->pcb;
+    http_conn_free(c);
+    if (tcp_close(pcb) != ERR_OK) { tcp_abort(pcb); return ERR_ABRT; }
+    return ERR_OK;
+}
+
+static err_t http_abort(http_conn_t *c) {
+    struct tcp_pcb *pcb = c->pcb;
+    http_conn_free(c);
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
+static bool http_gen_fill(http_conn_t *c);
+
+// true = resposta toda entregue ao lwIP
+static bool http_send_chunk(http_conn_t *c, err_t *err) {
+    struct tcp_pcb *tpcb = c->pcb;
+    *err = ERR_OK;
+again:
+    while (c->off < c->len) {
         u16_t wnd = tcp_sndbuf(tpcb);
         if (!wnd) break;
-        u16_t chunk = g_tx.len - g_tx.off;
+        u16_t chunk = c->len - c->off;
         if (chunk > 1200) chunk = 1200;
         if (chunk > wnd)  chunk = wnd;
-        err_t e = tcp_write(tpcb, g_tx.buf + g_tx.off, chunk, TCP_WRITE_FLAG_COPY);
+        err_t e = tcp_write(tpcb, c->buf + c->off, chunk, TCP_WRITE_FLAG_COPY);
+        if (e == ERR_MEM) break;
+        if (e != ERR_OK) { *err = http_abort(c); return false; }
+        c->off += chunk;
+        c->idle = 0;
+    }
+    // corpo da flash só depois do cabeçalho inteiro na fila
+    while (c->off >= c->len && c->rom_off < c->rom_len) {
+        u16_t wnd = tcp_sndbuf(tpcb);
+        if (!wnd) break;
+        uint32_t chunk = c->rom_len - c->rom_off;
+        if (chunk > wnd) chunk = wnd;
+        err_t e = tcp_write(tpcb, c->rom + c->rom_off, (u16_t)chunk, 0);
         if (e == ERR_MEM) break;
-        if (e != ERR_OK) { tcp_abort(tpcb); return true; }
-        g_tx.off += chunk;
+        if (e != ERR_OK) { *err = http_abort(c); return false; }
+        c->rom_off += chunk;
+        c->idle = 0;
     }
+    // corpo gerado: próximo chunk só quando o anterior já foi p/ o lwIP
+    if (c->gen && c->off >= c->len && http_gen_fill(c)) goto again;
     tcp_output(tpcb);
-    return (g_tx.off >= g_tx.len);
+    return (c->off >= c->len && c->rom_off >= c->rom_len && !c->gen);
+}
+
+static inline bool http_busy(const http_conn_t *c) { return c->len || c->rom_len || c->gen; }
+
+// Gera o próximo chunk direto no resp (o cabeçalho já foi copiado p/ o lwIP),
+// do tamanho do que cabe na janela agora: "XXXX\r\n" + pedaços + "\r\n", e o
+// "0\r\n\r\n" final quando o gerador acaba. HTTP/1.0: corpo cru, fim = FIN.
+// false = janela pequena demais (tenta de novo no próximo ACK/poll).
+static bool http_gen_fill(http_conn_t *c) {
+    size_t cap = tcp_sndbuf(c->pcb);
+    if (cap > sizeof c->resp) cap = sizeof c->resp;
+    size_t pre = c->chunk_ok ? 6 : 0, post = c->chunk_ok ? 2 + 5 : 0;
+    if (cap < pre + HTTP_GEN_FRAG + post) return false;
+    size_t off = pre;
+    while (off + HTTP_GEN_FRAG + post <= cap) {
+        size_t n = c->gen(c, c->resp + off, HTTP_GEN_FRAG);
+        if (!n) { c->gen = NULL; break; }
+        off += n;
+    }
+    size_t start = 0;
+    if (c->chunk_ok) {
+        if (off > pre) {
+            char x[8];
+            snprintf(x, sizeof x, "%04x\r\n", (unsigned)(off - pre));   // zeros à esquerda valem
+            memcpy(c->resp, x, pre);
+            memcpy(c->resp + off, "\r\n", 2); off += 2;
+        } else {
+            start = pre;                         // gerador acabou sem chunk novo
+        }
+        if (!c->gen) { memcpy(c->resp + off, "0\r\n\r\n", 5); off += 5; }
+    }
+    c->buf = c->resp; c->len = (u16_t)off; c->off = (u16_t)start;
+    return true;
+}
+
+// cabeçalho (status + hdrs + Content-Length + Connection) montado logo antes do
+// corpo já escrito em HTTP_BODY(c); corpo da flash (c->rom) entra no Content-Length.
+// Com c->gen o tamanho não é conhecido: chunked (HTTP/1.1) ou fecha no fim (1.0).
+// Corpo ou cabeçalho maior que o espaço: não manda pedaço, só um 500 e fecha.
+static void http_reply(http_conn_t *c, const char *status, const char *hdrs, size_t blen) {
+    char h[HTTP_HDR_MAX];
+    char len[32] = "";
+    if (c->gen) {
+        if (c->chunk_ok) strcpy(len, "Transfer-Encoding: chunked\r\n");
+        else c->keep = false;
+    } else if (strncmp(status, "304", 3) && strncmp(status, "204", 3))   // 304/204: sem corpo nem Content-Length
+        snprintf(len, sizeof len, "Content-Length: %lu\r\n", (unsigned long)(blen + c->rom_len));
+    int n = snprintf(h, sizeof h, "HTTP/1.1 %s\r\n%s%sConnection: %s\r\n\r\n",
+                     status, hdrs, len, c->keep ? "keep-alive" : "close");
+    if (n < 0 || n >= (int)sizeof h || blen >= HTTP_BODY_SIZE) {
+        tx_drop(c);
+        c->rom = NULL; c->rom_len = 0; c->gen = NULL;
+        c->keep = false;
+        c->buf = k_too_big; c->len = sizeof k_too_big - 1; c->off = 0;
+        return;
+    }
+    char *start = HTTP_BODY(c) - n;
+    memcpy(start, h, (size_t)n);
+    c->buf = start; c->len = (u16_t)(n + blen); c->off = 0;
+    if (c->head) { c->len = (u16_t)n; c->rom = NULL; c->rom_len = 0; c->gen = NULL; }
+}
+
+// resposta inteira na fila do lwIP: fecha ou deixa o slot pronto p/ o próximo request
+static err_t http_done(http_conn_t *c) {
+    if (!c->keep || c->eof) return http_close(c);
+    c->buf = NULL; c->len = c->off = 0;
+    c->rom = NULL; c->rom_len = c->rom_off = 0;
+    c->gen = NULL;
+    c->idle = 0;
+    c->head = false;
+    http_req_reset(&c->req);
+    return ERR_OK;
+}
+
+static err_t http_serve(http_conn_t *c);
+
+// streams não leem mais requests: o que veio colado é descartado
+static void http_rx_drop(http_conn_t *c) {
+    if (!c->rx) return;
+    tcp_recved(c->pcb, c->rx->tot_len);
+    pbuf_free(c->rx);
+    c->rx = NULL;
 }
 
 static err_t http_sent_cb(void *arg, struct tcp_pcb *tpcb, u16_t len) {
-    (void)arg; (void)len;
-    if (http_send_chunk(tpcb)) {
-        tcp_sent(tpcb, NULL);
-        tcp_recv(tpcb, NULL);
-        tcp_close(tpcb);
+    (void)tpcb; (void)len;
+    http_conn_t *c = (http_conn_t *)arg;
+    if (!c) return ERR_OK;
+    c->idle = 0;
+    if (c->sse) { sse_push(c); return ERR_OK; }   // janela abriu: manda o que ficou p/ trás
+    if (c->ws)  { ws_push(c);  return ERR_OK; }
+    err_t e;
+    if (!http_busy(c)) return ERR_OK;            // ACK de resposta já terminada
+    if (!http_send_chunk(c, &e)) return e;
+    if ((e = http_done(c)) != ERR_OK || !c->pcb) return e;
+    return http_serve(c);                        // pipelining: próximo da fila
+}
+
+// cliente parado (sem request ou sem ACK): fecha e libera o slot
+static err_t http_poll_cb(void *arg, struct tcp_pcb *tpcb) {
+    http_conn_t *c = (http_conn_t *)arg;
+    if (!c) { tcp_abort(tpcb); return ERR_ABRT; }
+    if (c->sse) {
+        // ocioso é normal no /events; só derruba se os dados param de ser confirmados
+        if (tcp_sndbuf(tpcb) < TCP_SND_BUF) { if (++c->idle >= SSE_STALL_TICKS) return http_abort(c); }
+        else c->idle = 0;
+        if (c->dirty) sse_resync(c);
+        sse_push(c);
+        if (++c->ev_ka >= SSE_KA_TICKS &&
+            tcp_write(tpcb, k_sse_ka, sizeof k_sse_ka - 1, 0) == ERR_OK) {
+            c->ev_ka = 0;
+            tcp_output(tpcb);
+        }
+        return ERR_OK;
     }
+    if (c->ws) {
+        // idle zera com frame do cliente ou ACK; o ping periódico força os dois
+        if (++c->idle >= WS_DEAD_TICKS) return http_abort(c);
+        if (c->dirty) ws_resync(c);
+        ws_push(c);
+        if (++c->ev_ka >= WS_PING_TICKS && ws_send(c, WS_OP_PING, NULL, 0)) tcp_output(tpcb);
+        return ERR_OK;
+    }
+    // keep-alive sem nada pendente: prazo curto e FIN (não é erro)
+    if (!http_busy(c) && !c->rx) return (++c->idle < HTTP_KA_TICKS) ? ERR_OK : http_close(c);
+    if (++c->idle < HTTP_IDLE_TICKS) {
+        err_t e;
+        if (http_busy(c) && http_send_chunk(c, &e)) {             // janela reabriu
+            if ((e = http_done(c)) != ERR_OK || !c->pcb) return e;
+            return http_serve(c);
+        }
+        return ERR_OK;
+    }
+    return http_abort(c);
+}
+
+static void http_err_cb(void *arg, err_t err) {
+    (void)err;
+    http_conn_t *c = (http_conn_t *)arg;
+    if (!c) return;
+    c->pcb = NULL;                       // pcb já foi liberado pelo lwIP
+    http_conn_free(c);
+}
+
+/* ---------- Stream PPG (/ppg.bin) ----------
+   Frames de 16 B (oxi_ppg_frame_t) saem direto do ring do oxi_core1 p/ o
+   tcp_write() sem cópia; o slot só volta ao core 1 depois do ACK. Cliente
+   lento => o ring enche e o core 1 descarta frames (buraco no seq). */
+#define PPG_POLL_TICKS  1      // tcp_poll a cada ~500 ms (sem ACK chegando)
+
+static struct tcp_pcb *s_ppg_pcb = NULL;
+static uint32_t s_ppg_next;    // próximo frame a enfileirar
+static uint32_t s_ppg_rel;     // frames confirmados e devolvidos
+static uint32_t s_ppg_hdr;     // bytes do cabeçalho ainda sem ACK
+static uint32_t s_ppg_part;    // bytes confirmados de um frame incompleto
+
+static void ppg_end(void) {
+    oxi_core1_ppg_close();
+    s_ppg_pcb = NULL;
+}
+
+static void ppg_pump(struct tcp_pcb *tpcb) {
+    const oxi_ppg_frame_t *f;
+    size_t n;
+    while ((n = oxi_core1_ppg_peek(s_ppg_next, &f)) > 0) {
+        size_t room = tcp_sndbuf(tpcb) / sizeof *f;
+        if (!room) break;
+        if (n > room) n = room;
+        if (tcp_write(tpcb, f, (u16_t)(n * sizeof *f), 0) != ERR_OK) break;  // ERR_MEM: fila cheia
+        s_ppg_next += (uint32_t)n;
+    }
+    tcp_output(tpcb);
+}
+
+static err_t ppg_sent_cb(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    (void)arg;
+    uint32_t b = len;
+    uint32_t h = b < s_ppg_hdr ? b : s_ppg_hdr;
+    s_ppg_hdr -= h; b -= h;
+    b += s_ppg_part;
+    s_ppg_rel += b / sizeof(oxi_ppg_frame_t);
+    s_ppg_part = b % sizeof(oxi_ppg_frame_t);
+    oxi_core1_ppg_release(s_ppg_rel);
+    ppg_pump(tpcb);
     return ERR_OK;
 }
 
-/* ---------- helpers: parse color query ---------- */
-static bool parse_color_query(const char *req, stat_color_t *out_color, bool *has_color) {
-    *has_color = false;
-    if (!req) return false;
-    const char *q = strstr(req, "GET /stats.json");
-    if (!q) return true;
-    const char *p = strstr(q, "color=");
-    if (!p) return true;
-    p += 6;
-    if (!strncmp(p, "verde", 5))      { *out_color = STAT_COLOR_VERDE; *has_color = true; return true; }
-    if (!strncmp(p, "amarelo", 7))    { *out_color = STAT_COLOR_AMARELO; *has_color = true; return true; }
-    if (!strncmp(p, "vermelho", 8))   { *out_color = STAT_COLOR_VERMELHO; *has_color = true; return true; }
-    return true;
+static err_t ppg_poll_cb(void *arg, struct tcp_pcb *tpcb) {
+    (void)arg;
+    ppg_pump(tpcb);
+    return ERR_OK;
 }
 
-/* ---------- HTML: Painel Profissional (/) ---------- */
-static void make_html_pro(char *out, size_t outsz) {
-    const char *body =
-        "<!doctype html><html lang=pt-br><head><meta charset=utf-8>"
-        "<meta name=viewport content='width=device-width,initial-scale=1'>"
-        "<title>TheraLink — Profissional</title>"
-        "<style>"
-        "body{font-family:system-ui,-apple-system,Segoe UI,Roboto,Arial,sans-serif;margin:16px;background:#f4f6fb;color:#0e1320}"
-        "nav{display:flex;gap:12px;margin-bottom:12px;flex-wrap:wrap}"
-        "nav a{padding:8px 12px;border:1px solid #e2e6ef;background:#fff;border-radius:12px;text-decoration:none;color:#0e1320}"
-        ".chips{display:flex;gap:8px;flex-wrap:wrap;margin:6px 0 10px}"
-        ".chip{display:inline-flex;align-items:center;gap:8px;padding:8px 12px;border:1px solid #e2e6ef;border-radius:999px;background:#fff;cursor:pointer;user-select:none}"
-        ".chip .dot{width:10px;height:10px;border-radius:999px;display:inline-block}"
-        ".chip[data-c='all'] .dot{background:linear-gradient(90deg,#12b886,#fab005,#fa5252)}"
-        ".chip[data-c='verde'] .dot{background:#12b886}.chip[data-c='amarelo'] .dot{background:#fab005}.chip[data-c='vermelho'] .dot{background:#fa5252}"
-        ".chip.active{box-shadow:0 0 0 2px rgba(17,17,17,.08);border-color:#c9cfda}"
-        ".hint{font-size:12px;color:#5f6b86}"
-        ".grid{display:grid;grid-template-columns:1fr;gap:12px}"
-        "@media(min-width:980px){.grid{grid-template-columns:1.1fr .9fr}}"
-        ".card{border:1px solid #e6e9f2;border-radius:16px;padding:14px;background:#fff;box-shadow:0 6px 24px rgba(0,0,0,.05)}"
-        ".title{margin:0 0 8px;font-size:18px;font-weight:700}"
-        ".row{display:flex;gap:12px;align-items:flex-start;flex-wrap:wrap}"
-        ".kpi{border:1px solid #edf0f7;padding:12px;border-radius:14px;background:#fbfcff;min-width:170px}"
-        ".kpi .l{font-size:12px;color:#6a7490}.kpi .v{font-size:30px;font-weight:800;margin-top:2px}"
-        ".pill{display:inline-flex;gap:8px;align-items:center;padding:6px 10px;border:1px solid #e6e9f2;border-radius:999px;background:#fff;font-size:12px}"
-        "canvas{width:100%;height:240px;background:#fafbff;border:1px solid #eef1f7;border-radius:12px}"
-        ".lst{display:grid;grid-template-columns:repeat(10,1fr);gap:6px;margin-top:8px}"
-        ".dot{display:flex;align-items:center;justify-content:center;height:28px;border:1px solid #e6e9f2;border-radius:8px;background:#fff;font-weight:800}"
-        "</style></head><body>"
-        "<nav><a href='/'>Profissional</a><a href='/display'>Display</a><a href='/download.csv'>Baixar CSV</a></nav>"
-        "<h1 style='font-size:20px;margin:6px 0 8px'>Painel — Profissional</h1>"
-        "<div class='chips' id='chips'>"
-          "<div class='chip active' data-c='all'><span class='dot'></span><span>Todos</span></div>"
-          "<div class='chip' data-c='verde'><span class='dot'></span><span>Grupo Verde</span></div>"
-          "<div class='chip' data-c='amarelo'><span class='dot'></span><span>Grupo Amarelo</span></div>"
-          "<div class='chip' data-c='vermelho'><span class='dot'></span><span>Grupo Vermelho</span></div>"
-        "</div>"
-        "<div class='hint'>Filtre por grupo para analisar BPM e distribuição por pulseira.</div>"
-        "<div class=grid>"
-          "<div class=card>"
-            "<div class=title>Ritmo (BPM) e check-ins</div>"
-            "<div class=row>"
-              "<div class=kpi><div class=l>BPM m&eacute;dio</div><div id=kpiBpm class=v>--</div></div>"
-              "<div class=kpi><div class=l>Check-ins</div><div id=kpiN class=v>0</div></div>"
-              "<div class=kpi><div class=l>Sim por pessoa</div><div id=kpiAvgYes class=v>--</div></div>"
-            "</div>"
-            "<canvas id=chartBpm></canvas>"
-          "</div>"
-          "<div class=card>"
-            "<div class=title>Distribui&ccedil;&atilde;o por cor</div>"
-            "<canvas id=chartCores></canvas>"
-            "<div class='hint' id=fltDesc>Todos os grupos</div>"
-          "</div>"
-          "<div class=card>"
-            "<div class=title>Alertas</div>"
-            "<div class=row>"
-              "<span class=pill>Crise agora: <b id=alCrisis>0</b></span>"
-              "<span class=pill>Evita grupo: <b id=alAvoid>0</b></span>"
-              "<span class=pill>Quer falar: <b id=alTalk>0</b></span>"
-            "</div>"
-          "</div>"
-          "<div class=card>"
-            "<div class=title>Necessidades b&aacute;sicas</div>"
-            "<div class=row>"
-              "<div class=kpi><div class=l>Sem refei&ccedil;&atilde;o recente</div><div id=basicMeal class=v>--</div></div>"
-              "<div class=kpi><div class=l>Sem sono adequado</div><div id=basicSleep class=v>--</div></div>"
-            "</div>"
-          "</div>"
-          "<div class=card style='grid-column:1 / -1'>"
-            "<div class=title>Question&aacute;rio — contagem de <b>Sim</b> por pergunta</div>"
-            "<canvas id=chartQs></canvas>"
-            "<div class='title' style='font-size:16px;margin-top:10px'>&Uacute;ltima resposta</div>"
-            "<div class=lst id=lastList></div>"
-          "</div>"
-        "</div>"
-        "<script>"
-        "let hist=[];const maxPts=180;let flt='all';"
-        "const Cb=document.getElementById('chartBpm').getContext('2d');"
-        "const Cc=document.getElementById('chartCores').getContext('2d');"
-        "const Cq=document.getElementById('chartQs').getContext('2d');"
-        "function drawLine(ctx,arr){const w=ctx.canvas.clientWidth,h=ctx.canvas.clientHeight;ctx.canvas.width=w;ctx.canvas.height=h;"
-          "ctx.clearRect(0,0,w,h);if(arr.length<2)return;let mn=200,mx=40;for(const v of arr){if(v>0){mn=Math.min(mn,v);mx=Math.max(mx,v);}}"
-          "if(!isFinite(mn)||!isFinite(mx))return;if(mx-mn<5){mn=Math.max(20,mn-3);mx=mn+5;}ctx.beginPath();"
-          "for(let i=0;i<arr.length;i++){const v=arr[i];if(v<=0)continue;const x=i*(w-8)/(arr.length-1)+4;const y=h-4-(v-mn)/(mx-mn)*(h-8);i?ctx.lineTo(x,y):ctx.moveTo(x,y);}ctx.stroke();}"
-        "function drawBars(ctx,data,labels){const w=ctx.canvas.clientWidth,h=ctx.canvas.clientHeight;ctx.canvas.width=w;ctx.canvas.height=h;"
-          "ctx.clearRect(0,0,w,h);const n=data.length;const bw=Math.min(60,(w-40)/n);const gap=(w-n*bw)/(n+1);let x=gap;const M=Math.max(...data,1);"
-          "ctx.font='12px system-ui';for(let i=0;i<n;i++){const v=data[i];const y=h-22;const bh=(v/M)*(h-50);ctx.fillRect(x,y-bh,bw,bh);ctx.fillText(labels[i],x,y+14);ctx.fillText(String(v.toFixed?Math.round(v):v),x+bw/2-8,y-bh-6);x+=bw+gap;}}"
-        "function lastDots(bits){const el=document.getElementById('lastList');el.innerHTML='';for(let i=0;i<10;i++){const on=((bits>>i)&1)!==0;const d=document.createElement('div');d.className='dot';d.textContent=on?'●':'○';el.appendChild(d);}}"
-        "function sel(c){flt=c;document.querySelectorAll('.chip').forEach(el=>el.classList.toggle('active',el.dataset.c===c));hist=[];tick();}"
-        "document.getElementById('chips').addEventListener('click',e=>{const el=e.target.closest('.chip');if(!el)return;sel(el.dataset.c)});"
-        "function fltLabel(){if(flt==='verde')return 'Apenas Grupo Verde';if(flt==='amarelo')return 'Apenas Grupo Amarelo';if(flt==='vermelho')return 'Apenas Grupo Vermelho';return 'Todos os grupos';}"
-        "async function tick(){try{let url='/stats.json?t='+Date.now();if(flt!=='all'){url+='&color='+flt;}const r=await fetch(url,{cache:'no-store'});const s=await r.json();"
-            "document.getElementById('fltDesc').textContent=fltLabel();"
-            "const live=(s.bpm_live&&s.bpm_live>=20&&s.bpm_live<=250)?s.bpm_live:0;const main=live||s.bpm_mean||0;document.getElementById('kpiBpm').textContent=main?main.toFixed(1):'--';"
-            "const plotted=live||s.bpm_mean||0;if(plotted){hist.push(plotted);if(hist.length>maxPts)hist.shift();}drawLine(Cb,hist);"
-            "drawBars(Cc,[s.cores.verde||0,s.cores.amarelo||0,s.cores.vermelho||0],['Verde','Amarelo','Vermelho']);"
-            "const sv=s.survey||{};const n=sv.n||0;const rate=sv.rate||[];const avg=sv.avg_yes||0;"
-            "document.getElementById('kpiN').textContent=String(n);document.getElementById('kpiAvgYes').textContent=avg?(Math.round(avg*100)/100).toFixed(2):'--';"
-            "document.getElementById('alCrisis').textContent=String(sv.alerts?sv.alerts.crisis||0:0);"
-            "document.getElementById('alAvoid').textContent=String(sv.alerts?sv.alerts.avoid||0:0);"
-            "document.getElementById('alTalk').textContent=String(sv.alerts?sv.alerts.talk||0:0);"
-            "document.getElementById('basicMeal').textContent=String(sv.basic?sv.basic.no_meal||0:0);"
-            "document.getElementById('basicSleep').textContent=String(sv.basic?sv.basic.poor_sleep||0:0);"
-            "const perc=(rate||[]).map(v=>v*100);drawBars(Cq,perc,['Q1','Q2','Q3','Q4','Q5','Q6','Q7','Q8','Q9','Q10']);"
-            "lastDots(sv.last_bits||0);"
-          "}catch(e){}}"
-        "setInterval(tick,1000); tick();"
-        "</script></body></html>";
-
-    snprintf(out, outsz,
-        "HTTP/1.1 200 OK\r\n"
-        "Content-Type: text/html; charset=UTF-8\r\n"
-        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-        "Connection: close\r\n\r\n%s", body);
-}
-
-/* ---------- HTML: Display (espelho + auto jump para /survey) ---------- */
-static void make_html_display(char *out, size_t outsz) {
-    const char *body =
-        "<!doctype html><html lang=pt-br><head><meta charset=utf-8>"
-        "<meta name=viewport content='width=device-width,initial-scale=1'>"
-        "<title>TheraLink — Display</title>"
-        "<style>"
-        "html,body{height:100%;margin:0}"
-        "body{font-family:system-ui,-apple-system,Segoe UI,Roboto,Arial,sans-serif;background:radial-gradient(60% 80% at 50% 10%,#171a20,#0e1014);color:#f2f4f8;display:flex;align-items:center;justify-content:center}"
-        ".panel{width:min(960px,94vw);padding:24px 22px;border-radius:20px;background:linear-gradient(180deg,#141821,#101218);box-shadow:0 12px 40px rgba(0,0,0,.45),inset 0 1px rgba(255,255,255,.05)}"
-        ".hdr{display:flex;justify-content:space-between;align-items:center;margin-bottom:8px;opacity:.9}.hdr .brand{font-weight:700;letter-spacing:.3px}"
-        ".btn{font-size:12px;padding:6px 10px;border-radius:10px;border:1px solid #303440;background:#1a1f2b;color:#f2f4f8}"
-        ".lines{display:grid;gap:6px;margin-top:8px}"
-        ".line{min-height:1lh;font-weight:800;letter-spacing:.5px;text-shadow:0 2px 10px rgba(0,0,0,.25);padding:2px 4px;border-radius:8px}"
-        "#l1{font-size:clamp(20px,6.2vh,36px)}#l2,#l3,#l4{font-size:clamp(22px,7.2vh,44px)}"
-        ".fade{animation:fade .22s ease}@keyframes fade{from{opacity:.45;transform:translateY(1px)}to{opacity:1;transform:none}}"
-        ".tag{font-weight:900}.tag.green{color:#12b886}.tag.yellow{color:#fab005}.tag.red{color:#fa5252}"
-        "</style></head><body>"
-        "<div class=panel><div class=hdr><div class=brand>TheraLink — Display</div><button class=btn onclick='fs()'>Tela cheia</button></div>"
-        "<div class=lines><div id=l1 class='line'>&nbsp;</div><div id=l2 class='line'>&nbsp;</div><div id=l3 class='line'>&nbsp;</div><div id=l4 class='line'>&nbsp;</div></div></div>"
-        "<script>"
-        "function fs(){const d=document.documentElement; if(d.requestFullscreen) d.requestFullscreen();}"
-        "let last=['','','',''];let jumped=false;"
-        "function esc(t){return (t||'').replace(/&/g,'&amp;').replace(/</g,'&lt;').replace(/>/g,'&gt;');}"
-        "function colorize(t){let x=esc(t||'');x=x.replace(/\\b(verde|amarelo|amarela|vermelho|vermelha)\\b/gi,m=>{const k=m.toLowerCase();if(k==='verde')return'<span class=\"tag green\">'+m+'</span>';if(k==='amarelo'||k==='amarela')return'<span class=\"tag yellow\">'+m+'</span>';if(k==='vermelho'||k==='vermelha')return'<span class=\"tag red\">'+m+'</span>';return m;});return x;}"
-        "async function tick(){try{const st=await fetch('/survey_state.json?t='+Date.now(),{cache:'no-store'}).then(r=>r.json()).catch(()=>({mode:0}));"
-          "if(!jumped&&st.mode){jumped=true;location.replace('/survey?t='+Date.now());return;}"
-          "const s=await fetch('/oled.json?t='+Date.now(),{cache:'no-store'}).then(r=>r.json());const arr=[s.l1||'',s.l2||'',s.l3||'',s.l4||''];"
-          "for(let i=0;i<4;i++){if(arr[i]!==last[i]){last[i]=arr[i];const el=document.getElementById('l'+(i+1));el.classList.remove('fade');el.innerHTML=colorize(arr[i])||'&nbsp;';void el.offsetWidth;el.classList.add('fade');}}"
-        "}catch(e){}}setInterval(tick,500);tick();"
-        "</script></body></html>";
-
-    snprintf(out, outsz,
-        "HTTP/1.1 200 OK\r\n"
+static void ppg_err_cb(void *arg, err_t err) {
+    (void)arg; (void)err;
+    ppg_end();                           // pcb já foi liberado pelo lwIP
+}
+
+static err_t ppg_recv_cb(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    (void)arg; (void)err;
+    if (p) { tcp_recved(tpcb, p->tot_len); pbuf_free(p); return ERR_OK; }
+    // cliente fechou: RST solta na hora os segmentos que apontam p/ o ring
+    tcp_err(tpcb, NULL);
+    ppg_end();
+    tcp_abort(tpcb);
+    return ERR_ABRT;
+}
+
+static const char k_ppg_hdr[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "X-PPG-Frame: seq:u32,t_ms:u32,ir:i32,red:i32;le\r\n"
+    "Cache-Control: no-store, max-age=0\r\n"
+    "Connection: close\r\n\r\n";
+
+// o stream sai do pool: estado próprio (um cliente só) e callbacks próprios
+static err_t ppg_start(http_conn_t *c) {
+    if (s_ppg_pcb) {                     // um stream por vez
+        tcp_write(c->pcb, k_busy, sizeof k_busy - 1, 0);
+        return http_close(c);
+    }
+    struct tcp_pcb *tpcb = c->pcb;
+    http_conn_free(c);
+    s_ppg_pcb  = tpcb;
+    s_ppg_next = s_ppg_rel = oxi_core1_ppg_open();
+    s_ppg_hdr  = sizeof k_ppg_hdr - 1;
+    s_ppg_part = 0;
+    tcp_recv(tpcb, ppg_recv_cb);
+    tcp_sent(tpcb, ppg_sent_cb);
+    tcp_poll(tpcb, ppg_poll_cb, PPG_POLL_TICKS);
+    tcp_err(tpcb, ppg_err_cb);
+    tcp_write(tpcb, k_ppg_hdr, sizeof k_ppg_hdr - 1, 0);
+    ppg_pump(tpcb);
+    return ERR_OK;
+}
+
+/* ---------- helpers: ?color= (/stats.json e /events) ---------- */
+static bool query_color(const http_req_t *r, stat_color_t *out_color) {
+    char v[12];
+    if (!http_req_query(r, "color", v, sizeof v)) return false;
+    if (!strcmp(v, "verde"))    { *out_color = STAT_COLOR_VERDE;    return true; }
+    if (!strcmp(v, "amarelo"))  { *out_color = STAT_COLOR_AMARELO;  return true; }
+    if (!strcmp(v, "vermelho")) { *out_color = STAT_COLOR_VERMELHO; return true; }
+    return false;
+}
+
+/* ---------- HTML estático (/, /display, /survey) ----------
+   Corpo gzip gerado no build a partir de web/; só o cabeçalho passa pelo resp.
+   Valores dinâmicos vêm dos endpoints JSON. */
+static void http_static(http_conn_t *c, const web_page_t *pg) {
+    char h[192];
+    snprintf(h, sizeof h,
         "Content-Type: text/html; charset=UTF-8\r\n"
-        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-        "Connection: close\r\n\r\n%s", body);
-}
-
-/* ---------- HTML: Survey ---------- */
-static void make_html_survey(char *out, size_t outsz) {
-    const char *body_prefix =
-        "<!doctype html><html lang=pt-br><head><meta charset=utf-8>"
-        "<meta name=viewport content='width=device-width,initial-scale=1'>"
-        "<title>TheraLink — Survey</title>"
-        "<style>"
-        "body{font-family:system-ui,-apple-system,Segoe UI,Roboto,Arial,sans-serif;margin:18px;background:#0f1220;color:#eef1f6}"
-        ".wrap{max-width:920px;margin:0 auto}h1{font-size:22px;margin:0 0 12px}"
-        ".card{background:#13172a;border:1px solid #252b45;border-radius:14px;padding:16px;margin:12px 0}"
-        ".q{display:flex;justify-content:space-between;align-items:center;padding:12px 10px;border-bottom:1px solid #1e2440}.q:last-child{border-bottom:none}"
-        ".lbl{max-width:74%;line-height:1.35}.btns{display:flex;gap:8px}"
-        ".chip{padding:10px 12px;border-radius:12px;border:1px solid #2b3358;background:#0f1428;color:#eef1f6;cursor:pointer;user-select:none}"
-        ".chip.sel{outline:2px solid #2d6cdf}.row{display:flex;gap:10px;flex-wrap:wrap}.primary{background:#2d6cdf;border-color:#2d6cdf}"
-        "a{color:#cfe1ff;text-decoration:none}.muted{opacity:.8}"
-        "</style></head><body><div class=wrap><h1>Question&aacute;rio r&aacute;pido (10 perguntas)</h1>";
-
-    const char *body_main =
-        "<div id=content class=card>"
-        "<div class=q><div class=lbl>Dormiu bem nas &uacute;ltimas 24h?</div><div class=btns><span class=chip data-i='0' data-v='1'>Sim</span><span class=chip data-i='0' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Teve conflito forte com algu&eacute;m?</div><div class=btns><span class=chip data-i='1' data-v='1'>Sim</span><span class=chip data-i='1' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Se sentiu muito nervoso(a) hoje?</div><div class=btns><span class=chip data-i='2' data-v='1'>Sim</span><span class=chip data-i='2' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Teve dificuldade de concentrar?</div><div class=btns><span class=chip data-i='3' data-v='1'>Sim</span><span class=chip data-i='3' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Sente risco de crise agora?</div><div class=btns><span class=chip data-i='4' data-v='1'>Sim</span><span class=chip data-i='4' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Est&aacute; evitando estar com o grupo hoje?</div><div class=btns><span class=chip data-i='5' data-v='1'>Sim</span><span class=chip data-i='5' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Quer falar com um adulto ap&oacute;s o check-in?</div><div class=btns><span class=chip data-i='6' data-v='1'>Sim</span><span class=chip data-i='6' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Comeu e se hidratou adequadamente?</div><div class=btns><span class=chip data-i='7' data-v='1'>Sim</span><span class=chip data-i='7' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Sente dor f&iacute;sica relevante agora?</div><div class=btns><span class=chip data-i='8' data-v='1'>Sim</span><span class=chip data-i='8' data-v='0'>N&atilde;o</span></div></div>"
-        "<div class=q><div class=lbl>Se sente seguro(a) neste ambiente?</div><div class=btns><span class=chip data-i='9' data-v='1'>Sim</span><span class=chip data-i='9' data-v='0'>N&atilde;o</span></div></div>"
-        "</div>"
-        "<div class=row><button id=send class='chip primary'>Enviar respostas</button><a class=chip href='/display' id=back>Voltar ao display</a></div>"
-        "<p class=muted style='margin-top:8px'>As respostas s&atilde;o locais e an&ocirc;nimas.</p>"
-        "<script>"
-        "const sel=new Array(10).fill(-1);"
-        "document.querySelectorAll('.chip[data-i]').forEach(b=>{b.addEventListener('click',()=>{const i=Number(b.dataset.i),v=Number(b.dataset.v);sel[i]=v;const sib=b.parentElement.querySelectorAll('.chip');sib.forEach(x=>x.classList.remove('sel'));b.classList.add('sel');});});"
-        "document.getElementById('back').addEventListener('click',e=>{e.preventDefault();location.replace('/display?t='+Date.now());});"
-        "document.getElementById('send').addEventListener('click',()=>{if(sel.some(v=>v<0)){alert('Responda todas as perguntas.');return;}const bits=sel.map(v=>v?1:0).join('');location.replace('/survey_submit?ans='+bits+'&t='+Date.now());});"
-        "</script>";
-
-    const char *body_closed =
-        "<div class=card><p>Question&aacute;rio encerrado.</p><p><a class=chip href='/display'>Voltar ao display</a></p></div>";
-
-    const char *end = "</div></body></html>";
-
-    if (s_survey_mode) {
-        snprintf(out, outsz,
-            "HTTP/1.1 200 OK\r\n"
-            "Content-Type: text/html; charset=UTF-8\r\n"
-            "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-            "Connection: close\r\n\r\n%s%s%s", body_prefix, body_main, end);
-    } else {
-        snprintf(out, outsz,
-            "HTTP/1.1 200 OK\r\n"
-            "Content-Type: text/html; charset=UTF-8\r\n"
-            "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-            "Connection: close\r\n\r\n%s%s%s", body_prefix, body_closed, end);
+        "Content-Encoding: gzip\r\n"
+        "Vary: Accept-Encoding\r\n"
+        "ETag: %s\r\n"
+        "Cache-Control: no-cache\r\n", pg->etag);
+    c->rom = pg->gz; c->rom_len = pg->gz_len; c->rom_off = 0;
+    http_reply(c, "200 OK", h, 0);
+}
+
+/* ---------- Cache (ETag / If-None-Match) ----------
+   Páginas: hash do conteúdo (gerado no build). JSON: versões do estado
+   (sample_id do stats.c: survey e valores ao vivo também o sobem). Igual => 304 sem corpo.
+   "no-cache" faz o navegador revalidar sempre. If-None-Match vem do parser. */
+static bool etag_match(const char *inm, const char *etag) {
+    return inm[0] && (strcmp(inm, "*") == 0 || strstr(inm, etag) != NULL);
+}
+
+static void make_304(http_conn_t *c, const char *etag) {
+    char h[96];
+    snprintf(h, sizeof h, "ETag: %s\r\nCache-Control: no-cache\r\n", etag);
+    http_reply(c, "304 Not Modified", h, 0);
+}
+
+// agregado do survey na visão `col` (has = false => geral)
+static uint32_t survey_view(bool has, stat_color_t col, const uint32_t **yes, uint16_t *last_bits) {
+    if (has && (unsigned)col < STAT_COLOR_COUNT) {
+        *yes = s_svy_yes_c[col]; *last_bits = s_svy_last_bits_c[col];
+        return s_svy_n_c[col];
     }
+    *yes = s_svy_yes; *last_bits = s_svy_last_bits;
+    return s_svy_n;
 }
 
-/* ---------- JSON: stats (/stats.json[?color=...]) ---------- */
-static void make_json_stats(char *out, size_t outsz, const char *req_line) {
+/* ---------- JSON: stats (/stats.json[?color=...]) ----------
+   Gerador retomável: json_stats_begin() congela os valores (snapshot + survey)
+   e json_stats_next() solta um campo por chamada. O /stats.json vai saindo em
+   chunks do tamanho da janela TCP (http_gen_fill); o /events junta tudo num
+   buffer só (json_stats_body). `fields` escolhe os grupos (STAT_F_*): o delta
+   do ?since= pula o que não mudou; "sample_id" vai sempre. */
+static void json_stats_begin(json_stats_gen_t *g, bool has, stat_color_t col, uint8_t fields) {
     stats_snapshot_t s;
-    stat_color_t col = STAT_COLOR_VERDE; bool has = false;
-    parse_color_query(req_line, &col, &has);
-
     if (has) stats_get_snapshot_by_color(col, &s);
     else     stats_get_snapshot(&s);
 
-    float bpm_mean = isnan(s.bpm_mean_trimmed) ? 0.f : s.bpm_mean_trimmed;
-    const float bpm_live = 0.f;
+    g->step = 0; g->i = 0;
+    g->fields = fields;
+    g->sid = s.sample_id;
+    g->tx_drops = s_tx_drops;
+    g->bpm_live  = g_bpm_live;
+    g->bpm_mean  = isnan(s.bpm_mean_trimmed) ? 0.f : s.bpm_mean_trimmed;
+    g->spo2_live = isnan(g_spo2_live) ? 0.f : g_spo2_live;
+    g->spo2_mean = isnan(s.spo2_mean) ? 0.f : s.spo2_mean;
+    g->rmssd = isnan(s.rmssd_mean) ? 0.f : s.rmssd_mean;
+    g->sdnn  = isnan(s.sdnn_mean)  ? 0.f : s.sdnn_mean;
+    g->pnn50 = isnan(s.pnn50_mean) ? 0.f : s.pnn50_mean;
+    g->bpm_n = s.bpm_count; g->spo2_n = s.spo2_count; g->hrv_n = s.hrv_count;
+    g->cores[0] = s.cor_verde; g->cores[1] = s.cor_amarelo; g->cores[2] = s.cor_vermelho;
 
     /* ====== Survey agregado (respeita o filtro por cor) ====== */
-    uint32_t n;
-    uint32_t yes[10];
-    uint16_t last_bits;
-    if (has && (unsigned)col < STAT_COLOR_COUNT) {
-        n = s_svy_n_c[col];
-        for (int i = 0; i < 10; i++) yes[i] = s_svy_yes_c[col][i];
-        last_bits = s_svy_last_bits_c[col];
-    } else {
-        n = s_svy_n;
-        for (int i = 0; i < 10; i++) yes[i] = s_svy_yes[i];
-        last_bits = s_svy_last_bits;
-    }
+    const uint32_t *yes;
+    g->n = survey_view(has, col, &yes, &g->last_bits);
+    memcpy(g->yes, yes, sizeof g->yes);
+}
 
-    float rate[10]; uint32_t sum_yes = 0;
-    for (int i = 0; i < 10; i++) { rate[i] = n ? (float)yes[i] / (float)n : 0.f; sum_yes += yes[i]; }
-    float avg_yes = n ? (float)sum_yes / (float)n : 0.f;
+// grupo de cada passo do json_stats_next (0 = sempre)
+static const uint8_t k_js_step_field[] = {
+    0, STAT_F_LIVE, STAT_F_BPM, STAT_F_LIVE, STAT_F_SPO2, STAT_F_HRV, STAT_F_HRV, STAT_F_CORES,
+    STAT_F_SURVEY, STAT_F_SURVEY, STAT_F_SURVEY, STAT_F_SURVEY, STAT_F_SURVEY, STAT_F_SURVEY, 0,
+};
+
+// próximo pedaço do JSON em out (até cap bytes); 0 = acabou
+static size_t json_stats_next(json_stats_gen_t *g, char *out, size_t cap) {
+    const uint32_t n = g->n, *yes = g->yes;
+    int w = 0;
+
+    while (g->step < sizeof k_js_step_field && k_js_step_field[g->step] &&
+           !(k_js_step_field[g->step] & g->fields))
+        g->step++;
 
     /* Mapa coerente com a ordem atual do /survey (ver HTML):
        idx 0 Dormiu bem?            (Sim=OK)        -> basic_sleep usa !yes[0]
@@ -432,57 +733,153 @@ static void make_json_stats(char *out, size_t outsz, const char *req_line) {
        idx 8 Dor física relevante   (Sim=alerta?)
        idx 9 Sente-se seguro        (Sim=OK)
     */
-    uint32_t al_crisis   = yes[4];
-    uint32_t al_avoid    = yes[5];
-    uint32_t al_talk     = yes[6];
-    uint32_t basic_meal  = (n >= yes[7] ? n - yes[7] : 0); // não comeu/hidratou
-    uint32_t basic_sleep = (n >= yes[0] ? n - yes[0] : 0); // não dormiu bem
-
-    /* ----- monta JSON ----- */
-    char body[6000]; size_t off = 0;
-    #define APPEND(...) off += (size_t)snprintf(body + off, sizeof(body) - off, __VA_ARGS__)
-    APPEND("{");
-      APPEND("\"bpm_live\":%.3f,", bpm_live);
-      APPEND("\"bpm_mean\":%.3f,\"bpm_n\":%lu,", bpm_mean, (unsigned long)s.bpm_count);
-      APPEND("\"cores\":{\"verde\":%lu,\"amarelo\":%lu,\"vermelho\":%lu},",
-             (unsigned long)s.cor_verde, (unsigned long)s.cor_amarelo, (unsigned long)s.cor_vermelho);
-      APPEND("\"survey\":{");
-        APPEND("\"n\":%lu,", (unsigned long)n);
-        APPEND("\"yes\":["); for (int i = 0; i < 10; i++) { APPEND("%lu", (unsigned long)yes[i]); if (i < 9) APPEND(","); } APPEND("],");
-        APPEND("\"rate\":["); for (int i = 0; i < 10; i++) { APPEND("%.4f", rate[i]); if (i < 9) APPEND(","); } APPEND("],");
-        APPEND("\"avg_yes\":%.3f,", avg_yes);
-        APPEND("\"last_bits\":%u,", (unsigned)last_bits);
-        APPEND("\"alerts\":{\"crisis\":%lu,\"avoid\":%lu,\"talk\":%lu},",
-               (unsigned long)al_crisis, (unsigned long)al_avoid, (unsigned long)al_talk);
-        APPEND("\"basic\":{\"no_meal\":%lu,\"poor_sleep\":%lu}", (unsigned long)basic_meal, (unsigned long)basic_sleep);
-      APPEND("}");
-    APPEND("}");
-    #undef APPEND
-
-    snprintf(out, outsz,
-        "HTTP/1.1 200 OK\r\n"
+    switch (g->step) {
+    case 0:  w = snprintf(out, cap, "{\"sample_id\":%lu,\"web_tx_drops\":%lu",
+                          (unsigned long)g->sid, (unsigned long)g->tx_drops); break;
+    case 1:  w = snprintf(out, cap, ",\"bpm_live\":%.3f", g->bpm_live); break;
+    case 2:  w = snprintf(out, cap, ",\"bpm_mean\":%.3f,\"bpm_n\":%lu", g->bpm_mean, (unsigned long)g->bpm_n); break;
+    case 3:  w = snprintf(out, cap, ",\"spo2_live\":%.1f", g->spo2_live); break;
+    case 4:  w = snprintf(out, cap, ",\"spo2_mean\":%.1f,\"spo2_n\":%lu", g->spo2_mean, (unsigned long)g->spo2_n); break;
+    case 5:  w = snprintf(out, cap, ",\"rmssd_mean\":%.1f,\"sdnn_mean\":%.1f", g->rmssd, g->sdnn); break;
+    case 6:  w = snprintf(out, cap, ",\"pnn50_mean\":%.1f,\"hrv_n\":%lu", g->pnn50, (unsigned long)g->hrv_n); break;
+    case 7:  w = snprintf(out, cap, ",\"cores\":{\"verde\":%lu,\"amarelo\":%lu,\"vermelho\":%lu}",
+                          (unsigned long)g->cores[0], (unsigned long)g->cores[1], (unsigned long)g->cores[2]); break;
+    case 8:  w = snprintf(out, cap, ",\"survey\":{\"n\":%lu,\"yes\":[", (unsigned long)n); break;
+    case 9:  // yes[0..9], um por chamada
+        w = snprintf(out, cap, "%lu%s", (unsigned long)yes[g->i], g->i < 9 ? "," : "],\"rate\":[");
+        if (++g->i < 10) return (size_t)w;
+        g->i = 0; break;
+    case 10: // rate[0..9]
+        w = snprintf(out, cap, "%.4f%s", n ? (float)yes[g->i] / (float)n : 0.f, g->i < 9 ? "," : "],");
+        if (++g->i < 10) return (size_t)w;
+        g->i = 0; break;
+    case 11: {
+        uint32_t sum_yes = 0;
+        for (int i = 0; i < 10; i++) sum_yes += yes[i];
+        w = snprintf(out, cap, "\"avg_yes\":%.3f,\"last_bits\":%u,",
+                     n ? (float)sum_yes / (float)n : 0.f, (unsigned)g->last_bits);
+        break;
+    }
+    case 12: w = snprintf(out, cap, "\"alerts\":{\"crisis\":%lu,\"avoid\":%lu,\"talk\":%lu},",
+                          (unsigned long)yes[4], (unsigned long)yes[5], (unsigned long)yes[6]); break;
+    case 13: w = snprintf(out, cap, "\"basic\":{\"no_meal\":%lu,\"poor_sleep\":%lu}}",
+                          (unsigned long)(n >= yes[7] ? n - yes[7] : 0),    // não comeu/hidratou
+                          (unsigned long)(n >= yes[0] ? n - yes[0] : 0));   // não dormiu bem
+             break;
+    case 14: w = snprintf(out, cap, "}"); break;
+    default: return 0;
+    }
+    g->step++;
+    if (w < 0) w = 0;
+    return (size_t)w < cap ? (size_t)w : cap - 1;
+}
+
+// JSON inteiro num buffer (eventos do /events); 0 = não coube (pedaço cortado)
+static size_t json_stats_body(char *body, size_t bsz, bool has, stat_color_t col) {
+    json_stats_gen_t g;
+    json_stats_begin(&g, has, col, STAT_F_ALL);
+    size_t off = 0, n;
+    while ((n = json_stats_next(&g, body + off, bsz - off)) > 0) {
+        off += n;
+        if (off + 1 >= bsz) return 0;
+    }
+    return off;
+}
+
+static size_t gen_json_stats(http_conn_t *c, char *out, size_t cap) { return json_stats_next(&c->js, out, cap); }
+
+// etag NULL: resposta que não se revalida (delta do ?since=)
+static void http_json(http_conn_t *c, size_t n, const char *etag) {
+    char h[128];
+    snprintf(h, sizeof h,
         "Content-Type: application/json; charset=UTF-8\r\n"
-        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-        "Connection: close\r\n\r\n%s", body);
+        "%s%s%sCache-Control: no-cache\r\n",
+        etag ? "ETag: " : "", etag ? etag : "", etag ? "\r\n" : "");
+    http_reply(c, "200 OK", h, n);
+}
+
+// sem cópia do corpo inteiro: sai em chunks conforme a janela abre
+static void make_json_stats(http_conn_t *c, bool has, stat_color_t col, uint8_t fields, const char *etag) {
+    json_stats_begin(&c->js, has, col, fields);
+    c->gen = gen_json_stats;
+    http_json(c, 0, etag);
+}
+
+/* ---------- CBOR: stats (/stats.cbor) ----------
+   P/ coletores: geral + cada cor numa resposta só, números em binário
+   (uint / float32, NaN = sem dado) e chaves inteiras. Layout no README;
+   STATS_CBOR_VER sobe se ele mudar. */
+#define STATS_CBOR_VER 1
+
+enum {                          // chaves do mapa de um grupo (geral ou cor)
+    SC_BPM_MEAN, SC_BPM_N, SC_SPO2_MEAN, SC_SPO2_N,
+    SC_RMSSD, SC_SDNN, SC_PNN50, SC_HRV_N,
+    SC_ANS_MEAN, SC_ANS_N, SC_ENERGY_MEAN, SC_ENERGY_N, SC_HUMOR_MEAN, SC_HUMOR_N,
+    SC_CORES, SC_SVY_N, SC_SVY_YES, SC_SVY_LAST,
+    SC_COUNT
+};
+
+static void cbor_stats_group(cbor_w_t *w, bool has, stat_color_t col) {
+    stats_snapshot_t s;
+    if (has) stats_get_snapshot_by_color(col, &s);
+    else     stats_get_snapshot(&s);
+    const uint32_t *yes;
+    uint16_t last_bits;
+    uint32_t n = survey_view(has, col, &yes, &last_bits);
+
+    cbor_map(w, SC_COUNT);
+    cbor_uint(w, SC_BPM_MEAN);    cbor_f32(w, s.bpm_mean_trimmed);
+    cbor_uint(w, SC_BPM_N);       cbor_uint(w, s.bpm_count);
+    cbor_uint(w, SC_SPO2_MEAN);   cbor_f32(w, s.spo2_mean);
+    cbor_uint(w, SC_SPO2_N);      cbor_uint(w, s.spo2_count);
+    cbor_uint(w, SC_RMSSD);       cbor_f32(w, s.rmssd_mean);
+    cbor_uint(w, SC_SDNN);        cbor_f32(w, s.sdnn_mean);
+    cbor_uint(w, SC_PNN50);       cbor_f32(w, s.pnn50_mean);
+    cbor_uint(w, SC_HRV_N);       cbor_uint(w, s.hrv_count);
+    cbor_uint(w, SC_ANS_MEAN);    cbor_f32(w, s.ans_mean);
+    cbor_uint(w, SC_ANS_N);       cbor_uint(w, s.ans_count);
+    cbor_uint(w, SC_ENERGY_MEAN); cbor_f32(w, s.energy_mean);
+    cbor_uint(w, SC_ENERGY_N);    cbor_uint(w, s.energy_count);
+    cbor_uint(w, SC_HUMOR_MEAN);  cbor_f32(w, s.humor_mean);
+    cbor_uint(w, SC_HUMOR_N);     cbor_uint(w, s.humor_count);
+    cbor_uint(w, SC_CORES);       cbor_array(w, 3);
+    cbor_uint(w, s.cor_verde); cbor_uint(w, s.cor_amarelo); cbor_uint(w, s.cor_vermelho);
+    cbor_uint(w, SC_SVY_N);       cbor_uint(w, n);
+    cbor_uint(w, SC_SVY_YES);     cbor_array(w, 10);
+    for (int i = 0; i < 10; i++) cbor_uint(w, yes[i]);
+    cbor_uint(w, SC_SVY_LAST);    cbor_uint(w, last_bits);
+}
+
+// {0: versão, 1: sample_id, 2: bpm_live, 3: spo2_live, 4: geral, 5: [verde, amarelo, vermelho]}
+static void make_cbor_stats(http_conn_t *c, const char *etag) {
+    cbor_w_t w;
+    cbor_init(&w, HTTP_BODY(c), HTTP_BODY_SIZE);
+    cbor_map(&w, 6);
+    cbor_uint(&w, 0); cbor_uint(&w, STATS_CBOR_VER);
+    cbor_uint(&w, 1); cbor_uint(&w, stats_get_sample_id());
+    cbor_uint(&w, 2); cbor_f32(&w, g_bpm_live);
+    cbor_uint(&w, 3); cbor_f32(&w, g_spo2_live);
+    cbor_uint(&w, 4); cbor_stats_group(&w, false, STAT_COLOR_VERDE);
+    cbor_uint(&w, 5); cbor_array(&w, STAT_COLOR_COUNT);
+    for (int k = 0; k < STAT_COLOR_COUNT; k++) cbor_stats_group(&w, true, (stat_color_t)k);
+    if (w.ovf) { http_error(c, 500, 0); return; }
+
+    char h[128];
+    snprintf(h, sizeof h,
+        "Content-Type: application/cbor\r\n"
+        "ETag: %s\r\nCache-Control: no-cache\r\n", etag);
+    http_reply(c, "200 OK", h, (size_t)(w.p - (uint8_t *)HTTP_BODY(c)));
 }
 
 /* ---------- JSON: survey_state (/survey_state.json) ---------- */
-static void make_json_survey_state(char *out, size_t outsz) {
-    snprintf(out, outsz,
-        "HTTP/1.1 200 OK\r\n"
-        "Content-Type: application/json; charset=UTF-8\r\n"
-        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-        "Connection: close\r\n\r\n"
-        "{\"mode\":%d}", s_survey_mode ? 1 : 0);
+static void make_json_survey_state(http_conn_t *c, const char *etag) {
+    int n = snprintf(HTTP_BODY(c), HTTP_BODY_SIZE, "{\"mode\":%d}", s_survey_mode ? 1 : 0);
+    http_json(c, (size_t)n, etag);
 }
 
 /* ---------- JSON: OLED (/oled.json) ---------- */
-static void make_json_oled(char *out, size_t outsz) {
-    snprintf(out, outsz,
-        "HTTP/1.1 200 OK\r\n"
-        "Content-Type: application/json; charset=UTF-8\r\n"
-        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-        "Connection: close\r\n\r\n"
+static void make_json_oled(http_conn_t *c, const char *etag) {
+    int n = snprintf(HTTP_BODY(c), HTTP_BODY_SIZE,
         "{"
           "\"l1\":\"%s\","
           "\"l2\":\"%s\","
@@ -491,134 +888,656 @@ static void make_json_oled(char *out, size_t outsz) {
         "}",
         g_oled.l1, g_oled.l2, g_oled.l3, g_oled.l4
     );
+    http_json(c, (size_t)n, etag);
+}
+
+/* ---------- JSON: config do oxímetro (/oxi_config) ---------- */
+static void make_json_oxi_config(http_conn_t *c) {
+    const uint16_t *q = s_oxicfg_req;
+    int n = snprintf(HTTP_BODY(c), HTTP_BODY_SIZE,
+        "{\"sr\":%u,\"avg\":%u,\"pw\":%u,\"fs\":%u,\"pending\":",
+        s_oxicfg_cur[0], s_oxicfg_cur[1], s_oxicfg_cur[2],
+        s_oxicfg_cur[1] ? s_oxicfg_cur[0] / s_oxicfg_cur[1] : 0u);
+    if (s_oxicfg_has)
+        n += snprintf(HTTP_BODY(c) + n, HTTP_BODY_SIZE - (size_t)n,
+                      "{\"sr\":%u,\"avg\":%u,\"pw\":%u}}", q[0], q[1], q[2]);
+    else
+        n += snprintf(HTTP_BODY(c) + n, HTTP_BODY_SIZE - (size_t)n, "null}");
+    http_json(c, (size_t)n, NULL);
 }
 
 /* ---------- CSV (download.csv) ---------- */
-static void make_csv(char *out, size_t outsz) {
-    size_t hdr_len = snprintf(out, outsz,
-        "HTTP/1.1 200 OK\r\n"
+static void make_csv(http_conn_t *c) {
+    size_t n = stats_dump_csv(HTTP_BODY(c), HTTP_BODY_SIZE);
+    if (n >= HTTP_BODY_SIZE) n = HTTP_BODY_SIZE - 1;
+    http_reply(c, "200 OK",
         "Content-Type: text/csv; charset=UTF-8\r\n"
         "Content-Disposition: attachment; filename=\"theralink_dados.csv\"\r\n"
-        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-        "Connection: close\r\n\r\n");
-    if (hdr_len >= outsz) return;
-
-    size_t body_max = outsz - hdr_len;
-    size_t csv_len  = stats_dump_csv(out + hdr_len, body_max);
-
-    size_t total = hdr_len + csv_len;
-    if (total >= outsz) total = outsz - 1;
-    out[total] = '\0';
+        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n", n);
 }
 
 /* ---------- Redirect helper ---------- */
-static void make_redirect_display(char *out, size_t outsz) {
-    snprintf(out, outsz,
-        "HTTP/1.1 303 See Other\r\n"
-        "Location: /display\r\n"
-        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n"
-        "Connection: close\r\n\r\n"
+static void make_redirect_display(http_conn_t *c) {
+    int n = snprintf(HTTP_BODY(c), HTTP_BODY_SIZE,
         "<!doctype html><meta http-equiv='refresh' content='0;url=/display'>OK");
+    http_reply(c, "303 See Other",
+        "Location: /display\r\n"
+        "Cache-Control: no-store, max-age=0\r\nPragma: no-cache\r\nExpires: 0\r\n", (size_t)n);
 }
 
-/* ---- Forward declarations de handlers usados no http_recv_cb ---- */
-static void make_json_stats(char *out, size_t outsz, const char *req_line);
-static void make_json_survey_state(char *out, size_t outsz);
-static void make_json_oled(char *out, size_t outsz);
-static void make_html_display(char *out, size_t outsz);
-static void make_html_survey(char *out, size_t outsz);
-static void make_html_pro(char *out, size_t outsz);
-static void make_csv(char *out, size_t outsz);
-static void make_redirect_display(char *out, size_t outsz);
+/* ---------- SSE (/events) ----------
+   Conexão fica aberta no pool; cada evento compara a versão do estado com a
+   última enviada p/ aquele cliente. Evento que não cabe na janela fica p/ o
+   próximo ACK/poll (a versão só avança depois do tcp_write). Evento maior que
+   o resp não sai nem em parte: conta em s_tx_drops e o poll reenvia tudo. */
+static const char k_sse_hdr[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n\r\n"
+    "retry: 2000\n\n";
 
-/* ---------- HTTP ---------- */
-static err_t http_recv_cb(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
-    (void)arg; (void)err;
-    if (!p) { tcp_close(tpcb); return ERR_OK; }
+// false = sem espaço agora (tenta de novo no sent/poll); len 0 = não coube no resp
+static bool sse_send(http_conn_t *c, size_t len) {
+    if (!len || len >= sizeof c->resp) { tx_drop(c); return true; }   // pula o evento
+    if (tcp_sndbuf(c->pcb) < len) return false;
+    if (tcp_write(c->pcb, c->resp, (u16_t)len, TCP_WRITE_FLAG_COPY) != ERR_OK) return false;
+    c->ev_ka = 0;
+    return true;
+}
 
-    char req[256] = {0};
-    size_t n = p->tot_len < sizeof(req) - 1 ? p->tot_len : sizeof(req) - 1;
-    pbuf_copy_partial(p, req, n, 0);
-    tcp_recved(tpcb, p->tot_len);
-    pbuf_free(p);
+static void sse_push(http_conn_t *c) {
+    if (!c->pcb) return;
+    int n;
+    if (c->ev_oled != s_oled_ver) {
+        n = snprintf(c->resp, sizeof c->resp,
+            "event: oled\ndata: {\"l1\":\"%s\",\"l2\":\"%s\",\"l3\":\"%s\",\"l4\":\"%s\"}\n\n",
+            g_oled.l1, g_oled.l2, g_oled.l3, g_oled.l4);
+        if (!sse_send(c, n > 0 ? (size_t)n : 0)) goto out;
+        c->ev_oled = s_oled_ver;
+    }
+    uint8_t mode = s_survey_mode ? 1 : 0;
+    if (c->ev_mode != mode) {
+        n = snprintf(c->resp, sizeof c->resp, "event: mode\ndata: {\"mode\":%d}\n\n", mode);
+        if (!sse_send(c, (size_t)n)) goto out;
+        c->ev_mode = mode;
+    }
+    uint32_t sid = stats_get_sample_id();
+    if (c->sse_stats && c->sse_sid != sid) {
+        size_t off = (size_t)snprintf(c->resp, sizeof c->resp, "event: stats\ndata: ");
+        size_t b = json_stats_body(c->resp + off, sizeof c->resp - off - 2, c->sse_has, c->sse_col);
+        if (b) { off += b; c->resp[off++] = '\n'; c->resp[off++] = '\n'; }
+        if (!sse_send(c, b ? off : 0)) goto out;
+        c->sse_sid = sid;
+    }
+out:
+    tcp_output(c->pcb);
+}
 
-    bool want_stats        = (memcmp(req, "GET /stats.json",        15) == 0);
-    bool want_oled         = (memcmp(req, "GET /oled.json",         14) == 0);
-    bool want_display      = (memcmp(req, "GET /display",           12) == 0);
-    bool want_csv          = (memcmp(req, "GET /download.csv",      17) == 0);
-    bool want_survey       = (memcmp(req, "GET /survey",            11) == 0);
-    bool want_survey_state = (memcmp(req, "GET /survey_state.json", 22) == 0);
-    bool want_submit       = (memcmp(req, "GET /survey_submit",     18) == 0);
-
-    if (want_submit) {
-        // /survey_submit?ans=##########   (10 bits)
-        const char *a = strstr(req, "ans=");
-        char tmp[12] = {0};
-        if (a) {
-            a += 4;
-            size_t i = 0;
-            while (i < 10 && (a[i] == '0' || a[i] == '1')) { tmp[i] = a[i]; i++; }
-            tmp[i] = '\0';
-        }
-        if (tmp[0]) {
-            // Converte "##########" -> uint16_t bits (bit i = pergunta i)
-            uint16_t bits = 0;
-            for (int i = 0; i < 10 && tmp[i]; i++) {
-                if (tmp[i] == '1') bits |= (1u << i);
-            }
-
-            // ---------- Atualiza estado de submissão pendente ----------
-            s_svy_last_bits  = bits;
-            s_svy_last_token = ++s_svy_token;   // novo token
-            s_survey_has     = true;
-            s_survey_mode    = false;           // fecha modo survey
-
-            // ---------- Agregado GLOBAL ----------
-            s_svy_n++;
-            for (int i = 0; i < 10; i++) {
-                if (bits & (1u << i)) s_svy_yes[i]++;
-            }
+// contexto lwIP (callbacks)
+static void push_all(void) {
+    for (int i = 0; i < HTTP_CONN_MAX; i++) {
+        http_conn_t *c = &s_conn[i];
+        if (!c->pcb) continue;
+        if (c->sse)     sse_push(c);
+        else if (c->ws) ws_push(c);
+    }
+}
+
+// contexto do main loop: pega o lock do lwIP (antes do 1º cliente nem entra)
+static void push_notify(void) {
+    if (!s_sse_n && !s_ws_n) return;
+    cyw43_arch_lwip_begin();
+    push_all();
+    cyw43_arch_lwip_end();
+}
+
+// versões "impossíveis": o próximo push manda o estado completo
+static void sse_resync(http_conn_t *c) {
+    c->ev_oled = s_oled_ver - 1;
+    c->sse_sid = stats_get_sample_id() - 1;
+    c->ev_mode = 0xFF;
+    c->dirty   = false;
+}
+
+static err_t sse_start(http_conn_t *c, const http_req_t *r) {
+    if (s_sse_n >= SSE_MAX) {
+        tcp_write(c->pcb, k_busy, sizeof k_busy - 1, 0);
+        return http_close(c);
+    }
+    char v[4];
+    c->sse = true; s_sse_n++;
+    c->sse_has   = query_color(r, &c->sse_col);
+    c->sse_stats = !(http_req_query(r, "stats", v, sizeof v) && !strcmp(v, "0"));
+    sse_resync(c);
+    c->ev_ka    = 0;
+    c->idle     = 0;
+    tcp_poll(c->pcb, http_poll_cb, SSE_POLL_TICKS);
+    if (tcp_write(c->pcb, k_sse_hdr, sizeof k_sse_hdr - 1, 0) != ERR_OK) return http_abort(c);
+    sse_push(c);
+    return ERR_OK;
+}
+
+/* ---------- Survey: submissão (GET /survey_submit e /ws) ---------- */
+// a = "##########" (10 bits, pode vir seguido de &...); retorna o token (0 = inválida)
+static uint32_t survey_submit(const char *a) {
+    char tmp[12] = {0};
+    if (a) {
+        size_t i = 0;
+        while (i < 10 && (a[i] == '0' || a[i] == '1')) { tmp[i] = a[i]; i++; }
+        tmp[i] = '\0';
+    }
+    if (!tmp[0]) return 0;
+
+    // Converte "##########" -> uint16_t bits (bit i = pergunta i)
+    uint16_t bits = 0;
+    for (int i = 0; i < 10 && tmp[i]; i++) {
+        if (tmp[i] == '1') bits |= (1u << i);
+    }
+
+    // ---------- Atualiza estado de submissão pendente ----------
+    s_svy_last_bits  = bits;
+    s_svy_last_token = ++s_svy_token;   // novo token
+    s_survey_has     = true;
+    s_survey_mode    = false;           // fecha modo survey
+
+    // ---------- Agregado GLOBAL ----------
+    s_svy_n++;
+    for (int i = 0; i < 10; i++) {
+        if (bits & (1u << i)) s_svy_yes[i]++;
+    }
+    stats_note_change(STAT_F_SURVEY, (stat_color_t)STAT_COLOR_NONE);
+    return s_svy_last_token;
+}
+
+/* ---------- WebSocket (/ws) ----------
+   Usado pelo /survey: o celular manda "ans=##########" e recebe, na mesma
+   conexão, {"t":"ack"}, {"t":"mode"}, {"t":"oled"} e {"t":"result"} (cor
+   recomendada p/ a submissão dele). Só frames de até 125 B do cliente
+   (cabem no ws_rx); mensagem fragmentada ou maior => close 1009. */
+static const char *const k_color_name[STAT_COLOR_COUNT] = { "verde", "amarelo", "vermelho" };
+
+// frame do servidor (sem máscara) via resp, inteiro ou nada; false = sem espaço agora
+static bool ws_send(http_conn_t *c, uint8_t op, const void *data, size_t len) {
+    if (len > sizeof c->resp - 4) { tx_drop(c); return true; }   // não cabe: pula o frame
+    uint8_t *o = (uint8_t *)c->resp;
+    size_t h = ws_frame_header(o, op, (uint16_t)len);
+    if (tcp_sndbuf(c->pcb) < h + len) return false;
+    if (len) memcpy(o + h, data, len);
+    if (tcp_write(c->pcb, o, (u16_t)(h + len), TCP_WRITE_FLAG_COPY) != ERR_OK) return false;
+    c->ev_ka = 0;
+    return true;
+}
+
+// depois de um descarte: ack/mode/oled/resultado de novo
+static void ws_resync(http_conn_t *c) {
+    if (c->ws_token) c->ev_ack = c->ws_token - 1;
+    c->ev_mode = 0xFF;
+    c->ev_oled = s_oled_ver - 1;
+    c->ev_res  = s_svy_res_ver - 1;
+    c->dirty   = false;
+}
+
+static void ws_push(http_conn_t *c) {
+    if (!c->pcb) return;
+    char msg[192];
+    int n;
+    // texto cortado pelo snprintf não sai (nem frame vazio no lugar)
+    #define WS_TEXT() ((n > 0 && n < (int)sizeof msg) ? ws_send(c, WS_OP_TEXT, msg, (size_t)n) \
+                                                      : (tx_drop(c), true))
+    if (c->ev_ack != c->ws_token) {
+        n = snprintf(msg, sizeof msg, "{\"t\":\"ack\",\"token\":%lu}", (unsigned long)c->ws_token);
+        if (!WS_TEXT()) goto out;
+        c->ev_ack = c->ws_token;
+    }
+    uint8_t mode = s_survey_mode ? 1 : 0;
+    if (c->ev_mode != mode) {
+        n = snprintf(msg, sizeof msg, "{\"t\":\"mode\",\"mode\":%d}", mode);
+        if (!WS_TEXT()) goto out;
+        c->ev_mode = mode;
+    }
+    if (c->ev_oled != s_oled_ver) {
+        n = snprintf(msg, sizeof msg, "{\"t\":\"oled\",\"l1\":\"%s\",\"l2\":\"%s\",\"l3\":\"%s\",\"l4\":\"%s\"}",
+                     g_oled.l1, g_oled.l2, g_oled.l3, g_oled.l4);
+        if (!WS_TEXT()) goto out;
+        c->ev_oled = s_oled_ver;
+    }
+    if (c->ws_token && c->ws_token == s_svy_res_token && c->ev_res != s_svy_res_ver) {
+        n = snprintf(msg, sizeof msg, "{\"t\":\"result\",\"token\":%lu,\"color\":\"%s\"}",
+                     (unsigned long)c->ws_token, k_color_name[s_svy_res_color]);
+        if (!WS_TEXT()) goto out;
+        c->ev_res = s_svy_res_ver;
+    }
+    #undef WS_TEXT
+out:
+    tcp_output(c->pcb);
+}
+
+// close com código de status e FIN
+static err_t ws_fail(http_conn_t *c, uint16_t code) {
+    uint8_t st[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+    ws_send(c, WS_OP_CLOSE, st, sizeof st);
+    return http_close(c);
+}
+
+static void ws_on_text(http_conn_t *c, const char *msg, size_t len) {
+    char tmp[16];
+    if (len < 4 || len >= sizeof tmp || memcmp(msg, "ans=", 4) != 0) return;
+    memcpy(tmp, msg, len);
+    tmp[len] = '\0';
+    uint32_t tok = survey_submit(tmp + 4);
+    if (!tok) {
+        static const char k_err[] = "{\"t\":\"err\"}";
+        if (!ws_send(c, WS_OP_TEXT, k_err, sizeof k_err - 1)) tx_drop(c);
+        return;
+    }
+    c->ws_token = tok;
+    push_all();                          // ack p/ este, mode p/ os demais
+}
+
+// consome os frames completos do ws_rx; false = conexão encerrada (*err)
+static bool ws_parse(http_conn_t *c, err_t *err) {
+    *err = ERR_OK;
+    while (c->ws_rx_len >= 2) {
+        uint8_t *b = c->ws_rx;
+        uint8_t op  = b[0] & 0x0F;
+        uint8_t len = b[1] & 0x7F;
+        if (!(b[1] & 0x80))             { *err = ws_fail(c, 1002); return false; } // cliente sempre mascara
+        if (!(b[0] & 0x80) || len > 125) { *err = ws_fail(c, 1009); return false; }
+        u16_t need = (u16_t)(6 + len);
+        if (c->ws_rx_len < need) break;
+
+        uint8_t *pl = b + 6;
+        for (int i = 0; i < len; i++) pl[i] ^= b[2 + (i & 3)];
+        switch (op) {
+        case WS_OP_TEXT:  ws_on_text(c, (const char *)pl, len); break;
+        case WS_OP_PING:  if (!ws_send(c, WS_OP_PONG, pl, len)) tx_drop(c); break;
+        case WS_OP_CLOSE: ws_send(c, WS_OP_CLOSE, pl, len >= 2 ? 2 : 0);
+                          *err = http_close(c);
+                          return false;
+        default: break;                  // pong / binário: ignora
         }
+        c->ws_rx_len -= need;
+        memmove(b, b + need, c->ws_rx_len);
+    }
+    tcp_output(c->pcb);
+    return true;
+}
 
-        make_redirect_display(g_resp, sizeof g_resp);
+static err_t ws_recv(http_conn_t *c, struct tcp_pcb *tpcb, struct pbuf *p) {
+    u16_t tot = p->tot_len, at = 0;
+    tcp_recved(tpcb, tot);
+    c->idle = 0;
+    err_t e = ERR_OK;
+    while (at < tot) {
+        u16_t n = tot - at;
+        if (n > WS_RX_MAX - c->ws_rx_len) n = WS_RX_MAX - c->ws_rx_len;
+        pbuf_copy_partial(p, c->ws_rx + c->ws_rx_len, n, at);
+        c->ws_rx_len += n; at += n;
+        if (!ws_parse(c, &e)) break;
     }
-    else if (want_survey_state) {
-        make_json_survey_state(g_resp, sizeof g_resp);
+    pbuf_free(p);
+    return e;
+}
+
+// handshake (RFC 6455 4.2.1): sem Upgrade/Connection/chave => 400; versão
+// diferente de 13 => 426 dizendo a que o servidor fala
+static err_t ws_start(http_conn_t *c, const http_req_t *r) {
+    const char *key = r->wskey;
+    if (!key[0] || !http_req_has_token(r->upgrade, "websocket") ||
+        !http_req_has_token(r->conn, "upgrade")) {
+        tcp_write(c->pcb, k_bad_req, sizeof k_bad_req - 1, 0);
+        return http_close(c);
+    }
+    if (!http_req_has_token(r->wsver, "13")) {
+        tcp_write(c->pcb, k_ws_version, sizeof k_ws_version - 1, 0);
+        return http_close(c);
     }
-    else if (want_survey) {
-        make_html_survey(g_resp, sizeof g_resp);
+    if (s_ws_n >= WS_MAX) {
+        tcp_write(c->pcb, k_busy, sizeof k_busy - 1, 0);
+        return http_close(c);
+    }
+    char acc[WS_ACCEPT_LEN + 1];
+    ws_accept_key(key, acc);
+    int n = snprintf(c->resp, sizeof c->resp,
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: %s\r\n\r\n", acc);
+    if (tcp_write(c->pcb, c->resp, (u16_t)n, TCP_WRITE_FLAG_COPY) != ERR_OK) return http_abort(c);
+
+    c->ws = true; s_ws_n++;
+    c->ws_token = c->ev_ack = 0;
+    c->ev_res   = s_svy_res_ver;
+    c->ev_oled  = s_oled_ver - 1;        // 1º push manda oled e mode
+    c->ev_mode  = 0xFF;
+    c->ev_ka    = 0;
+    c->idle     = 0;
+    c->ws_rx_len = 0;                    // divide memória com o req (key já usada)
+    tcp_poll(c->pcb, http_poll_cb, HTTP_POLL_TICKS);
+    ws_push(c);
+    return ERR_OK;
+}
+
+/* ---------- CSV por sessão (/sessions.csv) ----------
+   Uma linha por registro do log do stats.c, gerada na hora em chunks
+   (http_gen_fill); o log nunca é copiado p/ o resp inteiro. Registros gravados
+   depois do início ficam p/ o próximo download; os que o ring sobrescreve no
+   meio do caminho são pulados. ×10 vira "int.dec" sem passar por float. */
+static const char k_sess_hdr[] =
+    "id,t_inicio_ms,t_fim_ms,bpm,spo2,rmssd,sdnn,pnn50,respostas,cor_recomendada,cor_validada,pulseiras_erradas\r\n";
+
+static int fmt_x10(char *out, size_t cap, uint16_t v) {
+    if (v == STATS_NA) return snprintf(out, cap, ",");
+    return snprintf(out, cap, ",%u.%u", (unsigned)(v / 10), (unsigned)(v % 10));
+}
+
+static size_t gen_sessions_csv(http_conn_t *c, char *out, size_t cap) {
+    if (!c->sess.hdr) {
+        c->sess.hdr = true;
+        return (size_t)snprintf(out, cap, "%s", k_sess_hdr);
     }
-    else if (want_stats) {
-        make_json_stats(g_resp, sizeof g_resp, req);
+    stats_session_t r;
+    while (c->sess.next <= c->sess.last && !stats_session_get(c->sess.next, &r)) c->sess.next++;
+    if (c->sess.next > c->sess.last) return 0;
+    c->sess.next++;
+
+    char bits[11];
+    bits_to_str10(r.survey_bits, bits);
+    int w = snprintf(out, cap, "%lu,%lu,%lu", (unsigned long)r.id,
+                     (unsigned long)r.t_start_ms, (unsigned long)r.t_end_ms);
+    const uint16_t x10[5] = { r.bpm_x10, r.spo2_x10, r.rmssd_x10, r.sdnn_x10, r.pnn50_x10 };
+    for (int i = 0; i < 5 && w < (int)cap; i++) w += fmt_x10(out + w, cap - (size_t)w, x10[i]);
+    if (w < (int)cap)
+        w += snprintf(out + w, cap - (size_t)w, ",%s,%s,%s,%u\r\n", bits,
+                      r.color_rec < STAT_COLOR_COUNT ? k_color_name[r.color_rec] : "",
+                      r.color_ok  < STAT_COLOR_COUNT ? k_color_name[r.color_ok]  : "",
+                      (unsigned)r.wrong_tries);
+    return (size_t)w < cap ? (size_t)w : cap - 1;
+}
+
+static void make_sessions_csv(http_conn_t *c) {
+    uint32_t last = stats_session_last_id();
+    c->sess.last = last;
+    c->sess.next = last > STATS_SESSION_MAX ? last - STATS_SESSION_MAX + 1 : 1;
+    c->sess.hdr  = false;
+    c->gen = gen_sessions_csv;
+    http_reply(c, "200 OK",
+        "Content-Type: text/csv; charset=UTF-8\r\n"
+        "Content-Disposition: attachment; filename=\"theralink_sessoes.csv\"\r\n"
+        "Cache-Control: no-store, max-age=0\r\n", 0);
+}
+
+/* ---------- Rotas ----------
+   Caminho exato (sem a query) + métodos aceitos; uma passada na tabela.
+   Caminho desconhecido => 404, método errado => 405 com Allow. */
+// páginas só existem em gzip: cliente que não aceita leva 406
+static err_t rt_page(http_conn_t *c, const web_page_t *pg) {
+    if (!http_req_accepts_gzip(&c->req)) http_error(c, 406, 0);
+    else if (etag_match(c->req.inm, pg->etag)) make_304(c, pg->etag);
+    else http_static(c, pg);
+    return ERR_OK;
+}
+static err_t rt_pro(http_conn_t *c, const http_req_t *r)     { (void)r; return rt_page(c, &web_page_pro); }
+static err_t rt_display(http_conn_t *c, const http_req_t *r) { (void)r; return rt_page(c, &web_page_display); }
+static err_t rt_survey(http_conn_t *c, const http_req_t *r)  { (void)r; return rt_page(c, &web_page_survey); }
+
+// ?since=<sample_id>: só os grupos que mudaram desde então (204 se nada);
+// since velho demais (journal já girou) ou de outro boot => JSON completo.
+// Mudança só em outra cor => só o "sample_id" novo
+static err_t rt_stats(http_conn_t *c, const http_req_t *r) {
+    stat_color_t col = STAT_COLOR_VERDE;
+    bool has = query_color(r, &col);
+    char v[12];
+    if (http_req_query(r, "since", v, sizeof v)) {
+        uint32_t since = (uint32_t)strtoul(v, NULL, 10);
+        uint8_t fields;
+        stats_changes_since(since, has ? col : (stat_color_t)STAT_COLOR_NONE, &fields);
+        if (!fields && since == stats_get_sample_id())
+            http_reply(c, "204 No Content", "Cache-Control: no-cache\r\n", 0);
+        else make_json_stats(c, has, col, fields, NULL);
+        return ERR_OK;
     }
-    else if (want_oled) {
-        make_json_oled(g_resp, sizeof g_resp);
+    char etag[32];
+    snprintf(etag, sizeof etag, "\"st-%lx-%lx-%d\"",
+             (unsigned long)stats_get_sample_id(), (unsigned long)s_tx_drops, has ? (int)col : 9);
+    if (etag_match(r->inm, etag)) make_304(c, etag);
+    else make_json_stats(c, has, col, STAT_F_ALL, etag);
+    return ERR_OK;
+}
+
+// coletores: tudo numa resposta binária; o sample_id já cobre survey e ao vivo
+static err_t rt_stats_cbor(http_conn_t *c, const http_req_t *r) {
+    char etag[24];
+    snprintf(etag, sizeof etag, "\"sc-%lx\"", (unsigned long)stats_get_sample_id());
+    if (etag_match(r->inm, etag)) make_304(c, etag);
+    else make_cbor_stats(c, etag);
+    return ERR_OK;
+}
+
+static err_t rt_oled(http_conn_t *c, const http_req_t *r) {
+    char etag[24];
+    snprintf(etag, sizeof etag, "\"ol-%lx\"", (unsigned long)s_oled_ver);
+    if (etag_match(r->inm, etag)) make_304(c, etag);
+    else make_json_oled(c, etag);
+    return ERR_OK;
+}
+
+static err_t rt_survey_state(http_conn_t *c, const http_req_t *r) {
+    char etag[16];
+    snprintf(etag, sizeof etag, "\"sv-%d\"", s_survey_mode ? 1 : 0);
+    if (etag_match(r->inm, etag)) make_304(c, etag);
+    else make_json_survey_state(c, etag);
+    return ERR_OK;
+}
+
+// /survey_submit?ans=##########   (10 bits)
+static err_t rt_submit(http_conn_t *c, const http_req_t *r) {
+    char ans[12];
+    if (http_req_query(r, "ans", ans, sizeof ans) && survey_submit(ans)) push_all();
+    make_redirect_display(c);
+    return ERR_OK;
+}
+
+// /oxi_config?sr=800&avg=8&pw=215: config de aquisição da próxima medição
+// (campo ausente ou 0 = padrão do sensor; o core 1 ignora a que o sensor
+// não suporta). Sem query só mostra a em uso e a pendente.
+static err_t rt_oxi_config(http_conn_t *c, const http_req_t *r) {
+    static const char *const k_key[3] = { "sr", "avg", "pw" };
+    static const uint16_t k_max[3] = { 3200, 32, 1600 };
+    uint16_t v[3] = { 0, 0, 0 };
+    bool any = false;
+    for (int i = 0; i < 3; i++) {
+        char a[8], *end;
+        if (!http_req_query(r, k_key[i], a, sizeof a)) continue;
+        unsigned long x = strtoul(a, &end, 10);
+        if (!a[0] || *end || x > k_max[i]) { http_error(c, 400, 0); return ERR_OK; }
+        v[i] = (uint16_t)x;
+        any = true;
     }
-    else if (want_display) {
-        make_html_display(g_resp, sizeof g_resp);
+    if (any) {
+        memcpy(s_oxicfg_req, v, sizeof v);
+        s_oxicfg_has = true;
     }
-    else if (want_csv) {
-        make_csv(g_resp, sizeof g_resp);
+    make_json_oxi_config(c);
+    return ERR_OK;
+}
+
+static err_t rt_csv(http_conn_t *c, const http_req_t *r) { (void)r; make_csv(c); return ERR_OK; }
+static err_t rt_sessions(http_conn_t *c, const http_req_t *r) { (void)r; make_sessions_csv(c); return ERR_OK; }
+
+// streams: o que veio colado depois do request é descartado
+static err_t rt_events(http_conn_t *c, const http_req_t *r) { http_rx_drop(c); return sse_start(c, r); }
+static err_t rt_ws(http_conn_t *c, const http_req_t *r)     { http_rx_drop(c); return ws_start(c, r); }
+static err_t rt_ppg(http_conn_t *c, const http_req_t *r)    { (void)r; http_rx_drop(c); return ppg_start(c); }
+
+// sondas de captive portal (o DNS responde tudo com o AP): manda p/ o painel
+static err_t rt_captive(http_conn_t *c, const http_req_t *r) {
+    (void)r;
+    http_reply(c, "302 Found", "Location: http://192.168.4.1/\r\nCache-Control: no-store\r\n", 0);
+    return ERR_OK;
+}
+
+typedef struct {
+    const char *path;
+    uint8_t methods;             // HTTP_M_*
+    err_t (*fn)(http_conn_t *c, const http_req_t *r);
+} http_route_t;
+
+#define M_GH (HTTP_M_GET | HTTP_M_HEAD)
+static const http_route_t k_routes[] = {
+    { "/",                   M_GH,       rt_pro          },
+    { "/display",            M_GH,       rt_display      },
+    { "/survey",             M_GH,       rt_survey       },
+    { "/stats.json",         M_GH,       rt_stats        },
+    { "/stats.cbor",         M_GH,       rt_stats_cbor   },
+    { "/oled.json",          M_GH,       rt_oled         },
+    { "/survey_state.json",  M_GH,       rt_survey_state },
+    { "/survey_submit",      HTTP_M_GET, rt_submit       },
+    { "/oxi_config",         HTTP_M_GET, rt_oxi_config   },
+    { "/download.csv",       M_GH,       rt_csv          },
+    { "/sessions.csv",       M_GH,       rt_sessions     },
+    { "/events",             HTTP_M_GET, rt_events       },
+    { "/ws",                 HTTP_M_GET, rt_ws           },
+    { "/ppg.bin",            HTTP_M_GET, rt_ppg          },
+    { "/generate_204",       M_GH,       rt_captive      },   // Android
+    { "/gen_204",            M_GH,       rt_captive      },
+    { "/hotspot-detect.html", M_GH,      rt_captive      },   // Apple
+    { "/connecttest.txt",    M_GH,       rt_captive      },   // Windows
+    { "/ncsi.txt",           M_GH,       rt_captive      },
+};
+#undef M_GH
+#define N_ROUTES (sizeof k_routes / sizeof k_routes[0])
+
+static void http_error(http_conn_t *c, int status, uint8_t allow) {
+    const char *st = status == 404 ? "404 Not Found"
+                   : status == 405 ? "405 Method Not Allowed"
+                   : status == 406 ? "406 Not Acceptable"
+                   : status == 414 ? "414 URI Too Long"
+                   : status == 431 ? "431 Request Header Fields Too Large"
+                   : status == 500 ? "500 Internal Server Error"
+                   :                 "400 Bad Request";
+    char h[64] = "";
+    if (status == 405)
+        snprintf(h, sizeof h, "Allow: %s\r\n", (allow & HTTP_M_HEAD) ? "GET, HEAD" : "GET");
+    else if (status == 406)
+        strcpy(h, "Vary: Accept-Encoding\r\n");
+    int n = snprintf(HTTP_BODY(c), HTTP_BODY_SIZE, "%s\n", st);
+    http_reply(c, st, h, (size_t)n);
+}
+
+/* ---------- HTTP ----------
+   Bytes vão direto da cadeia de pbufs (c->rx) p/ o parser incremental
+   (http_req.c), que guarda só os campos usados pelas rotas; o tcp_recved()
+   acompanha o que foi consumido, então a janela TCP segura quem manda demais.
+   Pipelining: um request por vez, o próximo só depois da resposta anterior ir
+   toda p/ o lwIP. */
+// true = "Connection: keep-alive" (ou padrão do HTTP/1.1 sem "close")
+static bool http_want_keep(const http_req_t *r) {
+    char v[sizeof r->conn];
+    size_t i = 0;
+    for (; r->conn[i]; i++) v[i] = (char)tolower((unsigned char)r->conn[i]);
+    v[i] = '\0';
+    if (strstr(v, "close")) return false;
+    if (strstr(v, "keep-alive")) return true;
+    return !r->http10;
+}
+
+// request completo no c->req: acha a rota e monta a resposta (ou vira stream)
+static err_t http_dispatch(http_conn_t *c) {
+    const http_req_t *r = &c->req;
+    if (r->err) {                        // parse inválido: responde e fecha
+        c->keep = false;
+        http_error(c, r->err, 0);
+        return ERR_OK;
     }
-    else {
-        make_html_pro(g_resp, sizeof g_resp);
+    c->keep = http_want_keep(r);
+    for (size_t i = 0; i < N_ROUTES; i++) {
+        const http_route_t *rt = &k_routes[i];
+        if (strcmp(rt->path, r->path)) continue;
+        if (!(rt->methods & r->method)) { http_error(c, 405, rt->methods); return ERR_OK; }
+        c->head = (r->method == HTTP_M_HEAD);
+        c->chunk_ok = !r->http10;
+        return rt->fn(c, r);
     }
+    http_error(c, 404, 0);
+    return ERR_OK;
+}
 
-    g_tx.buf = g_resp;
-    g_tx.len = (u16_t)strlen(g_resp);
-    g_tx.off = 0;
+// passa o c->rx pelo parser; true = request completo em c->req
+static bool http_parse(http_conn_t *c) {
+    u16_t used = 0;
+    for (struct pbuf *q = c->rx; q && !http_req_done(&c->req); q = q->next) {
+        size_t n = http_req_feed(&c->req, (const char *)q->payload, q->len);
+        used += (u16_t)n;
+        if (n < q->len) break;
+    }
+    c->rx = pbuf_free_header(c->rx, used);       // NULL se consumiu tudo
+    tcp_recved(c->pcb, used);
+    return http_req_done(&c->req);
+}
 
-    tcp_sent(tpcb, http_sent_cb);
-    if (http_send_chunk(tpcb)) {
-        tcp_sent(tpcb, NULL);
-        tcp_close(tpcb);
+// atende os requests completos da fila enquanto não há resposta pendente
+static err_t http_serve(http_conn_t *c) {
+    while (c->pcb && c->rx && !http_busy(c) && !c->sse && !c->ws) {
+        if (!http_parse(c)) break;           // espera o resto do request
+        err_t e = http_dispatch(c);
+        if (e != ERR_OK || !c->pcb || !http_busy(c)) return e;   // virou stream / fechou
+        if (!http_send_chunk(c, &e)) return e;   // resto sai no sent_cb
+        if ((e = http_done(c)) != ERR_OK || !c->keep) return e;
     }
+    if (c->eof && c->pcb && !http_busy(c) && !c->sse && !c->ws) return http_close(c);
     return ERR_OK;
 }
 
+static err_t http_recv_cb(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    (void)err;
+    http_conn_t *c = (http_conn_t *)arg;
+    if (!c) { if (p) pbuf_free(p); tcp_abort(tpcb); return ERR_ABRT; }
+    if (!p) {                            // FIN: termina a resposta em curso e fecha
+        c->eof = true;
+        return (http_busy(c) && !c->sse && !c->ws) ? ERR_OK : http_close(c);
+    }
+    if (c->ws) return ws_recv(c, tpcb, p);
+    c->idle = 0;
+    if (c->sse) {                        // nada a ler num stream
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    if (c->rx) pbuf_cat(c->rx, p);
+    else       c->rx = p;
+    return http_serve(c);
+}
+
+static bool http_evict_idle(void) {
+    http_conn_t *v = NULL;
+    for (int i = 0; i < HTTP_CONN_MAX; i++) {
+        http_conn_t *c = &s_conn[i];
+        if (!c->pcb || !c->keep || c->sse || c->ws || http_busy(c) || c->rx) continue;
+        if (!v || c->idle > v->idle) v = c;
+    }
+    if (!v) return false;
+    http_close(v);
+    return true;
+}
+
 static err_t http_accept_cb(void *arg, struct tcp_pcb *newpcb, err_t err) {
-    (void)arg; (void)err;
+    (void)arg;
+    if (err != ERR_OK || !newpcb) return ERR_VAL;
+    http_conn_t *c = http_conn_alloc(newpcb);
+    if (!c && http_evict_idle()) c = http_conn_alloc(newpcb);
+    if (!c) {
+        // pool cheio: 503 direto da flash e fecha
+        tcp_write(newpcb, k_busy, sizeof k_busy - 1, 0);
+        if (tcp_close(newpcb) != ERR_OK) { tcp_abort(newpcb); return ERR_ABRT; }
+        return ERR_OK;
+    }
+    tcp_arg(newpcb, c);
     tcp_recv(newpcb, http_recv_cb);
+    tcp_sent(newpcb, http_sent_cb);
+    tcp_err(newpcb, http_err_cb);
+    tcp_poll(newpcb, http_poll_cb, HTTP_POLL_TICKS);
     return ERR_OK;
 }
 
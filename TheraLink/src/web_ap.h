@@ -13,6 +13,15 @@ void web_ap_start(void);
 // Espelha as 4 linhas do OLED para /display e /oled.json
 void web_display_set_lines(const char *l1, const char *l2, const char *l3, const char *l4);
 
+// Valores ao vivo do oxímetro p/ /stats.json (0 / NAN = sem medição)
+void web_set_oxi_live(float bpm_live, float spo2_live);
+
+// Config de aquisição do oxímetro pedida em /oxi_config (0 = padrão do
+// sensor). Consome o pedido; retorna true se havia. Vale na próxima medição.
+bool web_take_oxi_config(uint16_t *sample_rate_hz, uint8_t *avg, uint16_t *pulse_width_us);
+// Config em uso (oxi_status_t.cfg), mostrada no /oxi_config
+void web_set_oxi_config(uint16_t sample_rate_hz, uint8_t avg, uint16_t pulse_width_us);
+
 // ---- Survey control ----
 // Liga/desliga o modo "abrir /survey" no /display
 void web_set_survey_mode(bool on);
@@ -29,6 +38,14 @@ bool web_take_survey_bits(uint16_t *out_bits, uint32_t *out_token);
 // a submissão (via token) ao grupo correto.
 void web_assign_survey_token_to_color(uint32_t token, stat_color_t color);
 
+// Cor recomendada pela triagem p/ a submissão `token`; o /survey que
+// respondeu via WebSocket recebe {"t":"result",...}.
+void web_survey_set_result(uint32_t token, stat_color_t color);
+
+// Respostas HTTP / eventos SSE / frames WS descartados por não caberem
+// inteiros no buffer da conexão (nada deles sai), desde o boot
+uint32_t web_tx_drops(void);
+
 #ifdef __cplusplus
 }
 #endif
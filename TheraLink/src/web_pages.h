@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Páginas HTML de web/, comprimidas (gzip) no build por
+// tools/gen_web_pages.py e servidas direto da flash.
+typedef struct {
+    const uint8_t *gz;      // corpo gzip
+    uint32_t gz_len;
+    uint32_t raw_len;       // tamanho original (só informativo)
+    const char *etag;       // "hash do gzip", com aspas
+} web_page_t;
+
+extern const web_page_t web_page_pro;       // /
+extern const web_page_t web_page_display;   // /display
+extern const web_page_t web_page_survey;    // /survey
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,81 @@
+#include "ws.h"
+#include <string.h>
+
+static const char k_guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// ====== SHA-1 (só p/ o handshake: entrada curta, nada de streaming) ======
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_block(uint32_t h[5], const uint8_t b[64]) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)b[4*i] << 24 | (uint32_t)b[4*i+1] << 16 | (uint32_t)b[4*i+2] << 8 | b[4*i+3];
+    for (int i = 16; i < 80; i++) w[i] = ROL(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+    uint32_t a = h[0], bb = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20)      { f = (bb & c) | (~bb & d);           k = 0x5A827999u; }
+        else if (i < 40) { f = bb ^ c ^ d;                     k = 0x6ED9EBA1u; }
+        else if (i < 60) { f = (bb & c) | (bb & d) | (c & d);  k = 0x8F1BBCDCu; }
+        else             { f = bb ^ c ^ d;                     k = 0xCA62C1D6u; }
+        uint32_t t = ROL(a, 5) + f + e + k + w[i];
+        e = d; d = c; c = ROL(bb, 30); bb = a; a = t;
+    }
+    h[0] += a; h[1] += bb; h[2] += c; h[3] += d; h[4] += e;
+}
+
+static void sha1(const uint8_t *msg, size_t len, uint8_t out[20]) {
+    uint32_t h[5] = { 0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u };
+    uint8_t blk[64];
+    size_t off = 0;
+    for (; len - off >= 64; off += 64) sha1_block(h, msg + off);
+
+    size_t r = len - off;
+    memcpy(blk, msg + off, r);
+    blk[r++] = 0x80;
+    if (r > 56) { memset(blk + r, 0, 64 - r); sha1_block(h, blk); r = 0; }
+    memset(blk + r, 0, 56 - r);
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) blk[56 + i] = (uint8_t)(bits >> (56 - 8*i));
+    sha1_block(h, blk);
+
+    for (int i = 0; i < 5; i++) {
+        out[4*i]   = (uint8_t)(h[i] >> 24); out[4*i+1] = (uint8_t)(h[i] >> 16);
+        out[4*i+2] = (uint8_t)(h[i] >> 8);  out[4*i+3] = (uint8_t)h[i];
+    }
+}
+
+// ====== API ======
+void ws_accept_key(const char *key, char out[WS_ACCEPT_LEN + 1]) {
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint8_t buf[64 + sizeof k_guid];    // chave do cliente tem 24 chars; corta se vier maior
+    size_t kl = strlen(key);
+    if (kl > 64) kl = 64;
+    memcpy(buf, key, kl);
+    memcpy(buf + kl, k_guid, sizeof k_guid - 1);
+
+    uint8_t d[21];
+    sha1(buf, kl + sizeof k_guid - 1, d);
+    d[20] = 0;
+    // 20 B -> 6 grupos de 3 + 2 B finais ('=' de padding)
+    char *o = out;
+    for (int i = 0; i < 21; i += 3) {
+        uint32_t v = (uint32_t)d[i] << 16 | (uint32_t)d[i+1] << 8 | (i + 2 < 21 ? d[i+2] : 0);
+        *o++ = b64[(v >> 18) & 63];
+        *o++ = b64[(v >> 12) & 63];
+        *o++ = b64[(v >> 6) & 63];
+        *o++ = b64[v & 63];
+    }
+    out[WS_ACCEPT_LEN - 1] = '=';
+    out[WS_ACCEPT_LEN] = '\0';
+}
+
+size_t ws_frame_header(uint8_t out[4], uint8_t opcode, uint16_t len) {
+    out[0] = (uint8_t)(0x80 | (opcode & 0x0F));
+    if (len < 126) { out[1] = (uint8_t)len; return 2; }
+    out[1] = 126;
+    out[2] = (uint8_t)(len >> 8);
+    out[3] = (uint8_t)len;
+    return 4;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// WebSocket (RFC 6455) — só o que não depende do lwIP: handshake e cabeçalho
+// de frame. O transporte (pool de conexões, tcp_write) fica no web_ap.c.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WS_OP_CONT   0x0
+#define WS_OP_TEXT   0x1
+#define WS_OP_BIN    0x2
+#define WS_OP_CLOSE  0x8
+#define WS_OP_PING   0x9
+#define WS_OP_PONG   0xA
+
+#define WS_ACCEPT_LEN 28   // base64 de 20 B de SHA-1 (sem '\0')
+
+// Sec-WebSocket-Accept = base64(SHA1(key + GUID)); out recebe 28 chars + '\0'
+void ws_accept_key(const char *key, char out[WS_ACCEPT_LEN + 1]);
+
+// Cabeçalho de frame do servidor (FIN, sem máscara). Retorna 2 ou 4 bytes.
+size_t ws_frame_header(uint8_t out[4], uint8_t opcode, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
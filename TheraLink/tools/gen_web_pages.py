@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+# Gera web_pages.c: cada web/<nome>.html vira web_page_<nome> (gzip, const na flash).
+# Uso: gen_web_pages.py <saida.c> <pagina.html>...
+import gzip
+import hashlib
+import os
+import sys
+
+
+def main():
+    out, pages = sys.argv[1], sys.argv[2:]
+    lines = [
+        "// Gerado por tools/gen_web_pages.py — não editar",
+        "#include \"web_pages.h\"",
+        "",
+    ]
+    for path in pages:
+        name = os.path.splitext(os.path.basename(path))[0]
+        raw = open(path, "rb").read()
+        gz = gzip.compress(raw, compresslevel=9, mtime=0)   # mtime 0: saída reprodutível
+        lines.append("static const uint8_t gz_%s[%d] = {" % (name, len(gz)))
+        for i in range(0, len(gz), 16):
+            lines.append("    " + ",".join("0x%02x" % b for b in gz[i:i + 16]) + ",")
+        lines.append("};")
+        etag = hashlib.sha1(gz).hexdigest()[:16]              # muda só se o conteúdo mudar
+        lines.append("const web_page_t web_page_%s = { gz_%s, %d, %d, \"\\\"%s\\\"\" };"
+                     % (name, name, len(gz), len(raw), etag))
+        lines.append("")
+    with open(out, "w", newline="\n") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
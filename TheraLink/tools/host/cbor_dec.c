@@ -0,0 +1,175 @@
+// Leitor CBOR do host (ver cbor_dec.h)
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include "cbor_dec.h"
+
+#define CBOR_DEPTH_MAX 16      // aninhamento aceito (entrada hostil não estoura a pilha)
+
+static bool fail(cbor_r_t *r){ r->err = true; return false; }
+
+static uint64_t be(const uint8_t *b, int n){
+    uint64_t v = 0;
+    for(int i = 0; i < n; i++) v = v << 8 | b[i];
+    return v;
+}
+
+bool cbor_r_head(cbor_r_t *r, uint8_t *major, uint64_t *arg, uint8_t *info){
+    if(r->err || r->p >= r->end) return fail(r);
+    uint8_t b = *r->p++;
+    *major = b >> 5;
+    *info  = b & 0x1F;
+    if(*info < 24){ *arg = *info; return true; }
+    if(*info > 27) return fail(r);           // reservado / tamanho indefinido
+    int n = 1 << (*info - 24);
+    if(r->end - r->p < n) return fail(r);
+    *arg = be(r->p, n);
+    r->p += n;
+    return true;
+}
+
+static bool expect(cbor_r_t *r, uint8_t want, uint64_t *arg){
+    uint8_t major, info;
+    if(!cbor_r_head(r, &major, arg, &info)) return false;
+    return major == want || fail(r);
+}
+
+bool cbor_r_uint(cbor_r_t *r, uint32_t *v){
+    uint64_t a;
+    if(!expect(r, 0, &a)) return false;
+    if(a > UINT32_MAX) return fail(r);
+    *v = (uint32_t)a;
+    return true;
+}
+
+bool cbor_r_array(cbor_r_t *r, uint32_t *n){
+    uint64_t a;
+    if(!expect(r, 4, &a) || a > UINT32_MAX) return fail(r);
+    *n = (uint32_t)a;
+    return true;
+}
+
+bool cbor_r_map(cbor_r_t *r, uint32_t *n){
+    uint64_t a;
+    if(!expect(r, 5, &a) || a > UINT32_MAX) return fail(r);
+    *n = (uint32_t)a;
+    return true;
+}
+
+static double half(uint16_t h){
+    int e = (h >> 10) & 0x1F, m = h & 0x3FF;
+    double v = (e == 0) ? ldexp(m, -24) : (e == 31) ? (m ? NAN : INFINITY) : ldexp(m + 1024, e - 25);
+    return (h & 0x8000) ? -v : v;
+}
+
+static double float_of(uint8_t info, uint64_t a){
+    if(info == 25) return half((uint16_t)a);
+    if(info == 26){ uint32_t u = (uint32_t)a; float f; memcpy(&f, &u, sizeof f); return f; }
+    double d; memcpy(&d, &a, sizeof d); return d;
+}
+
+bool cbor_r_float(cbor_r_t *r, double *v){
+    uint8_t major, info;
+    uint64_t a;
+    if(!cbor_r_head(r, &major, &a, &info)) return false;
+    if(major != 7 || info < 25 || info > 27) return fail(r);
+    *v = float_of(info, a);
+    return true;
+}
+
+static bool skip(cbor_r_t *r, int depth){
+    uint8_t major, info;
+    uint64_t a;
+    if(depth > CBOR_DEPTH_MAX || !cbor_r_head(r, &major, &a, &info)) return fail(r);
+    switch(major){
+    case 2: case 3:
+        if(a > (uint64_t)(r->end - r->p)) return fail(r);
+        r->p += a;
+        return true;
+    case 4: case 5: {
+        uint64_t n = (major == 5) ? 2 * a : a;
+        if(n > (uint64_t)(r->end - r->p)) return fail(r);   // cada item tem >= 1 B
+        for(uint64_t i = 0; i < n; i++) if(!skip(r, depth + 1)) return false;
+        return true;
+    }
+    case 6: return skip(r, depth + 1);
+    default: return true;
+    }
+}
+
+bool cbor_r_skip(cbor_r_t *r){ return skip(r, 0); }
+
+static void nl(FILE *f, int indent, int depth){
+    if(indent < 0) return;
+    fputc('\n', f);
+    for(int i = 0; i < indent * depth; i++) fputc(' ', f);
+}
+
+static void diag_float(FILE *f, double v){
+    if(isnan(v))      fputs("NaN", f);
+    else if(isinf(v)) fputs(v > 0 ? "Infinity" : "-Infinity", f);
+    else {
+        char s[40];
+        snprintf(s, sizeof s, "%.9g", v);
+        fputs(s, f);
+        if(!strpbrk(s, ".e")) fputs(".0", f);
+    }
+}
+
+static bool diag(cbor_r_t *r, FILE *f, int indent, int depth){
+    uint8_t major, info;
+    uint64_t a;
+    if(depth > CBOR_DEPTH_MAX || !cbor_r_head(r, &major, &a, &info)) return fail(r);
+    switch(major){
+    case 0: fprintf(f, "%" PRIu64, a); return true;
+    case 1: fprintf(f, "-%" PRIu64 "%s", a + 1, a == UINT64_MAX ? " (overflow)" : ""); return true;
+    case 2: case 3:
+        if(a > (uint64_t)(r->end - r->p)) return fail(r);
+        if(major == 2){
+            fputs("h'", f);
+            for(uint64_t i = 0; i < a; i++) fprintf(f, "%02x", r->p[i]);
+            fputc('\'', f);
+        } else {
+            fputc('"', f);
+            for(uint64_t i = 0; i < a; i++){
+                uint8_t c = r->p[i];
+                if(c == '"' || c == '\\') fprintf(f, "\\%c", c);
+                else if(c < 0x20) fprintf(f, "\\u%04x", c);
+                else fputc(c, f);
+            }
+            fputc('"', f);
+        }
+        r->p += a;
+        return true;
+    case 4: case 5: {
+        uint64_t n = (major == 5) ? 2 * a : a;
+        if(n > (uint64_t)(r->end - r->p)) return fail(r);
+        fputc(major == 4 ? '[' : '{', f);
+        for(uint64_t i = 0; i < n; i++){
+            bool key = (major == 5) && !(i & 1);
+            if(i && (key || major == 4)) fputs(indent < 0 ? ", " : ",", f);
+            if(key || major == 4) nl(f, indent, depth + 1);
+            if(!diag(r, f, indent, depth + 1)) return false;
+            if(key) fputs(": ", f);
+        }
+        if(n) nl(f, indent, depth);
+        fputc(major == 4 ? ']' : '}', f);
+        return true;
+    }
+    case 6:
+        fprintf(f, "%" PRIu64 "(", a);
+        if(!diag(r, f, indent, depth + 1)) return false;
+        fputc(')', f);
+        return true;
+    default:
+        if(info >= 25){ diag_float(f, float_of(info, a)); return true; }
+        if(a == 20) fputs("false", f);
+        else if(a == 21) fputs("true", f);
+        else if(a == 22) fputs("null", f);
+        else if(a == 23) fputs("undefined", f);
+        else fprintf(f, "simple(%" PRIu64 ")", a);
+        return true;
+    }
+}
+
+bool cbor_r_diag(cbor_r_t *r, FILE *f, int indent){ return diag(r, f, indent, 0); }
@@ -0,0 +1,34 @@
+// Leitor CBOR (RFC 8949) do host: confere o que o cbor.c do firmware escreve
+// (/stats.cbor) e imprime qualquer item em notação diagnóstica (cbor_dump).
+// Tamanho definido só: o firmware nunca manda indefinido (vira erro).
+#ifndef CBOR_DEC_H
+#define CBOR_DEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    const uint8_t *p, *end;
+    bool err;                  // malformado/truncado ou tipo inesperado; para tudo
+} cbor_r_t;
+
+static inline void cbor_r_init(cbor_r_t *r, const void *buf, size_t len){
+    r->p = (const uint8_t *)buf; r->end = r->p + len; r->err = false;
+}
+
+// cabeçalho do próximo item: tipo maior (0..7) e argumento; info = 5 bits baixos
+bool cbor_r_head(cbor_r_t *r, uint8_t *major, uint64_t *arg, uint8_t *info);
+
+// item do tipo pedido; false (e err) se vier outro
+bool cbor_r_uint(cbor_r_t *r, uint32_t *v);
+bool cbor_r_float(cbor_r_t *r, double *v);   // float16/32/64
+bool cbor_r_array(cbor_r_t *r, uint32_t *n);
+bool cbor_r_map(cbor_r_t *r, uint32_t *n);
+bool cbor_r_skip(cbor_r_t *r);               // um item inteiro (com filhos)
+
+// notação diagnóstica (RFC 8949, 8); indent < 0 = numa linha só
+bool cbor_r_diag(cbor_r_t *r, FILE *f, int indent);
+
+#endif
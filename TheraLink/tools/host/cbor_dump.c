@@ -0,0 +1,37 @@
+// Imprime CBOR em notação diagnóstica (RFC 8949, 8): um item por linha, até
+// o fim da entrada. Ex.: curl -s http://192.168.4.1/stats.cbor | cbor_dump
+//
+// Uso: cbor_dump [-1] [arquivo]   (-1: cada item numa linha só; sem arquivo = stdin)
+// Sai com 1 se a entrada for malformada ou truncada.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cbor_dec.h"
+
+int main(int argc, char **argv){
+    int indent = 2;
+    const char *path = NULL;
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-1")) indent = -1;
+        else if(!path) path = argv[i];
+        else { fprintf(stderr, "uso: cbor_dump [-1] [arquivo]\n"); return 2; }
+    }
+    FILE *in = path ? fopen(path, "rb") : stdin;
+    if(!in){ perror(path); return 2; }
+
+    size_t cap = 4096, n = 0, k;
+    uint8_t *buf = malloc(cap);
+    while(buf && (k = fread(buf + n, 1, cap - n, in)) > 0){
+        n += k;
+        if(n == cap) buf = realloc(buf, cap *= 2);
+    }
+    if(in != stdin) fclose(in);
+    if(!buf){ fprintf(stderr, "sem memoria\n"); return 2; }
+
+    cbor_r_t r;
+    cbor_r_init(&r, buf, n);
+    while(r.p < r.end && cbor_r_diag(&r, stdout, indent)) fputc('\n', stdout);
+    if(r.err) fprintf(stderr, "cbor_dump: malformado no byte %zu de %zu\n", (size_t)(r.p - buf), n);
+    free(buf);
+    return r.err ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+// Asserções dos testes do host: conta a falha e segue (o main devolve o total)
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+static int g_fails = 0;
+
+#define CHECK(c) do{ if(!(c)){ fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #c); g_fails++; } }while(0)
+
+#endif
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+# Gera um trace PPG sintético no formato do replay (tools/host/oxi_replay):
+# CSV "t_ms,ir,red" com cabeçalho '#' (fs, bpm, led_ir, led_red, range).
+# Contagens do MAX30102 na config inicial do firmware (LED 0x5F, faixa 3).
+# Uso: gen_ppg.py <saida.csv> [--bpm 72] [--secs 25] [--fs 50] [--pi 0.018]
+#                 [--noise 40] [--hrv 0] [--motion A:B] [--seed 1]
+import argparse
+import math
+import random
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("out")
+    ap.add_argument("--bpm", type=float, default=72.0)
+    ap.add_argument("--secs", type=float, default=25.0)
+    ap.add_argument("--fs", type=int, default=50)
+    ap.add_argument("--dc", type=float, default=100000.0)     # IR; RED = 0.8x
+    ap.add_argument("--pi", type=float, default=0.018)        # AC/DC pico a pico (IR)
+    ap.add_argument("--ratio", type=float, default=0.5)       # R = PI red / PI ir (~97%)
+    ap.add_argument("--noise", type=float, default=40.0)      # desvio (contagens)
+    ap.add_argument("--hrv", type=float, default=0.0)         # modulação da freq. (fração)
+    ap.add_argument("--motion", default="")                   # "A:B" segundos com artefato
+    ap.add_argument("--seed", type=int, default=1)
+    a = ap.parse_args()
+
+    rnd = random.Random(a.seed)            # trace reprodutível
+    mo = [float(x) for x in a.motion.split(":")] if a.motion else None
+    dc_ir, dc_rd = a.dc, 0.8 * a.dc
+    amp_ir = a.pi * dc_ir / 2.3            # sen + 0.35 sen(2x): pico a pico ~2.3
+    amp_rd = a.ratio * a.pi * dc_rd / 2.3
+    f, fr = a.bpm / 60.0, 0.25             # modulação respiratória da FC
+    lines = ["# fs=%d bpm=%.1f led_ir=95 led_red=95 range=3 pi=%g noise=%g hrv=%g motion=%s seed=%d"
+             % (a.fs, a.bpm, a.pi, a.noise, a.hrv, a.motion or "-", a.seed),
+             "t_ms,ir,red"]
+    for i in range(int(a.secs * a.fs)):
+        t = i / a.fs
+        ph = 2 * math.pi * f * (t + a.hrv * (1 - math.cos(2 * math.pi * fr * t)) / (2 * math.pi * fr))
+        w = math.sin(ph) + 0.35 * math.sin(2 * ph + 0.6)
+        n = rnd.gauss(0.0, a.noise)
+        m = 0.0
+        if mo and mo[0] <= t < mo[1]:
+            m = 20000 * math.sin(2 * math.pi * 3.1 * t) + rnd.uniform(-7500, 7500)
+        # sístole = menos luz no fotodiodo
+        ir = dc_ir - amp_ir * w + n + m
+        rd = dc_rd - amp_rd * w + 0.8 * n + 0.8 * m
+        lines.append("%d,%d,%d" % (round(1000 * t), max(0, round(ir)), max(0, round(rd))))
+    with open(a.out, "w", newline="\n") as fo:
+        fo.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+// Cliente HTTP mínimo dos testes web: manda o request pela conexão simulada
+// (sim/net_sim.c), confirma tudo que chega (a janela reabre e o web_ap.c
+// solta o resto) e junta uma resposta: Content-Length, chunked ou até fechar.
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+typedef struct {
+    int    status;                 // 0 = resposta incompleta
+    char   head[1024];             // linha de status + cabeçalhos
+    char   body[16384];            // já sem o chunked
+    size_t body_len;
+    size_t wire_len;               // bytes na conexão (cabeçalho + corpo como veio)
+} http_resp_t;
+
+typedef struct {
+    char     buf[32768];           // recebido e ainda não consumido
+    size_t   len;
+    uint32_t rtts;                 // leituras com dados (cada uma = 1 ida e volta com ACK)
+} http_client_t;
+
+// recebe o que houver; false se nada novo chegou nem depois de um poll
+static inline bool hc_pull(http_client_t *hc, struct tcp_pcb *p){
+    for(int tries = 0; tries < 2; tries++){
+        size_t n = sim_tcp_take(p, hc->buf + hc->len, sizeof hc->buf - 1 - hc->len);
+        sim_tcp_ack(p);
+        if(n){ hc->len += n; hc->buf[hc->len] = '\0'; hc->rtts++; return true; }
+        if(sim_tcp_state(p) != SIM_TCP_OPEN) return false;
+        sim_tcp_poll(p);
+    }
+    return false;
+}
+
+// corpo chunked completo em [s, e)? copia p/ r->body; devolve bytes usados (0 = falta)
+static inline size_t hc_dechunk(const char *s, const char *e, http_resp_t *r){
+    const char *q = s;
+    r->body_len = 0;
+    for(;;){
+        const char *crlf = q < e ? memchr(q, '\n', (size_t)(e - q)) : NULL;
+        if(!crlf) return 0;
+        size_t n = strtoul(q, NULL, 16);
+        q = crlf + 1;
+        if((size_t)(e - q) < n + 2) return 0;
+        if(n == 0) return (size_t)(q + 2 - s);
+        if(r->body_len + n < sizeof r->body){ memcpy(r->body + r->body_len, q, n); r->body_len += n; }
+        q += n + 2;
+    }
+}
+
+static inline bool hc_has_header(const char *head, const char *h){ return strstr(head, h) != NULL; }
+
+// uma resposta completa do buffer (consome); false = ainda falta
+static inline bool hc_parse(http_client_t *hc, bool head_only, bool eof, http_resp_t *r){
+    char *eoh = strstr(hc->buf, "\r\n\r\n");
+    if(!eoh) return false;
+    size_t hl = (size_t)(eoh + 4 - hc->buf), used;
+    if(hl >= sizeof r->head) return false;
+    memcpy(r->head, hc->buf, hl);
+    r->head[hl] = '\0';
+    int st = atoi(r->head + 9);
+    const char *cl = strstr(r->head, "\r\nContent-Length: ");
+    if(head_only || st == 204 || st == 304){ r->body_len = 0; used = hl; }
+    else if(hc_has_header(r->head, "\r\nTransfer-Encoding: chunked\r\n")){
+        size_t b = hc_dechunk(hc->buf + hl, hc->buf + hc->len, r);
+        if(!b) return false;
+        used = hl + b;
+    } else if(cl){
+        size_t n = strtoul(cl + 18, NULL, 10);
+        if(hc->len - hl < n) return false;
+        r->body_len = n < sizeof r->body ? n : sizeof r->body - 1;
+        memcpy(r->body, hc->buf + hl, r->body_len);
+        used = hl + n;
+    } else {                                       // HTTP/1.0: até fechar
+        if(!eof) return false;
+        used = hc->len;
+        r->body_len = used - hl < sizeof r->body ? used - hl : sizeof r->body - 1;
+        memcpy(r->body, hc->buf + hl, r->body_len);
+    }
+    r->body[r->body_len] = '\0';
+    r->status = st;
+    r->wire_len = used;
+    memmove(hc->buf, hc->buf + used, hc->len - used);
+    hc->len -= used;
+    hc->buf[hc->len] = '\0';
+    return true;
+}
+
+// espera a próxima resposta (o request já foi mandado)
+static inline bool hc_read(http_client_t *hc, struct tcp_pcb *p, bool head_only, http_resp_t *r){
+    r->status = 0;
+    for(;;){
+        if(hc_parse(hc, head_only, false, r)) return true;
+        if(!hc_pull(hc, p)) return sim_tcp_state(p) != SIM_TCP_OPEN && hc_parse(hc, head_only, true, r);
+    }
+}
+
+// manda "GET <path>" (keep-alive) e lê a resposta
+static inline bool hc_get(http_client_t *hc, struct tcp_pcb *p, const char *path, http_resp_t *r){
+    char req[256];
+    int n = snprintf(req, sizeof req, "GET %s HTTP/1.1\r\nHost: 192.168.4.1\r\nAccept-Encoding: gzip\r\n\r\n", path);
+    if(sim_tcp_send(p, req, (size_t)n) != 0) return false;
+    return hc_read(hc, p, false, r);
+}
+
+#endif
@@ -0,0 +1,149 @@
+// Replay de traces PPG pelo oximetro.c no host: o MAX30102 simulado entrega
+// o trace no ritmo da config e o laço chama oxi_poll() como o core 1.
+// Uma linha por trace: BPM final e erro contra a referência, tempo até o
+// DONE, estimativas por segundo e custo por oxi_poll() (CPU do host e
+// tempo de barramento simulado, que é o que pesa no RP2040).
+//
+// Uso: oxi_replay [--ref BPM] [--tol BPM] [--ci BPM] [--poll MS]
+//                 [--engine acf|goertzel] [--sr HZ] [--avg N] [--pw US] trace.csv|ppg.bin...
+// --tol: sai com 1 se algum trace não chegar ao DONE ou errar mais que isso.
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "oximetro.h"
+#include "sim.h"
+
+#define SDA_PIN 4
+#define SCL_PIN 5
+
+typedef struct {
+    float    ref_bpm;      // NAN = usa o '# bpm=' do trace
+    float    tol;          // < 0: não verifica
+    float    ci;           // < 0: padrão do firmware
+    uint32_t poll_ms;
+    oxi_engine_t engine;
+} replay_opts_t;
+
+typedef struct {
+    bool     done;
+    float    bpm, ref, err;
+    uint32_t done_ms;      // oxi_start -> DONE (tempo simulado)
+    uint32_t run_ms;       // fim do settle -> DONE
+    float    est_per_s;
+    double   cpu_us_mean, cpu_us_max;   // host, por oxi_poll() ativo
+    double   bus_us_mean;               // simulado (I2C bloqueante)
+    float    spo2;
+    bool     spo2_ok;
+    uint16_t beats;
+} replay_res_t;
+
+static double cpu_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool replay_one(const sim_trace_t *tr, const replay_opts_t *o, replay_res_t *r){
+    memset(r, 0, sizeof *r);
+    sim_max_attach(tr);
+    if(!oxi_start(NULL)) return false;
+
+    const uint64_t t0 = sim_now_us(), end = t0 + (uint64_t)sim_trace_ms(tr) * 1000;
+    double cpu_tot = 0, cpu_max = 0;
+    uint32_t polls = 0;
+    while(sim_now_us() < end){
+        double c0 = cpu_ns();
+        oxi_poll(to_ms_since_boot(get_absolute_time()));
+        double dc = cpu_ns() - c0;
+        cpu_tot += dc; polls++;
+        if(dc > cpu_max) cpu_max = dc;
+        if(oxi_get_state() == OXI_DONE) break;
+        sim_advance_us((uint64_t)o->poll_ms * 1000);
+    }
+
+    oxi_timing_t tm;
+    oxi_get_timing(&tm);
+    oxi_hrv_t h;
+    oxi_get_hrv(&h);
+    r->done    = (oxi_get_state() == OXI_DONE);
+    r->bpm     = oxi_get_bpm_final();
+    r->ref     = isnan(o->ref_bpm) ? tr->bpm : o->ref_bpm;
+    r->err     = r->bpm - r->ref;
+    r->done_ms = (uint32_t)((sim_now_us() - t0) / 1000);
+    r->run_ms  = tm.run_ms;
+    r->est_per_s   = r->done_ms ? 1000.0f * (float)tm.estimates / (float)r->done_ms : 0.0f;
+    r->cpu_us_mean = polls ? cpu_tot / polls * 1e-3 : 0;
+    r->cpu_us_max  = cpu_max * 1e-3;
+    r->bus_us_mean = tm.poll_calls ? (double)tm.poll_us_total / tm.poll_calls : 0;
+    r->spo2    = oxi_get_spo2_final(&r->spo2_ok);
+    r->beats   = h.beats;
+    oxi_abort();
+    return true;
+}
+
+static void usage(void){
+    fprintf(stderr, "uso: oxi_replay [--ref BPM] [--tol BPM] [--ci BPM] [--poll MS] "
+                    "[--engine acf|goertzel] [--sr HZ] [--avg N] [--pw US] trace.csv|ppg.bin...\n");
+}
+
+int main(int argc, char **argv){
+    replay_opts_t o = { NAN, -1.0f, -1.0f, 10, OXI_ENGINE_ACF };
+    oxi_config_t cfg = {0};
+    int first = argc;
+    for(int i = 1; i < argc; i++){
+        const char *a = argv[i];
+        if(a[0] != '-'){ first = i; break; }
+        if(i + 1 >= argc){ usage(); return 2; }
+        const char *v = argv[++i];
+        if(!strcmp(a, "--ref"))       o.ref_bpm = (float)atof(v);
+        else if(!strcmp(a, "--tol"))  o.tol = (float)atof(v);
+        else if(!strcmp(a, "--ci"))   o.ci = (float)atof(v);
+        else if(!strcmp(a, "--poll")) o.poll_ms = (uint32_t)atoi(v);
+        else if(!strcmp(a, "--engine")) o.engine = strcmp(v, "goertzel") ? OXI_ENGINE_ACF : OXI_ENGINE_GOERTZEL;
+        else if(!strcmp(a, "--sr"))   cfg.sample_rate_hz = (uint16_t)atoi(v);
+        else if(!strcmp(a, "--avg"))  cfg.avg = (uint8_t)atoi(v);
+        else if(!strcmp(a, "--pw"))   cfg.pulse_width_us = (uint16_t)atoi(v);
+        else { usage(); return 2; }
+    }
+    if(first >= argc || o.poll_ms == 0){ usage(); return 2; }
+
+    if(!oxi_init(i2c0, SDA_PIN, SCL_PIN, &cfg)){
+        fprintf(stderr, "oxi_init falhou (config invalida?)\n");
+        return 2;
+    }
+    if(o.ci >= 0.0f) oxi_set_early_ci(o.ci);
+    oxi_set_engine(o.engine);
+
+    oxi_config_t c;
+    oxi_get_config(&c);
+    printf("# %u Hz (%u/%u, %u us), motor %s, saida antecipada %s, laco %lu ms\n",
+           c.sample_rate_hz / c.avg, c.sample_rate_hz, c.avg, c.pulse_width_us,
+           o.engine == OXI_ENGINE_GOERTZEL ? "Goertzel" : "ACF",
+           o.ci == 0.0f ? "desligada" : "ligada", (unsigned long)o.poll_ms);
+    printf("%-28s %6s %6s %6s %7s %7s %5s %8s %8s %8s %5s %5s\n",
+           "trace", "ref", "bpm", "erro", "done_ms", "run_ms", "est/s",
+           "cpu_us", "cpu_max", "i2c_us", "spo2", "nn");
+    int fails = 0, n = 0;
+    double abs_err = 0, done_ms = 0;
+    for(int i = first; i < argc; i++){
+        sim_trace_t tr;
+        replay_res_t r;
+        const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+        if(!sim_trace_load(&tr, argv[i])){ fprintf(stderr, "%s: trace invalido\n", argv[i]); fails++; continue; }
+        bool ok = replay_one(&tr, &o, &r);
+        sim_trace_free(&tr);
+        if(!ok){ fprintf(stderr, "%s: oxi_start falhou\n", name); fails++; continue; }
+
+        printf("%-28s %6.1f %6.1f %+6.2f %7lu %7lu %5.2f %8.2f %8.2f %8.1f %5.1f %5u%s\n",
+               name, r.ref, r.bpm, r.err, (unsigned long)r.done_ms, (unsigned long)r.run_ms,
+               r.est_per_s, r.cpu_us_mean, r.cpu_us_max, r.bus_us_mean,
+               r.spo2, r.beats, r.done ? "" : "  (sem DONE)");
+        if(r.done){ n++; abs_err += fabsf(r.err); done_ms += r.done_ms; }
+        if(o.tol >= 0.0f && (!r.done || isnan(r.err) || fabsf(r.err) > o.tol)) fails++;
+    }
+    if(n > 1) printf("media: |erro| %.2f bpm, DONE em %.0f ms (%d traces)\n", abs_err / n, done_ms / n, n);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,298 @@
+// MAX30102 simulado no I2C (endereço 0x57). Registradores de verdade
+// (ponteiros/overflow da FIFO, modo, config de SpO2, LEDs, part ID, status
+// de interrupção) e a FIFO de 32 amostras com rollover, cheia no ritmo da
+// config escrita (taxa/média). Cada amostra é o trace no instante dela
+// (interpolação linear), escalado pela corrente de LED e faixa do ADC atuais
+// relativas às da gravação. O INT desce com A_FULL/PWR_RDY e só volta com a
+// leitura do INT_STATUS_1; a rajada DMA do RP2040 roda aqui comando a comando.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "hardware/i2c.h"
+
+#define MAX_ADDR        0x57
+#define MAX_PART_ID     0x15
+#define FIFO_N          32
+#define ADC_FULL        0x3FFFF
+#define NO_FINGER       300          // contagens com o dedo fora
+#define I2C_BYTE_US     90           // 9 bits a 100 kHz
+
+// ====== Barramento ======
+struct i2c_inst { i2c_hw_t hw; };
+static struct i2c_inst s_i2c[2];
+i2c_inst_t *i2c0 = &s_i2c[0], *i2c1 = &s_i2c[1];
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate){ (void)i2c; return baudrate; }
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c){ return &i2c->hw; }
+uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx){ return (uint)((i2c == i2c1) * 2 + !is_tx); }
+
+// ====== Estado do sensor ======
+static uint8_t  s_reg[256];
+static uint8_t  s_ptr;
+static uint8_t  s_int1 = 0x01;               // INT_STATUS_1: PWR_RDY no power-on
+static int      s_int_pin = -1;
+static int      s_fb;                        // byte dentro da amostra lida da FIFO (0..5)
+static bool     s_xfer, s_dma_busy;          // transação bloqueante / rajada DMA em curso
+static uint32_t s_conflicts;
+static int32_t  s_fifo_ir[FIFO_N], s_fifo_rd[FIFO_N];
+static int      s_wr, s_rd, s_cnt, s_ovf;
+static int32_t  s_last_ir, s_last_rd;
+static uint64_t s_t0_us, s_next_us;          // reset da FIFO / próxima amostra
+static const sim_trace_t *s_tr;
+static uint32_t s_cur;                       // cursor no trace (monotônico)
+
+static const uint16_t SR_HZ[8] = {50,100,200,400,800,1000,1600,3200};
+
+static uint32_t period_us(void){
+    uint32_t sr  = SR_HZ[(s_reg[0x0A] >> 2) & 7];
+    uint32_t avg = 1u << ((s_reg[0x08] >> 5) & 7);
+    if(avg > 32) avg = 32;
+    return 1000000u * avg / sr;
+}
+
+// trace interpolado em t_ms (relativo ao reset), já na config atual dos LEDs
+static void trace_at(uint32_t t_us, int32_t *ir, int32_t *red){
+    if(!s_tr || !s_tr->n || t_us > s_tr->t_ms[s_tr->n-1] * 1000u){ *ir = NO_FINGER; *red = NO_FINGER; return; }
+    while(s_cur + 1 < s_tr->n && s_tr->t_ms[s_cur+1] * 1000u <= t_us) s_cur++;
+    double vi = s_tr->ir[s_cur], vr = s_tr->red[s_cur];
+    if(s_cur + 1 < s_tr->n){
+        double a = s_tr->t_ms[s_cur] * 1000.0, b = s_tr->t_ms[s_cur+1] * 1000.0;
+        double f = (t_us - a) / (b - a);
+        vi += f * (s_tr->ir[s_cur+1] - vi);
+        vr += f * (s_tr->red[s_cur+1] - vr);
+    }
+    // faixa do ADC: cada passo abaixo dobra as contagens
+    double rg = ldexp(1.0, (int)s_tr->range - ((s_reg[0x0A] >> 5) & 3));
+    vi *= rg * s_reg[0x0D] / (s_tr->led_ir  ? s_tr->led_ir  : 1);
+    vr *= rg * s_reg[0x0C] / (s_tr->led_red ? s_tr->led_red : 1);
+    *ir  = vi > ADC_FULL ? ADC_FULL : (vi < 0 ? 0 : (int32_t)vi);
+    *red = vr > ADC_FULL ? ADC_FULL : (vr < 0 ? 0 : (int32_t)vr);
+}
+
+// INT ativo em baixo enquanto houver status pendente (só os habilitados entram)
+static void int_update(void){
+    if(s_int_pin >= 0) sim_gpio_drive((unsigned)s_int_pin, s_int1 == 0);
+}
+
+// enche a FIFO até o instante atual (rollover: a mais velha sai, conta overflow)
+static void fifo_fill(void){
+    if((s_reg[0x09] & 0x07) != 0x03) return;           // só no modo SpO2
+    uint64_t now = sim_now_us();
+    uint8_t int0 = s_int1;
+    while(s_next_us <= now){
+        int32_t ir, red;
+        trace_at((uint32_t)(s_next_us - s_t0_us), &ir, &red);
+        if(s_cnt == FIFO_N){
+            s_rd = (s_rd + 1) % FIFO_N; s_cnt--;
+            if(s_ovf < 31) s_ovf++;
+        }
+        s_fifo_ir[s_wr] = ir; s_fifo_rd[s_wr] = red;
+        s_wr = (s_wr + 1) % FIFO_N; s_cnt++;
+        s_next_us += period_us();
+        // A_FULL: FIFO com só FIFO_A_FULL espaços livres (a cada amostra nova)
+        if((s_reg[0x02] & 0x80) && s_cnt >= FIFO_N - (s_reg[0x08] & 0x0F)) s_int1 |= 0x80;
+    }
+    if(s_int1 != int0) int_update();
+}
+
+static void fifo_reset(void){
+    s_wr = s_rd = s_cnt = s_ovf = 0;
+    s_t0_us = s_next_us = sim_now_us();
+    s_cur = 0;
+}
+
+static void reg_write(uint8_t r, uint8_t v){
+    switch(r){
+    case 0x04: s_wr = v & (FIFO_N-1); s_cnt = (s_wr - s_rd + FIFO_N) % FIFO_N; break;
+    case 0x05: s_ovf = v & 0x1F; break;
+    case 0x06: s_rd = v & (FIFO_N-1); s_cnt = (s_wr - s_rd + FIFO_N) % FIFO_N; break;
+    case 0x09:
+        if(v & 0x40){ memset(s_reg, 0, sizeof s_reg); fifo_reset(); s_int1 = 0x01; int_update(); return; }
+        if((s_reg[0x09] & 0x07) != 0x03 && (v & 0x07) == 0x03) fifo_reset();
+        s_reg[0x09] = v;
+        break;
+    default: s_reg[r] = v; break;
+    }
+}
+
+static uint8_t reg_read(void){
+    switch(s_ptr){
+    case 0x00: { uint8_t v = s_int1; s_int1 = 0; int_update(); return v; }
+    case 0x01: return 0;                              // INT_STATUS_2 (DIE_TEMP) não emulado
+    case 0x04: return (uint8_t)s_wr;
+    case 0x05: { uint8_t o = (uint8_t)s_ovf; s_ovf = 0; return o; }
+    case 0x06: return (uint8_t)s_rd;
+    case 0xFF: return MAX_PART_ID;
+    default:   return s_reg[s_ptr];
+    }
+}
+
+void sim_max_attach(const sim_trace_t *t){ s_tr = t; s_cur = 0; }
+void sim_max_int_pin(int gpio){
+    if(s_int_pin >= 0 && s_int_pin != gpio) sim_gpio_drive((unsigned)s_int_pin, true);   // pull-up
+    s_int_pin = gpio;
+    int_update();
+}
+void sim_max_tick(void){ fifo_fill(); }
+uint32_t sim_i2c_conflicts(void){ return s_conflicts; }
+
+// um byte lido no ponteiro atual. FIFO_DATA não incrementa o ponteiro:
+// cada 6 bytes tiram uma amostra (RED, IR); FIFO vazia repete a última
+static uint8_t rd_byte(void){
+    if(s_ptr != 0x07){ uint8_t v = reg_read(); s_ptr++; return v; }
+    if(s_fb == 0 && s_cnt > 0){
+        s_last_rd = s_fifo_rd[s_rd]; s_last_ir = s_fifo_ir[s_rd];
+        s_rd = (s_rd + 1) % FIFO_N; s_cnt--;
+    }
+    int32_t v = s_fb < 3 ? s_last_rd : s_last_ir;
+    uint8_t b = (uint8_t)(v >> (8 * (2 - s_fb % 3)));
+    s_fb = (s_fb + 1) % 6;
+    return b;
+}
+
+// ====== Transações ======
+// nostop segura o barramento até a leitura (rn(): escreve o ponteiro e lê)
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us){
+    (void)i2c; (void)timeout_us;
+    if(s_dma_busy) s_conflicts++;
+    s_xfer = true;
+    sim_advance_us((uint64_t)(len + 1) * I2C_BYTE_US);
+    fifo_fill();
+    s_xfer = nostop;
+    if(addr != MAX_ADDR || len == 0){ s_xfer = false; return -1; }   // PICO_ERROR_GENERIC (NACK)
+    s_ptr = src[0];
+    for(size_t i = 1; i < len; i++) reg_write(s_ptr++, src[i]);
+    return (int)len;
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us){
+    (void)i2c; (void)timeout_us;
+    if(s_dma_busy) s_conflicts++;
+    s_xfer = true;
+    sim_advance_us((uint64_t)(len + 1) * I2C_BYTE_US);
+    fifo_fill();
+    s_xfer = nostop;
+    if(addr != MAX_ADDR){ s_xfer = false; return -1; }
+    s_fb = 0;
+    for(size_t k = 0; k < len; k++) dst[k] = rd_byte();
+    return (int)len;
+}
+
+// ====== Rajada DMA (IC_DATA_CMD) ======
+// Cada comando: byte a escrever ou leitura (CMD), RESTART/STOP. O 1º byte
+// escrito depois de START/RESTART é o ponteiro de registrador.
+uint32_t sim_i2c_dma_begin(volatile void *data_cmd, unsigned ncmd){
+    (void)data_cmd;
+    if(s_xfer || s_dma_busy) s_conflicts++;
+    s_dma_busy = true;
+    return (ncmd + 2) * I2C_BYTE_US;
+}
+
+bool sim_i2c_dma_end(volatile void *data_cmd, const uint32_t *cmd, unsigned ncmd, uint8_t *rx, unsigned nrx){
+    i2c_inst_t *bus = (data_cmd == (volatile void *)&s_i2c[1].hw.data_cmd) ? &s_i2c[1] : &s_i2c[0];
+    if(bus->hw.tar != MAX_ADDR || !bus->hw.enable) return false;      // NACK
+    fifo_fill();
+    bool start = true, prev_rd = false;
+    unsigned k = 0;
+    for(unsigned i = 0; i < ncmd; i++){
+        uint32_t c = cmd[i];
+        bool rd = (c & I2C_IC_DATA_CMD_CMD_BITS) != 0;
+        if((c & I2C_IC_DATA_CMD_RESTART_BITS) || (i && rd != prev_rd)) start = true;
+        if(!rd){
+            if(start) s_ptr = (uint8_t)c;
+            else reg_write(s_ptr++, (uint8_t)c);
+        }else{
+            if(start) s_fb = 0;
+            if(k < nrx) rx[k++] = rd_byte();
+        }
+        start = (c & I2C_IC_DATA_CMD_STOP_BITS) != 0;
+        prev_rd = rd;
+    }
+    s_dma_busy = false;
+    return k == nrx;
+}
+
+void sim_i2c_dma_abort(void){ s_dma_busy = false; }
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop){
+    return i2c_write_timeout_us(i2c, addr, src, len, nostop, 0);
+}
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop){
+    return i2c_read_timeout_us(i2c, addr, dst, len, nostop, 0);
+}
+
+// ====== Traces ======
+static bool trace_push(sim_trace_t *t, uint32_t *cap, uint32_t t_ms, int32_t ir, int32_t red){
+    if(t->n == *cap){
+        uint32_t c = *cap ? *cap * 2 : 1024;
+        uint32_t *nt = realloc(t->t_ms, c * sizeof *nt);
+        int32_t *ni = realloc(t->ir, c * sizeof *ni);
+        int32_t *nr = realloc(t->red, c * sizeof *nr);
+        if(nt) t->t_ms = nt;
+        if(ni) t->ir = ni;
+        if(nr) t->red = nr;
+        if(!nt || !ni || !nr) return false;
+        *cap = c;
+    }
+    t->t_ms[t->n] = t_ms; t->ir[t->n] = ir; t->red[t->n] = red;
+    t->n++;
+    return true;
+}
+
+static void trace_meta(sim_trace_t *t, const char *line){
+    const char *p = line;
+    while((p = strchr(p, '=')) != NULL){
+        const char *k = p;
+        while(k > line && k[-1] != ' ' && k[-1] != '#' && k[-1] != '\t') k--;
+        double v = atof(p + 1);
+        size_t kl = (size_t)(p - k);
+        if(kl == 3 && !strncmp(k, "bpm", 3))     t->bpm = (float)v;
+        if(kl == 6 && !strncmp(k, "led_ir", 6))  t->led_ir = (uint8_t)v;
+        if(kl == 7 && !strncmp(k, "led_red", 7)) t->led_red = (uint8_t)v;
+        if(kl == 5 && !strncmp(k, "range", 5))   t->range = (uint8_t)v;
+        p++;
+    }
+}
+
+static uint32_t rd_le32(const uint8_t *b){
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+bool sim_trace_load(sim_trace_t *t, const char *path){
+    memset(t, 0, sizeof *t);
+    t->bpm = NAN; t->led_ir = 0x5F; t->led_red = 0x5F; t->range = 3;   // config inicial do firmware
+    FILE *f = fopen(path, "rb");
+    if(!f) return false;
+    uint32_t cap = 0, t0 = 0;
+    bool ok = true;
+    size_t pl = strlen(path);
+    if(pl > 4 && !strcmp(path + pl - 4, ".bin")){
+        uint8_t fr[16];
+        while(ok && fread(fr, 1, sizeof fr, f) == sizeof fr){
+            uint32_t tm = rd_le32(fr + 4);
+            if(!t->n) t0 = tm;
+            ok = trace_push(t, &cap, tm - t0, (int32_t)rd_le32(fr + 8), (int32_t)rd_le32(fr + 12));
+        }
+    }else{
+        char line[256];
+        while(ok && fgets(line, sizeof line, f)){
+            if(line[0] == '#'){ trace_meta(t, line); continue; }
+            unsigned long tm; long ir, red;
+            if(sscanf(line, "%lu,%ld,%ld", &tm, &ir, &red) != 3) continue;   // cabeçalho de colunas
+            if(!t->n) t0 = (uint32_t)tm;
+            ok = trace_push(t, &cap, (uint32_t)tm - t0, (int32_t)ir, (int32_t)red);
+        }
+    }
+    fclose(f);
+    if(!ok || t->n < 2){ sim_trace_free(t); return false; }
+    return true;
+}
+
+void sim_trace_free(sim_trace_t *t){
+    free(t->t_ms); free(t->ir); free(t->red);
+    t->t_ms = NULL; t->ir = t->red = NULL; t->n = 0;
+}
+
+uint32_t sim_trace_ms(const sim_trace_t *t){ return t->n ? t->t_ms[t->n-1] : 0; }
@@ -0,0 +1,191 @@
+// lwIP raw TCP, CYW43 e DHCP/DNS no host p/ rodar o web_ap.c. Sem rede: o
+// teste faz o papel do cliente (sim_tcp_*). Tudo que o servidor escreve
+// fica na conexão até o teste pegar; a janela (tcp_sndbuf) só volta quando
+// o teste confirma (sim_tcp_ack), como o ACK do navegador.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "lwip/tcp.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/sync.h"
+#include "dhcpserver.h"
+#include "dnsserver.h"
+#include "oxi_core1.h"
+
+struct tcp_pcb {
+    void          *arg;
+    tcp_recv_fn    recv;
+    tcp_sent_fn    sent;
+    tcp_poll_fn    poll;
+    tcp_err_fn     err;
+    tcp_accept_fn  accept;
+    char          *out;          // escrito pelo servidor, ainda não lido pelo teste
+    size_t         out_len, out_cap;
+    u16_t          sndbuf;       // janela livre
+    u16_t          unacked;
+    sim_tcp_state_t state;
+};
+
+ip_addr_t ip_addr_any_type;
+
+static struct tcp_pcb *s_listen;
+static int      s_lock;          // aninhamento do cyw43_arch_lwip_begin/end
+static uint32_t s_misuse;
+
+static void misuse(const char *what){
+    fprintf(stderr, "net_sim: %s\n", what);
+    s_misuse++;
+}
+
+// ====== lwIP: TCP ======
+struct tcp_pcb *tcp_new_ip_type(u8_t type){ (void)type; return calloc(1, sizeof(struct tcp_pcb)); }
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port){ (void)pcb; (void)ipaddr; (void)port; return ERR_OK; }
+struct tcp_pcb *tcp_listen(struct tcp_pcb *pcb){ s_listen = pcb; return pcb; }
+void tcp_arg(struct tcp_pcb *pcb, void *arg){ pcb->arg = arg; }
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept){ pcb->accept = accept; }
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv){ pcb->recv = recv; }
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent){ pcb->sent = sent; }
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval){ (void)interval; pcb->poll = poll; }
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err){ pcb->err = err; }
+void tcp_nagle_disable(struct tcp_pcb *pcb){ (void)pcb; }
+void tcp_setprio(struct tcp_pcb *pcb, u8_t prio){ (void)pcb; (void)prio; }
+err_t tcp_output(struct tcp_pcb *pcb){ (void)pcb; return ERR_OK; }
+void tcp_recved(struct tcp_pcb *pcb, u16_t len){ (void)pcb; (void)len; }
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb){ return pcb->sndbuf; }
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags){
+    (void)apiflags;
+    if (pcb->state != SIM_TCP_OPEN) { misuse("tcp_write depois de close/abort"); return ERR_CLSD; }
+    if (len > pcb->sndbuf) return ERR_MEM;
+    if (pcb->out_len + len > pcb->out_cap) {
+        pcb->out_cap = (pcb->out_len + len) * 2;
+        pcb->out = realloc(pcb->out, pcb->out_cap);
+    }
+    memcpy(pcb->out + pcb->out_len, dataptr, len);
+    pcb->out_len += len;
+    pcb->sndbuf  -= len;
+    pcb->unacked += len;
+    return ERR_OK;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb){
+    if (pcb->state != SIM_TCP_OPEN) misuse("tcp_close repetido");
+    pcb->state = SIM_TCP_CLOSED;
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb){
+    if (pcb->state != SIM_TCP_OPEN) misuse("tcp_abort depois de close/abort");
+    pcb->state = SIM_TCP_ABORTED;
+}
+
+// ====== lwIP: pbuf ======
+// pbuf_cat junta num bloco só: o web_ap.c só lê por pbuf_copy_partial.
+static struct pbuf *pbuf_new(const void *d, size_t n){
+    struct pbuf *p = calloc(1, sizeof *p);
+    p->payload = malloc(n ? n : 1);
+    memcpy(p->payload, d, n);
+    p->tot_len = p->len = (u16_t)n;
+    return p;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset){
+    if (offset >= p->tot_len) return 0;
+    if (len > p->tot_len - offset) len = p->tot_len - offset;
+    memcpy(dataptr, (const char *)p->payload + offset, len);
+    return len;
+}
+
+u8_t pbuf_free(struct pbuf *p){
+    free(p->payload);
+    free(p);
+    return 1;
+}
+
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size){
+    if (size >= q->tot_len) { pbuf_free(q); return NULL; }
+    memmove(q->payload, (char *)q->payload + size, q->tot_len - size);
+    q->tot_len -= size;
+    q->len = q->tot_len;
+    return q;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail){
+    head->payload = realloc(head->payload, head->tot_len + tail->tot_len);
+    memcpy((char *)head->payload + head->tot_len, tail->payload, tail->tot_len);
+    head->tot_len += tail->tot_len;
+    head->len = head->tot_len;
+    pbuf_free(tail);
+}
+
+// ====== CYW43 / DHCP / DNS ======
+int  cyw43_arch_init(void){ return 0; }
+void cyw43_arch_enable_ap_mode(const char *ssid, const char *password, uint32_t auth){ (void)ssid; (void)password; (void)auth; }
+void cyw43_arch_gpio_put(uint wl_gpio, bool value){ (void)wl_gpio; (void)value; }
+void cyw43_arch_lwip_begin(void){ s_lock++; }
+void cyw43_arch_lwip_end(void){ if (--s_lock < 0) misuse("cyw43_arch_lwip_end sem begin"); }
+void dhcp_server_init(dhcp_server_t *d, ip_addr_t *ip, ip_addr_t *nm){ (void)d; (void)ip; (void)nm; }
+void dns_server_init(dns_server_t *d, ip_addr_t *ip){ (void)d; (void)ip; }
+
+// ====== hardware/sync ======
+uint32_t save_and_disable_interrupts(void){ return 0; }
+void restore_interrupts(uint32_t status){ (void)status; }
+
+// ====== oxi_core1: stream do /ppg.bin sem amostras ======
+uint32_t oxi_core1_ppg_open(void){ return 0; }
+void oxi_core1_ppg_close(void){}
+size_t oxi_core1_ppg_peek(uint32_t seq, const oxi_ppg_frame_t **out){ (void)seq; *out = NULL; return 0; }
+void oxi_core1_ppg_release(uint32_t seq){ (void)seq; }
+
+// ====== Lado do cliente (teste) ======
+struct tcp_pcb *sim_tcp_connect(void){
+    if (!s_listen || !s_listen->accept) return NULL;
+    struct tcp_pcb *p = calloc(1, sizeof *p);
+    p->sndbuf = TCP_SND_BUF;
+    if (s_listen->accept(s_listen->arg, p, ERR_OK) != ERR_OK && p->state == SIM_TCP_OPEN) p->state = SIM_TCP_ABORTED;
+    return p;
+}
+
+int sim_tcp_send(struct tcp_pcb *p, const void *d, size_t n){
+    if (p->state != SIM_TCP_OPEN || !p->recv) return ERR_CLSD;
+    return p->recv(p->arg, p, pbuf_new(d, n), ERR_OK);
+}
+
+int sim_tcp_fin(struct tcp_pcb *p){
+    if (p->state != SIM_TCP_OPEN || !p->recv) return ERR_CLSD;
+    return p->recv(p->arg, p, NULL, ERR_OK);
+}
+
+int sim_tcp_ack(struct tcp_pcb *p){
+    u16_t n = p->unacked;
+    p->unacked = 0;
+    p->sndbuf += n;
+    if (n && p->state == SIM_TCP_OPEN && p->sent) return p->sent(p->arg, p, n);
+    return ERR_OK;
+}
+
+int sim_tcp_poll(struct tcp_pcb *p){
+    if (p->state != SIM_TCP_OPEN || !p->poll) return ERR_OK;
+    return p->poll(p->arg, p);
+}
+
+size_t sim_tcp_take(struct tcp_pcb *p, char *out, size_t cap){
+    size_t n = p->out_len < cap ? p->out_len : cap;
+    memcpy(out, p->out, n);
+    memmove(p->out, p->out + n, p->out_len - n);
+    p->out_len -= n;
+    return n;
+}
+
+size_t sim_tcp_pending(const struct tcp_pcb *p){ return p->out_len; }
+void sim_tcp_set_wnd(struct tcp_pcb *p, uint16_t wnd){ p->sndbuf = wnd; }
+sim_tcp_state_t sim_tcp_state(const struct tcp_pcb *p){ return p->state; }
+
+void sim_tcp_free(struct tcp_pcb *p){
+    if (p->state == SIM_TCP_OPEN) misuse("sim_tcp_free com a conexão aberta");
+    free(p->out);
+    free(p);
+}
+
+uint32_t sim_net_misuse(void){ return s_misuse + (s_lock != 0); }
@@ -0,0 +1,134 @@
+// Relógio, GPIO, DMA e IRQ do Pico SDK no host. Interrupção = chamada
+// direta: a borda de descida num GPIO com IRQ ligada chama o callback na
+// hora e a rajada DMA I2C (par TX/RX que o oximetro.c monta) roda no sensor
+// simulado quando o tempo passa do fim dela, chamando o handler do DMA_IRQ_1.
+#include "sim.h"
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+static uint64_t s_us = 0;
+static bool s_in_irq = false;
+static void irq_service(void);
+
+uint64_t sim_now_us(void){ return s_us; }
+void sim_advance_us(uint64_t us){ s_us += us; irq_service(); }
+
+// ====== pico/stdlib ======
+void sleep_ms(uint32_t ms){ sim_advance_us((uint64_t)ms * 1000); }
+void sleep_us(uint64_t us){ sim_advance_us(us); }
+absolute_time_t get_absolute_time(void){ return s_us; }
+uint32_t time_us_32(void){ return (uint32_t)s_us; }
+uint64_t time_us_64(void){ return s_us; }
+
+// ====== GPIO ======
+#define GPIO_N 30
+static bool s_gpio_low[GPIO_N];              // solto = alto (pull-up)
+static uint32_t s_gpio_irq[GPIO_N];          // eventos com IRQ ligada
+static gpio_irq_callback_t s_gpio_cb;
+
+void gpio_init(uint gpio){ (void)gpio; }
+void gpio_set_function(uint gpio, enum gpio_function fn){ (void)gpio; (void)fn; }
+void gpio_set_dir(uint gpio, bool out){ (void)gpio; (void)out; }
+void gpio_pull_up(uint gpio){ (void)gpio; }
+bool gpio_get(uint gpio){ return gpio < GPIO_N ? !s_gpio_low[gpio] : true; }
+// como no SDK: borda que veio com a IRQ desligada não fica pendente
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled){
+    if(gpio >= GPIO_N) return;
+    if(enabled) s_gpio_irq[gpio] |= events;
+    else s_gpio_irq[gpio] &= ~events;
+}
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback){
+    s_gpio_cb = callback;
+    gpio_set_irq_enabled(gpio, events, enabled);
+}
+
+void sim_gpio_drive(unsigned gpio, bool level){
+    if(gpio >= GPIO_N) return;
+    bool fell = !s_gpio_low[gpio] && !level;
+    s_gpio_low[gpio] = !level;
+    if(fell && (s_gpio_irq[gpio] & GPIO_IRQ_EDGE_FALL) && s_gpio_cb) s_gpio_cb(gpio, GPIO_IRQ_EDGE_FALL);
+}
+
+// ====== DMA ======
+// config: tamanho (bits 0-1), incrementos (2-3), DREQ (8-15; I2C: par = TX)
+#define DMA_N 12
+typedef struct {
+    volatile void *wr;
+    const volatile void *rd;
+    uint n;
+    uint32_t ctrl;
+} sim_dma_t;
+static sim_dma_t s_dma[DMA_N];
+static int s_dma_next = 0;
+static uint32_t s_dma_irq1_en, s_dma_ints1;
+static int s_burst_tx = -1, s_burst_rx = -1;  // rajada I2C em curso
+static uint64_t s_burst_end;
+
+int dma_claim_unused_channel(bool required){ (void)required; return s_dma_next < DMA_N ? s_dma_next++ : -1; }
+void dma_channel_unclaim(uint channel){ (void)channel; }
+dma_channel_config dma_channel_get_default_config(uint channel){ (void)channel; dma_channel_config c = {0}; return c; }
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size){
+    c->ctrl = (c->ctrl & ~3u) | (uint32_t)size;
+}
+void channel_config_set_read_increment(dma_channel_config *c, bool incr){ c->ctrl = (c->ctrl & ~4u) | (incr ? 4u : 0); }
+void channel_config_set_write_increment(dma_channel_config *c, bool incr){ c->ctrl = (c->ctrl & ~8u) | (incr ? 8u : 0); }
+void channel_config_set_dreq(dma_channel_config *c, uint dreq){ c->ctrl = (c->ctrl & ~0xFF00u) | ((dreq & 0xFF) << 8); }
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger){
+    if(channel >= DMA_N) return;
+    s_dma[channel] = (sim_dma_t){ write_addr, read_addr, transfer_count, config->ctrl };
+    if(trigger) dma_start_channel_mask(1u << channel);
+}
+// só o par TX (comandos, DREQ par) + RX (bytes, DREQ ímpar) do I2C é emulado
+void dma_start_channel_mask(uint32_t chan_mask){
+    int tx = -1, rx = -1;
+    for(int ch = 0; ch < DMA_N; ch++){
+        if(!(chan_mask & (1u << ch))) continue;
+        if((s_dma[ch].ctrl >> 8) & 1) rx = ch; else tx = ch;
+    }
+    if(tx < 0 || rx < 0) return;
+    s_burst_tx = tx; s_burst_rx = rx;
+    s_burst_end = s_us + sim_i2c_dma_begin(s_dma[tx].wr, s_dma[tx].n);
+}
+void dma_channel_abort(uint channel){
+    if((int)channel != s_burst_tx && (int)channel != s_burst_rx) return;
+    s_burst_tx = s_burst_rx = -1;
+    sim_i2c_dma_abort();
+}
+void dma_channel_set_irq1_enabled(uint channel, bool enabled){
+    if(enabled) s_dma_irq1_en |= 1u << channel;
+    else s_dma_irq1_en &= ~(1u << channel);
+}
+bool dma_channel_get_irq1_status(uint channel){ return (s_dma_ints1 >> channel) & 1; }
+void dma_channel_acknowledge_irq1(uint channel){ s_dma_ints1 &= ~(1u << channel); }
+
+// ====== IRQ ======
+static irq_handler_t s_dma_irq1;
+static bool s_dma_irq1_on;
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority){
+    (void)order_priority;
+    if(num == DMA_IRQ_1) s_dma_irq1 = handler;
+}
+void irq_set_enabled(uint num, bool enabled){ if(num == DMA_IRQ_1) s_dma_irq1_on = enabled; }
+
+// o sensor anda até agora (pode descer o INT) e a rajada que acabou completa
+static void irq_service(void){
+    if(s_in_irq) return;
+    s_in_irq = true;
+    sim_max_tick();
+    if(s_burst_rx >= 0 && s_us >= s_burst_end){
+        const sim_dma_t *tx = &s_dma[s_burst_tx], *rx = &s_dma[s_burst_rx];
+        int ch = s_burst_rx;
+        if(sim_i2c_dma_end(tx->wr, (const uint32_t *)tx->rd, tx->n, (uint8_t *)rx->wr, rx->n)){
+            s_burst_tx = s_burst_rx = -1;
+            if(s_dma_irq1_en & (1u << ch)){
+                s_dma_ints1 |= 1u << ch;
+                if(s_dma_irq1_on && s_dma_irq1) s_dma_irq1();
+            }
+        }else s_burst_end = UINT64_MAX;     // NACK: canais presos até o abort
+    }
+    s_in_irq = false;
+}
@@ -0,0 +1,78 @@
+// Hardware simulado p/ rodar o firmware no host: relógio do SDK + MAX30102
+// no I2C com a FIFO alimentada por um trace PPG; lwIP TCP p/ o web_ap.c.
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ====== Relógio e interrupções (pico_sim.c) ======
+// Tempo simulado em us: só anda com sleep_*, com o I2C (~90 us/byte a
+// 100 kHz) e com sim_advance_us() do laço de teste. A cada avanço o sensor
+// anda até o instante novo e a rajada DMA que já acabou chama o handler do
+// DMA_IRQ_1; borda de descida num GPIO com IRQ ligada chama o callback na
+// hora (no meio do que estiver rodando, como no RP2040).
+uint64_t sim_now_us(void);
+void sim_advance_us(uint64_t us);
+void sim_gpio_drive(unsigned gpio, bool level);
+
+// ====== MAX30102 (max3010x_sim.c) ======
+// Trace: CSV "t_ms,ir,red" (mesmas colunas do /ppg.bin; linhas '#' com
+// chave=valor: fs, bpm, led_ir, led_red, range) ou o próprio /ppg.bin
+// (frames de 16 B LE: seq, t_ms, ir, red). As contagens valem p/ a
+// corrente/faixa da gravação (padrão: 0x5F/0x5F, faixa 3); o simulado
+// escala pela config que o AGC escrever.
+typedef struct {
+    uint32_t n;
+    uint32_t *t_ms;           // relativo à 1ª amostra
+    int32_t  *ir, *red;
+    float    bpm;             // '# bpm=' (NAN se o trace não disser)
+    uint8_t  led_ir, led_red, range;
+} sim_trace_t;
+
+bool sim_trace_load(sim_trace_t *t, const char *path);
+void sim_trace_free(sim_trace_t *t);
+uint32_t sim_trace_ms(const sim_trace_t *t);
+
+// Liga o trace ao sensor. Ele recomeça do início a cada reset da FIFO
+// (oxi_init/oxi_start); depois do fim o sensor lê "sem dedo".
+void sim_max_attach(const sim_trace_t *t);
+
+// INT (open-drain, ativo em baixo) ligado a um GPIO; -1 = solto (nunca desce).
+// Desce com PWR_RDY (reset) e A_FULL; só volta lendo o INT_STATUS_1 (0x00).
+void sim_max_int_pin(int gpio);
+// Transação bloqueante com uma rajada DMA no mesmo I2C (ou rajada começada
+// no meio de uma transação): firmware disputando o barramento. Tem que ser 0.
+uint32_t sim_i2c_conflicts(void);
+
+// Interno (pico_sim.c -> max3010x_sim.c): o DMA do RP2040 escreve comandos
+// no IC_DATA_CMD (TX) e lê os bytes (RX); a rajada roda no sensor no fim
+// dela (begin devolve a duração em us). end = false: NACK, fica presa até o abort.
+void     sim_max_tick(void);
+uint32_t sim_i2c_dma_begin(volatile void *data_cmd, unsigned ncmd);
+bool     sim_i2c_dma_end(volatile void *data_cmd, const uint32_t *cmd, unsigned ncmd, uint8_t *rx, unsigned nrx);
+void     sim_i2c_dma_abort(void);
+
+// ====== Rede (net_sim.c) ======
+// O teste é o cliente: conecta no listen do web_ap_start(), manda segmentos
+// (cada sim_tcp_send vira um pbuf no recv) e lê o que o servidor escreveu.
+// A janela só volta com sim_tcp_ack(), que chama o sent do servidor.
+// Retornos int = err_t do callback do servidor.
+typedef enum { SIM_TCP_OPEN = 0, SIM_TCP_CLOSED, SIM_TCP_ABORTED } sim_tcp_state_t;
+struct tcp_pcb;
+
+struct tcp_pcb *sim_tcp_connect(void);
+int    sim_tcp_send(struct tcp_pcb *p, const void *d, size_t n);
+int    sim_tcp_fin(struct tcp_pcb *p);
+int    sim_tcp_ack(struct tcp_pcb *p);        // confirma tudo que estava em voo
+int    sim_tcp_poll(struct tcp_pcb *p);       // uma chamada do poll do servidor
+size_t sim_tcp_take(struct tcp_pcb *p, char *out, size_t cap);
+size_t sim_tcp_pending(const struct tcp_pcb *p);
+void   sim_tcp_set_wnd(struct tcp_pcb *p, uint16_t wnd);
+sim_tcp_state_t sim_tcp_state(const struct tcp_pcb *p);
+void   sim_tcp_free(struct tcp_pcb *p);       // só depois de fechada (o lwIP libera o pcb)
+// escrita/close depois de fechar, lock do lwIP desbalanceado: tem que ser 0
+uint32_t sim_net_misuse(void);
+
+#endif
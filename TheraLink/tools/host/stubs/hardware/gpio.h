@@ -0,0 +1,26 @@
+// Stub do Pico SDK (host): GPIO sem efeito; IRQ de pino nunca dispara
+#ifndef _HARDWARE_GPIO_H
+#define _HARDWARE_GPIO_H
+
+#include "pico/stdlib.h"
+
+enum gpio_function { GPIO_FUNC_I2C = 3 };
+#define GPIO_IN  false
+#define GPIO_OUT true
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW  = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL  = 0x4u,
+    GPIO_IRQ_EDGE_RISE  = 0x8u,
+};
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_pull_up(uint gpio);
+bool gpio_get(uint gpio);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+
+#endif
@@ -0,0 +1,30 @@
+// Stub do Pico SDK (host): transações vão p/ os dispositivos simulados
+// (sim/max3010x_sim.c); os registradores do bloco só existem p/ compilar.
+#ifndef _HARDWARE_I2C_H
+#define _HARDWARE_I2C_H
+
+#include "pico/stdlib.h"
+
+typedef struct i2c_inst i2c_inst_t;
+extern i2c_inst_t *i2c0, *i2c1;
+
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t clr_tx_abrt;
+} i2c_hw_t;
+
+#define I2C_IC_DATA_CMD_RESTART_BITS 0x00000400u
+#define I2C_IC_DATA_CMD_STOP_BITS    0x00000200u
+#define I2C_IC_DATA_CMD_CMD_BITS     0x00000100u
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us);
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c);
+uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx);
+
+#endif
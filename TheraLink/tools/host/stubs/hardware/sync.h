@@ -0,0 +1,13 @@
+// Stub do Pico SDK (host): um núcleo só, sem interrupção; barreiras vazias
+#ifndef _HARDWARE_SYNC_H
+#define _HARDWARE_SYNC_H
+
+#include <stdint.h>
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+static inline void __dmb(void){}
+static inline void __mem_fence_acquire(void){}
+static inline void __mem_fence_release(void){}
+
+#endif
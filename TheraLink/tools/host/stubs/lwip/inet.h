@@ -0,0 +1,5 @@
+// Stub do lwIP (host): nada usado além do include
+#ifndef _LWIP_INET_H
+#define _LWIP_INET_H
+#include "lwip/ip_addr.h"
+#endif
@@ -0,0 +1,26 @@
+// Stub do lwIP (host): só IPv4 e o que o web_ap.c / DHCP / DNS declaram
+#ifndef _LWIP_IP_ADDR_H
+#define _LWIP_IP_ADDR_H
+
+#include <stdint.h>
+
+typedef uint8_t  u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t   s8_t;
+typedef s8_t     err_t;
+
+typedef struct { u32_t addr; } ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+
+#define ip_2_ip4(a) (a)
+#define IP4_ADDR(ip, a, b, c, d) \
+    ((ip)->addr = ((u32_t)(d) << 24) | ((u32_t)(c) << 16) | ((u32_t)(b) << 8) | (u32_t)(a))
+#define IPADDR_TYPE_ANY 46
+
+extern ip_addr_t ip_addr_any_type;
+#define IP_ANY_TYPE (&ip_addr_any_type)
+
+struct udp_pcb;
+
+#endif
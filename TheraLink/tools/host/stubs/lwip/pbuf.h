@@ -0,0 +1,19 @@
+// Stub do lwIP (host): pbuf contíguo (a cadeia vira um bloco no pbuf_cat)
+#ifndef _LWIP_PBUF_H
+#define _LWIP_PBUF_H
+
+#include "lwip/ip_addr.h"
+
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset);
+u8_t pbuf_free(struct pbuf *p);
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
+void pbuf_cat(struct pbuf *head, struct pbuf *tail);
+
+#endif
@@ -0,0 +1,46 @@
+// Stub do lwIP raw TCP (host): implementado em sim/net_sim.c
+#ifndef _LWIP_TCP_H
+#define _LWIP_TCP_H
+
+#include "lwip/pbuf.h"
+
+#define ERR_OK    0
+#define ERR_MEM  -1
+#define ERR_BUF  -2
+#define ERR_VAL  -6
+#define ERR_ABRT -13
+#define ERR_RST  -14
+#define ERR_CLSD -15
+
+#define TCP_MSS             1460
+#define TCP_SND_BUF         (8 * TCP_MSS)      // lwipopts.h do firmware
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+#define TCP_PRIO_MIN        1
+
+struct tcp_pcb;
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *tpcb);
+typedef void  (*tcp_err_fn)(void *arg, err_t err);
+typedef err_t (*tcp_accept_fn)(void *arg, struct tcp_pcb *newpcb, err_t err);
+
+struct tcp_pcb *tcp_new_ip_type(u8_t type);
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+struct tcp_pcb *tcp_listen(struct tcp_pcb *pcb);
+void  tcp_arg(struct tcp_pcb *pcb, void *arg);
+void  tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept);
+void  tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void  tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+void  tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval);
+void  tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+void  tcp_recved(struct tcp_pcb *pcb, u16_t len);
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb);
+err_t tcp_close(struct tcp_pcb *pcb);
+void  tcp_abort(struct tcp_pcb *pcb);
+void  tcp_nagle_disable(struct tcp_pcb *pcb);
+void  tcp_setprio(struct tcp_pcb *pcb, u8_t prio);
+
+#endif
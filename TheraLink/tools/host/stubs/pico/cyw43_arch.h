@@ -0,0 +1,18 @@
+// Stub do pico_cyw43_arch (host): rádio sempre sobe; o lock do lwIP só conta
+// o aninhamento (sim/net_sim.c confere que fecha)
+#ifndef _PICO_CYW43_ARCH_H
+#define _PICO_CYW43_ARCH_H
+
+#include "pico/stdlib.h"
+
+#define CYW43_WL_GPIO_LED_PIN   0
+#define CYW43_AUTH_OPEN         0
+#define CYW43_AUTH_WPA2_AES_PSK 0x00400004
+
+int  cyw43_arch_init(void);
+void cyw43_arch_enable_ap_mode(const char *ssid, const char *password, uint32_t auth);
+void cyw43_arch_gpio_put(uint wl_gpio, bool value);
+void cyw43_arch_lwip_begin(void);
+void cyw43_arch_lwip_end(void);
+
+#endif
@@ -0,0 +1,26 @@
+// Stub do Pico SDK p/ o build no host (tools/host): só o que o firmware usa.
+// O relógio é simulado (sim/pico_sim.c): anda com sleep_* e com o I2C.
+#ifndef _PICO_STDLIB_H
+#define _PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define count_of(a) (sizeof(a)/sizeof((a)[0]))
+#define __not_in_flash_func(f) f
+
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+absolute_time_t get_absolute_time(void);
+static inline uint32_t to_ms_since_boot(absolute_time_t t){ return (uint32_t)(t / 1000); }
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+static inline void tight_loop_contents(void){}
+
+#include "hardware/gpio.h"
+
+#endif
@@ -0,0 +1,362 @@
+// Somas por lag da autocorrelação (ac_push): as incrementais têm que ser
+// bit a bit iguais às diretas sobre a janela, em toda taxa suportada, com
+// a janela enchendo e deslizando. Depois o estimador inteiro: os traces
+// passam pelo SQI/suavização como no firmware e, a cada estimativa (1 s),
+// BPM e q do ac_estimate_bpm() têm que sair bit a bit iguais aos do
+// estimador direto O(N*lags) (o de antes das somas móveis). Nas mesmas
+// janelas o motor Goertzel estima também, p/ comparar o erro dos dois
+// contra o BPM do trace. Por fim o custo em MAC (produtos 64 bits) e em
+// tempo do host: direto x incremental e ACF x Goertzel.
+//
+// Uso: test_acf [--bench] trace.csv...   (--bench: 2000 s de sinal em vez de 20)
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include "oximetro.c"
+#include "check.h"
+#include "sim.h"
+
+static uint32_t s_rng = 12345;
+static uint32_t rnd(void){ s_rng = s_rng*1664525u + 1013904223u; return s_rng >> 8; }
+
+// soma da média móvel de um PPG (escala smooth_len), de vez em quando nos extremos
+static int32_t sample(int i){
+    if(rnd() % 97 == 0) return (rnd() & 1) ? 0 : smooth_len * 0x3FFFF;
+    double ppg = 100000.0 - 900.0*sin(2.0*3.14159265358979*1.2*i/fs_hz) + (double)(rnd() % 200);
+    return (int32_t)(smooth_len * ppg);
+}
+
+static void set_cfg(uint16_t sr, uint8_t avg, uint16_t pw){
+    g_is30102 = true;
+    oxi_config_t c = { sr, avg, pw };
+    CHECK(cfg_resolve(&c, &c));
+    cfg_apply(&c);
+    ac_reset();
+}
+
+// janela em ordem cronológica
+static int window(int64_t *x){
+    int first = (ac_n == ac_len) ? ac_head : 0;
+    for(int i = 0; i < ac_n; i++) x[i] = ac_buf[(first + i) % ac_len];
+    return ac_n;
+}
+
+static bool sums_exact(void){
+    static int64_t x[AC_SAMPLES_MAX];
+    int n = window(x);
+    int64_t s = 0, s0 = 0;
+    for(int i = 0; i < n; i++){ s += x[i]; s0 += x[i]*x[i]; }
+    if(s != ac_sum || s0 != ac_s0) return false;
+    for(int k = lag_min; k <= lag_max; k++){
+        int64_t sk = 0;
+        for(int i = 0; i + k < n; i++) sk += x[i]*x[i+k];
+        if(sk != ac_sk[k-lag_min]) return false;
+    }
+    return true;
+}
+
+static void check_exact(uint16_t sr, uint8_t avg, uint16_t pw){
+    set_cfg(sr, avg, pw);
+    int bad = 0, n = 5 * ac_len;
+    for(int i = 0; i < n; i++){
+        ac_push(sample(i));
+        if(!sums_exact()) bad++;
+    }
+    printf("somas exatas @%d Hz (%d lags, %d amostras): %s\n", fs_hz, lag_max - lag_min + 1, n, bad ? "DIVERGEM" : "ok");
+    CHECK(bad == 0);
+}
+
+// ====== Referência: estimador direto (antes das somas móveis) ======
+// Mesmo R[k] não viesado, mesma regra do subharmônico e mesma interpolação
+// do ac_estimate_bpm(), mas S[k], A e B refeitos da janela a cada
+// estimativa: O(N*lags). s_mac_dir conta os produtos.
+static long s_mac_dir;
+
+#if OXI_FIXED_POINT
+static bool direct_estimate_bpm(float *out_bpm, float *out_q){
+    static int64_t x[AC_SAMPLES_MAX];
+    const int64_t N = window(x);
+    if(N < ac_min) return false;
+
+    int64_t tot = 0, s0 = 0;
+    for(int i = 0; i < N; i++){ tot += x[i]; s0 += x[i]*x[i]; }
+    s_mac_dir += N;
+    int64_t t2n = (tot*tot) / N;
+    int64_t r0 = N*s0 - tot*tot;
+    if(r0 <= 0) return false;
+
+    static int64_t r[AC_NLAGS_MAX];
+    for(int k = lag_min; k <= lag_max; k++){
+        int64_t sk = 0, a = 0, b = 0;
+        for(int i = 0; i + k < N; i++){ sk += x[i]*x[i+k]; a += x[i]; b += x[i+k]; }
+        s_mac_dir += N - k;
+        r[k-lag_min] = (N*sk - tot*(a + b) + (N - k)*t2n) / (N - k);
+    }
+    r0 /= N;
+    if(r0 <= 0) return false;
+
+    int best_k = lag_min;
+    for(int k = lag_min+1; k <= lag_max; k++) if(r[k-lag_min] > r[best_k-lag_min]) best_k = k;
+    int64_t rb = r[best_k-lag_min];
+    for(int k = lag_min+1; k < best_k && rb > 0; k++){
+        int64_t v = r[k-lag_min];
+        if(v >= r[k-1-lag_min] && v >= r[k+1-lag_min] && v*100 >= rb*SUBHARM_PCT){ best_k = k; break; }
+    }
+
+    int sh = 0;
+    while((r0 >> sh) > 0x3FFFFFFF) sh++;
+    int32_t qk = ac_q15(r[best_k-lag_min], r0, sh);
+    if(best_k > lag_min && best_k < lag_max){
+        int32_t qa = ac_q15(r[best_k-1-lag_min], r0, sh);
+        int32_t qc = ac_q15(r[best_k+1-lag_min], r0, sh);
+        int32_t denom = qa - 2*qk + qc, delta = 0;
+        if(denom != 0) delta = (int32_t)(((int64_t)(qa - qc) * 16384) / denom);
+        if(delta < -32768) delta = -32768;
+        if(delta >  32768) delta =  32768;
+        int32_t bpm_q8 = (int32_t)(((int64_t)(60 * fs_hz) << 23) / ((best_k << 15) + delta));
+        *out_bpm = (float)bpm_q8 * (1.0f/256.0f);
+    } else {
+        *out_bpm = (float)((60 * fs_hz * 256) / best_k) * (1.0f/256.0f);
+    }
+    *out_q = (float)qk * (1.0f/32768.0f);
+    return true;
+}
+#else
+static bool direct_estimate_bpm(float *out_bpm, float *out_q){
+    static int64_t x[AC_SAMPLES_MAX];
+    const int N = window(x);
+    if(N < ac_min) return false;
+
+    int64_t tot = 0, s0 = 0;
+    for(int i = 0; i < N; i++){ tot += x[i]; s0 += x[i]*x[i]; }
+    s_mac_dir += N;
+    double mean = (double)tot / (double)N;
+    double r0 = ((double)s0 - mean*(double)tot) / (double)N;
+    if(r0 <= 1e-6) return false;
+
+    static double r[AC_NLAGS_MAX];
+    for(int k = lag_min; k <= lag_max; k++){
+        int64_t sk = 0, a = 0, b = 0;
+        for(int i = 0; i + k < N; i++){ sk += x[i]*x[i+k]; a += x[i]; b += x[i+k]; }
+        s_mac_dir += N - k;
+        double n = (double)(N - k);
+        r[k-lag_min] = ((double)sk - mean*((double)a + (double)b) + n*mean*mean) / (n*r0);
+    }
+
+    int best_k = lag_min;
+    for(int k = lag_min+1; k <= lag_max; k++) if(r[k-lag_min] > r[best_k-lag_min]) best_k = k;
+    double best_r = r[best_k-lag_min];
+    for(int k = lag_min+1; k < best_k && best_r > 0.0; k++){
+        double v = r[k-lag_min];
+        if(v >= r[k-1-lag_min] && v >= r[k+1-lag_min] && v*100.0 >= best_r*SUBHARM_PCT){ best_k = k; best_r = v; break; }
+    }
+
+    if(best_k > lag_min && best_k < lag_max){
+        double a = r[best_k-1-lag_min], b = r[best_k-lag_min], c = r[best_k+1-lag_min];
+        double den = a - 2.0*b + c, delta = 0.0;
+        if(fabs(den) > 1e-9) delta = 0.5*(a - c)/den;
+        double kr = (double)best_k + delta;
+        if(delta < -1.0) kr = (double)best_k - 1.0;
+        if(delta >  1.0) kr = (double)best_k + 1.0;
+        *out_bpm = (float)(60.0 * (double)fs_hz / kr);
+        *out_q = (float)b;
+    } else {
+        *out_bpm = (float)(60.0f * (float)fs_hz / (float)best_k);
+        *out_q = (float)best_r;
+    }
+    return true;
+}
+#endif
+
+// ====== Traces: incremental contra direto a cada estimativa ======
+// O trace (50 Hz) entra pelo sqi_push() como no OXI_RUN; 25 Hz pega uma
+// amostra em duas e 100 Hz interpola o meio. Estimativa a cada fs amostras.
+// Erro contra o BPM do trace por motor (0 = ACF, 1 = Goertzel); > 10 bpm
+// conta como grosseiro (oitava, movimento).
+#define GROSS_BPM 10.0f
+static int s_est, s_diff;
+static int s_cmp, s_gross[2];
+static double s_err[2];
+
+static void same_estimates(const sim_trace_t *tr, uint16_t sr, uint8_t avg, uint16_t pw){
+    set_cfg(sr, avg, pw);
+    use_ch = CH_IR;
+    int est = 0, diff = 0, got = 0, cmp = 0, gross[2] = {0, 0};
+    double err[2] = {0, 0};
+    uint32_t n = (uint32_t)((uint64_t)tr->n * fs_hz / 50);
+    for(uint32_t i = 0; i < n; i++){
+        uint32_t j = (uint32_t)((uint64_t)i * 50 / fs_hz);
+        int32_t ir = tr->ir[j], red = tr->red[j];
+        if(fs_hz > 50 && (i & 1) && j + 1 < tr->n){
+            ir = (ir + tr->ir[j+1]) / 2;
+            red = (red + tr->red[j+1]) / 2;
+        }
+        sqi_push(ir, red);
+        if((i + 1) % fs_hz || ac_n < ac_min) continue;
+
+        float b1 = 0, q1 = 0, b2 = 0, q2 = 0;
+        bool g1 = ac_estimate_bpm(&b1, &q1), g2 = direct_estimate_bpm(&b2, &q2);
+        est++;
+        got += g1;
+        if(g1 != g2 || (g1 && (memcmp(&b1, &b2, sizeof b1) || memcmp(&q1, &q2, sizeof q1)))){
+            if(!diff) fprintf(stderr, "  %u Hz, t=%u s: %.4f/%.6f contra %.4f/%.6f\n",
+                              fs_hz, (unsigned)((i + 1) / fs_hz), b1, q1, b2, q2);
+            diff++;
+        }
+        float b3 = 0, q3 = 0;
+        if(g1 && gz_estimate_bpm(&b3, &q3) && !isnan(tr->bpm)){
+            const float e[2] = { fabsf(b1 - tr->bpm), fabsf(b3 - tr->bpm) };
+            for(int m = 0; m < 2; m++){ err[m] += e[m]; gross[m] += e[m] > GROSS_BPM; }
+            cmp++;
+        }
+    }
+    printf("  @%3d Hz: %2d estimativas (%d com BPM), %s", fs_hz, est, got, diff ? "DIVERGEM" : "iguais");
+    if(cmp) printf("; |erro| ACF %.2f (%d > %.0f), Goertzel %.2f (%d > %.0f)",
+                   err[0] / cmp, gross[0], GROSS_BPM, err[1] / cmp, gross[1], GROSS_BPM);
+    printf("\n");
+    CHECK(est > 0);
+    s_est += est;
+    s_diff += diff;
+    s_cmp += cmp;
+    for(int m = 0; m < 2; m++){ s_err[m] += err[m]; s_gross[m] += gross[m]; }
+}
+
+static void check_traces(int n, char **paths){
+    for(int i = 0; i < n; i++){
+        sim_trace_t tr;
+        if(!sim_trace_load(&tr, paths[i])){ fprintf(stderr, "%s: trace invalido\n", paths[i]); g_fails++; continue; }
+        const char *name = strrchr(paths[i], '/') ? strrchr(paths[i], '/') + 1 : paths[i];
+        printf("%s:\n", name);
+        same_estimates(&tr, 200, 8, 411);   // 25 Hz
+        same_estimates(&tr, 400, 8, 411);   // 50 Hz
+        same_estimates(&tr, 800, 8, 215);   // 100 Hz
+        sim_trace_free(&tr);
+    }
+    printf("%s: %d estimativas, BPM e q incremental x direto %s\n",
+           OXI_FIXED_POINT ? "Q15" : "double", s_est, s_diff ? "DIVERGEM" : "bit a bit iguais");
+    CHECK(s_diff == 0);
+    if(s_cmp) printf("motores, %d estimativas: |erro| medio ACF %.2f bpm (%d grosseiros), Goertzel %.2f bpm (%d grosseiros)\n",
+                     s_cmp, s_err[0] / s_cmp, s_gross[0], s_err[1] / s_cmp, s_gross[1]);
+}
+
+// ====== Benchmark ======
+static volatile float s_sink;   // segura o resultado fora do otimizador
+static long s_mac_inc;
+
+// ac_push contando os produtos: x^2, os que saem e os que entram
+static void push(int32_t y){
+    int nl = lag_max - lag_min + 1;
+    int prev = (ac_n == ac_len) ? ac_len-1 : ac_n;
+    int in = prev < lag_min ? 0 : (prev >= lag_max ? nl : prev - lag_min + 1);
+    s_mac_inc += 1 + in + (ac_n == ac_len ? nl : 0);
+    ac_push(y);
+}
+
+// 5 s de PPG a 72 bpm (6 períodos inteiros: o sinal repetido não tem emenda)
+#define SIG_SECS 5
+static int32_t s_sig[OXI_FS_MAX_HZ * SIG_SECS];
+static void fill_sig(void){
+    for(int i = 0; i < fs_hz * SIG_SECS; i++){
+        double v = 100000.0 - 900.0*sin(2.0*3.14159265358979*1.2*i/fs_hz) + (double)(rnd() % 200);
+        s_sig[i] = (int32_t)(smooth_len * v);
+    }
+}
+#define SIG(s, i) s_sig[((s) % SIG_SECS) * fs_hz + (i)]
+
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// custo por segundo de sinal: fs amostras + 1 estimativa (janela cheia)
+// (sinal gerado antes, fora do tempo medido)
+static void bench(uint16_t sr, uint8_t avg, uint16_t pw, int secs){
+    set_cfg(sr, avg, pw);
+    const int nl = lag_max - lag_min + 1;
+    fill_sig();
+    for(int i = 0; i < ac_len; i++) ac_push(s_sig[i % (fs_hz * SIG_SECS)]);
+    float b = 0, q = 0;
+
+    s_mac_inc = 0;
+    double t0 = now_ns();
+    for(int s = 0; s < secs; s++){
+        for(int i = 0; i < fs_hz; i++) push(SIG(s, i));
+        if(ac_estimate_bpm(&b, &q)) s_sink += b;
+    }
+    double inc = (now_ns() - t0) / secs;
+
+    s_mac_dir = 0;
+    t0 = now_ns();
+    for(int s = 0; s < secs; s++){
+        // antes: só grava no ring; todo o trabalho fica na estimativa
+        for(int i = 0; i < fs_hz; i++){ ac_buf[ac_head] = SIG(s, i); ac_head = (ac_head + 1) % ac_len; }
+        if(direct_estimate_bpm(&b, &q)) s_sink += b;
+    }
+    double dir = (now_ns() - t0) / secs;
+
+    long md = s_mac_dir / secs, mi = s_mac_inc / secs;
+    // direto: os MAC todos de uma vez na estimativa; incremental: ~nl*2 por amostra
+    printf("custo @%d Hz (%d lags, janela %d), por s de sinal: direto %ld MAC (%.1f us), "
+           "incremental %ld MAC (%.1f us) => %.1fx menos MAC\n",
+           fs_hz, nl, ac_len, md, dir * 1e-3, mi, inc * 1e-3, (double)md / mi);
+}
+
+// motores: por segundo de sinal, fs amostras + 1 estimativa sobre a janela
+// cheia. O Goertzel não mantém as somas por lag (só soma/S0 no push) e
+// paga M = N/2 produtos por bin na estimativa, mais M p/ a energia.
+static void bench_engines(uint16_t sr, uint8_t avg, uint16_t pw, int secs){
+    const oxi_engine_t eng[2] = { OXI_ENGINE_ACF, OXI_ENGINE_GOERTZEL };
+    double ns[2];
+    long mac[2];
+    float bpm[2] = {0, 0};
+    set_cfg(sr, avg, pw);
+    fill_sig();
+    for(int e = 0; e < 2; e++){
+        engine_run = eng[e];
+        ac_reset();
+        for(int i = 0; i < ac_len; i++) ac_push(s_sig[i % (fs_hz * SIG_SECS)]);
+        float q = 0;
+        s_mac_inc = 0;
+        double t0 = now_ns();
+        for(int s = 0; s < secs; s++){
+            bool got;
+            if(engine_run == OXI_ENGINE_GOERTZEL){
+                for(int i = 0; i < fs_hz; i++) ac_push(SIG(s, i));
+                got = gz_estimate_bpm(&bpm[e], &q);
+            }else{
+                for(int i = 0; i < fs_hz; i++) push(SIG(s, i));
+                got = ac_estimate_bpm(&bpm[e], &q);
+            }
+            if(got) s_sink += bpm[e];
+        }
+        ns[e] = (now_ns() - t0) / secs;
+        mac[e] = s_mac_inc / secs;
+    }
+    const long m = ac_len / GZ_DECIM;
+    mac[1] = 2 * fs_hz + m + (long)GZ_NBINS * m;
+    engine_run = OXI_ENGINE_ACF;
+    printf("motores @%d Hz, por s de sinal: ACF %ld MAC (%.1f us, %.2f bpm), Goertzel %ld MAC "
+           "(%d bins x %ld, %.1f us, %.2f bpm) => Goertzel/ACF %.2fx MAC, %.2fx tempo\n",
+           fs_hz, mac[0], ns[0] * 1e-3, bpm[0], mac[1], GZ_NBINS, m, ns[1] * 1e-3, bpm[1],
+           (double)mac[1] / mac[0], ns[1] / ns[0]);
+}
+
+int main(int argc, char **argv){
+    bool full = argc > 1 && !strcmp(argv[1], "--bench");
+    int first = full ? 2 : 1;
+
+    check_exact(200, 8, 411);   // 25 Hz
+    check_exact(400, 8, 411);   // 50 Hz
+    check_exact(800, 8, 215);   // 100 Hz
+
+    check_traces(argc - first, argv + first);
+    CHECK(argc > first);
+
+    bench(400, 8, 411, full ? 2000 : 20);   // 50 Hz
+    bench(800, 8, 215, full ? 1000 : 10);   // 100 Hz
+    bench_engines(400, 8, 411, full ? 2000 : 20);
+    bench_engines(800, 8, 215, full ? 1000 : 10);
+
+    if(!g_fails) printf("test_acf: ok\n");
+    return g_fails ? 1 : 0;
+}
@@ -0,0 +1,409 @@
+// CBOR: o escritor do firmware (cbor.c) contra os exemplos da RFC 8949
+// (apêndice A) e o leitor do host (cbor_dec.c) num vai-e-volta aleatório,
+// com buffer curto parando sem escrever fora. Depois o /stats.cbor pelo
+// web_ap.c: cada valor bate com o stats.c (bit a bit) e com o /stats.json
+// geral e por cor (na precisão do JSON). Por fim tamanho e custo no host
+// de uma leitura completa (geral + 3 cores): 1 /stats.cbor contra 4 /stats.json.
+//
+// Uso: test_cbor [--bench]   (--bench: mais repetições na medida de tempo)
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cbor.h"
+#include "cbor_dec.h"
+#include "stats.h"
+#include "web_ap.h"
+#include "http_client.h"
+#include "check.h"
+
+// ====== Escritor: exemplos da RFC 8949 ======
+static bool hex_eq(const uint8_t *b, size_t n, const char *hex){
+    if(strlen(hex) != 2 * n) return false;
+    for(size_t i = 0; i < n; i++){
+        unsigned v;
+        if(sscanf(hex + 2 * i, "%2x", &v) != 1 || v != b[i]) return false;
+    }
+    return true;
+}
+
+#define ENC(hex, ...) do{ cbor_init(&w, buf, sizeof buf); __VA_ARGS__; \
+    CHECK(!w.ovf && hex_eq(buf, (size_t)(w.p - buf), hex)); }while(0)
+
+static void test_rfc_vectors(void){
+    uint8_t buf[32];
+    cbor_w_t w;
+    ENC("00", cbor_uint(&w, 0));
+    ENC("17", cbor_uint(&w, 23));
+    ENC("1818", cbor_uint(&w, 24));
+    ENC("1864", cbor_uint(&w, 100));
+    ENC("1903e8", cbor_uint(&w, 1000));
+    ENC("1a000f4240", cbor_uint(&w, 1000000));
+    ENC("1affffffff", cbor_uint(&w, 0xFFFFFFFFu));
+    ENC("fa47c35000", cbor_f32(&w, 100000.0f));
+    ENC("fa7f7fffff", cbor_f32(&w, 3.4028234663852886e+38f));
+    ENC("fa7f800000", cbor_f32(&w, INFINITY));
+    ENC("faff800000", cbor_f32(&w, -INFINITY));
+    ENC("80", cbor_array(&w, 0));
+    ENC("a0", cbor_map(&w, 0));
+    ENC("8301820203820405", cbor_array(&w, 3); cbor_uint(&w, 1);
+        cbor_array(&w, 2); cbor_uint(&w, 2); cbor_uint(&w, 3);
+        cbor_array(&w, 2); cbor_uint(&w, 4); cbor_uint(&w, 5));
+    ENC("a201020304", cbor_map(&w, 2); cbor_uint(&w, 1); cbor_uint(&w, 2); cbor_uint(&w, 3); cbor_uint(&w, 4));
+    ENC("98190000", cbor_array(&w, 25); cbor_uint(&w, 0); cbor_uint(&w, 0));   // só o cabeçalho longo
+
+    // leitor: float16 da RFC (o firmware não escreve, o cbor_dump lê)
+    static const struct { uint8_t b[3]; double v; } k_half[] = {
+        { { 0xf9, 0x3c, 0x00 }, 1.0 }, { { 0xf9, 0x7b, 0xff }, 65504.0 },
+        { { 0xf9, 0x00, 0x01 }, 5.960464477539063e-8 }, { { 0xf9, 0xc4, 0x00 }, -4.0 },
+    };
+    for(size_t i = 0; i < sizeof k_half / sizeof k_half[0]; i++){
+        cbor_r_t r;
+        double v = 0;
+        cbor_r_init(&r, k_half[i].b, 3);
+        CHECK(cbor_r_float(&r, &v) && v == k_half[i].v);
+    }
+}
+
+// ====== Vai-e-volta aleatório + buffer curto ======
+static uint32_t s_rng = 8949;
+static uint32_t rnd(void){ s_rng = s_rng*1664525u + 1013904223u; return s_rng >> 8; }
+
+typedef struct { uint8_t kind; uint32_t v; } op_t;   // 0 uint, 1 f32 (bits), 2 array, 3 map
+
+static uint32_t rnd_arg(void){
+    static const uint32_t k_edge[] = { 0, 23, 24, 255, 256, 65535, 65536, 0xFFFFFFFFu };
+    switch(rnd() % 4){
+    case 0:  return k_edge[rnd() % 8];
+    case 1:  return rnd() % 24;
+    case 2:  return rnd() % 70000;
+    default: return rnd() << 8 ^ rnd();
+    }
+}
+
+static void write_ops(cbor_w_t *w, const op_t *ops, int n){
+    for(int i = 0; i < n; i++){
+        float f;
+        switch(ops[i].kind){
+        case 0: cbor_uint(w, ops[i].v); break;
+        case 1: memcpy(&f, &ops[i].v, sizeof f); cbor_f32(w, f); break;
+        case 2: cbor_array(w, ops[i].v); break;
+        default: cbor_map(w, ops[i].v); break;
+        }
+    }
+}
+
+static void test_roundtrip(int iters){
+    static op_t ops[64];
+    static uint8_t buf[64 * 5 + 16];
+    int bad = 0, ovf_bad = 0;
+    for(int it = 0; it < iters; it++){
+        int n = 1 + (int)(rnd() % 64);
+        for(int i = 0; i < n; i++){ ops[i].kind = (uint8_t)(rnd() % 4); ops[i].v = ops[i].kind == 1 ? (rnd() << 8 ^ rnd()) : rnd_arg(); }
+        cbor_w_t w;
+        cbor_init(&w, buf, sizeof buf);
+        write_ops(&w, ops, n);
+        size_t len = (size_t)(w.p - buf);
+        if(w.ovf){ bad++; continue; }
+
+        // itens soltos (cabeçalhos de array/map sem filhos): lê um a um
+        cbor_r_t r;
+        cbor_r_init(&r, buf, len);
+        for(int i = 0; i < n; i++){
+            uint32_t v = 0;
+            double d;
+            bool ok;
+            switch(ops[i].kind){
+            case 0:  ok = cbor_r_uint(&r, &v) && v == ops[i].v; break;
+            case 1: { ok = cbor_r_float(&r, &d); float f = (float)d; memcpy(&v, &f, sizeof v);
+                      ok = ok && (v == ops[i].v || (isnan(f) && ((ops[i].v >> 23 & 0xFF) == 0xFF))); break; }
+            case 2:  ok = cbor_r_array(&r, &v) && v == ops[i].v; break;
+            default: ok = cbor_r_map(&r, &v) && v == ops[i].v; break;
+            }
+            if(!ok){ bad++; break; }
+        }
+        if(r.p != r.end) bad++;
+
+        // buffer curto: ovf, nada fora, e o que saiu é prefixo de itens inteiros
+        size_t cut = rnd() % (len + 1);
+        static uint8_t sh[sizeof buf + 8];
+        memset(sh, 0xEE, sizeof sh);
+        cbor_init(&w, sh, cut);
+        write_ops(&w, ops, n);
+        size_t got = (size_t)(w.p - sh);
+        if(w.ovf != (cut < len) || got > cut || memcmp(sh, buf, got)) ovf_bad++;
+        for(size_t i = cut; i < sizeof sh; i++) if(sh[i] != 0xEE){ ovf_bad++; break; }
+    }
+    printf("vai-e-volta: %d sequencias, %d divergem, %d com buffer curto errado\n", iters, bad, ovf_bad);
+    CHECK(bad == 0 && ovf_bad == 0);
+
+    // entrada truncada/indefinida: erro, sem ler fora
+    static const uint8_t k_bad[][3] = { { 0x19, 0x01 }, { 0x9f }, { 0xfa, 0, 0 }, { 0x5a, 0, 0 } };
+    for(size_t i = 0; i < sizeof k_bad / sizeof k_bad[0]; i++){
+        cbor_r_t r;
+        cbor_r_init(&r, k_bad[i], i == 0 ? 2 : i == 1 ? 1 : 3);
+        CHECK(!cbor_r_skip(&r) && r.err);
+    }
+}
+
+// ====== /stats.cbor contra stats.c e /stats.json ======
+// um grupo do /stats.cbor (chaves no README)
+typedef struct {
+    float    bpm, spo2, rmssd, sdnn, pnn50, ans, energy, humor;
+    uint32_t bpm_n, spo2_n, hrv_n, ans_n, energy_n, humor_n;
+    uint32_t cores[3], svy_n, yes[10], last_bits;
+} group_t;
+
+typedef struct {
+    uint32_t ver, sid;
+    float    bpm_live, spo2_live;
+    group_t  all, col[STAT_COLOR_COUNT];
+} stats_cbor_t;
+
+static bool rd_f32(cbor_r_t *r, float *f){
+    double d;
+    if(!cbor_r_float(r, &d)) return false;
+    *f = (float)d;
+    return true;
+}
+
+static bool rd_uints(cbor_r_t *r, uint32_t *v, uint32_t n){
+    uint32_t m;
+    if(!cbor_r_array(r, &m) || m != n) return false;
+    for(uint32_t i = 0; i < n; i++) if(!cbor_r_uint(r, &v[i])) return false;
+    return true;
+}
+
+static bool rd_group(cbor_r_t *r, group_t *g){
+    uint32_t n, k;
+    memset(g, 0, sizeof *g);
+    if(!cbor_r_map(r, &n)) return false;
+    for(uint32_t i = 0; i < n; i++){
+        if(!cbor_r_uint(r, &k)) return false;
+        bool ok;
+        switch(k){
+        case 0:  ok = rd_f32(r, &g->bpm); break;
+        case 1:  ok = cbor_r_uint(r, &g->bpm_n); break;
+        case 2:  ok = rd_f32(r, &g->spo2); break;
+        case 3:  ok = cbor_r_uint(r, &g->spo2_n); break;
+        case 4:  ok = rd_f32(r, &g->rmssd); break;
+        case 5:  ok = rd_f32(r, &g->sdnn); break;
+        case 6:  ok = rd_f32(r, &g->pnn50); break;
+        case 7:  ok = cbor_r_uint(r, &g->hrv_n); break;
+        case 8:  ok = rd_f32(r, &g->ans); break;
+        case 9:  ok = cbor_r_uint(r, &g->ans_n); break;
+        case 10: ok = rd_f32(r, &g->energy); break;
+        case 11: ok = cbor_r_uint(r, &g->energy_n); break;
+        case 12: ok = rd_f32(r, &g->humor); break;
+        case 13: ok = cbor_r_uint(r, &g->humor_n); break;
+        case 14: ok = rd_uints(r, g->cores, 3); break;
+        case 15: ok = cbor_r_uint(r, &g->svy_n); break;
+        case 16: ok = rd_uints(r, g->yes, 10); break;
+        case 17: ok = cbor_r_uint(r, &g->last_bits); break;
+        default: ok = cbor_r_skip(r); break;          // chave nova: ignora
+        }
+        if(!ok) return false;
+    }
+    return true;
+}
+
+static bool rd_stats(const void *buf, size_t len, stats_cbor_t *s){
+    cbor_r_t r;
+    uint32_t n, k, m;
+    cbor_r_init(&r, buf, len);
+    memset(s, 0, sizeof *s);
+    if(!cbor_r_map(&r, &n)) return false;
+    for(uint32_t i = 0; i < n; i++){
+        if(!cbor_r_uint(&r, &k)) return false;
+        bool ok;
+        switch(k){
+        case 0: ok = cbor_r_uint(&r, &s->ver); break;
+        case 1: ok = cbor_r_uint(&r, &s->sid); break;
+        case 2: ok = rd_f32(&r, &s->bpm_live); break;
+        case 3: ok = rd_f32(&r, &s->spo2_live); break;
+        case 4: ok = rd_group(&r, &s->all); break;
+        case 5:
+            ok = cbor_r_array(&r, &m) && m == STAT_COLOR_COUNT;
+            for(uint32_t c = 0; ok && c < m; c++) ok = rd_group(&r, &s->col[c]);
+            break;
+        default: ok = cbor_r_skip(&r); break;
+        }
+        if(!ok) return false;
+    }
+    return r.p == r.end;
+}
+
+static bool same_f(float a, float b){ return (isnan(a) && isnan(b)) || !memcmp(&a, &b, sizeof a); }
+
+// float do CBOR = valor do stats.c, bit a bit
+static bool group_eq_snapshot(const group_t *g, const stats_snapshot_t *s){
+    return same_f(g->bpm, s->bpm_mean_trimmed) && g->bpm_n == s->bpm_count &&
+           same_f(g->spo2, s->spo2_mean) && g->spo2_n == s->spo2_count &&
+           same_f(g->rmssd, s->rmssd_mean) && same_f(g->sdnn, s->sdnn_mean) &&
+           same_f(g->pnn50, s->pnn50_mean) && g->hrv_n == s->hrv_count &&
+           same_f(g->ans, s->ans_mean) && g->ans_n == s->ans_count &&
+           same_f(g->energy, s->energy_mean) && g->energy_n == s->energy_count &&
+           same_f(g->humor, s->humor_mean) && g->humor_n == s->humor_count &&
+           g->cores[0] == s->cor_verde && g->cores[1] == s->cor_amarelo && g->cores[2] == s->cor_vermelho;
+}
+
+// número depois de "key": no JSON (NAN se não tem)
+static double jnum(const char *js, const char *key){
+    char k[40];
+    snprintf(k, sizeof k, "\"%s\":", key);
+    const char *p = strstr(js, k);
+    return p ? strtod(p + strlen(k), NULL) : NAN;
+}
+
+// JSON imprime NaN como 0 e arredonda (%.3f / %.1f)
+static bool near(double json, float cb, double tol){
+    double v = isnan(cb) ? 0.0 : cb;
+    return fabs(json - v) <= tol + 1e-6 * fabs(v);
+}
+
+static bool group_eq_json(const group_t *g, const char *js){
+    const char *y = strstr(js, "\"yes\":[");
+    if(!y) return false;
+    y += 7;
+    for(int i = 0; i < 10; i++){
+        char *e;
+        if(strtoul(y, &e, 10) != g->yes[i]) return false;
+        y = e + 1;
+    }
+    return near(jnum(js, "bpm_mean"), g->bpm, 0.0005) && jnum(js, "bpm_n") == g->bpm_n &&
+           near(jnum(js, "spo2_mean"), g->spo2, 0.05) && jnum(js, "spo2_n") == g->spo2_n &&
+           near(jnum(js, "rmssd_mean"), g->rmssd, 0.05) && near(jnum(js, "sdnn_mean"), g->sdnn, 0.05) &&
+           near(jnum(js, "pnn50_mean"), g->pnn50, 0.05) && jnum(js, "hrv_n") == g->hrv_n &&
+           jnum(js, "verde") == g->cores[0] && jnum(js, "amarelo") == g->cores[1] &&
+           jnum(js, "vermelho") == g->cores[2] && jnum(js, "n") == g->svy_n &&
+           jnum(js, "last_bits") == g->last_bits;
+}
+
+static const char *const k_color_q[STAT_COLOR_COUNT] = { "verde", "amarelo", "vermelho" };
+
+static http_client_t s_hc;
+static http_resp_t   s_resp;
+
+// uma triagem: cor, medidas, questionário atribuído à cor
+static void add_session(stat_color_t col, float bpm, float spo2, const char *ans, struct tcp_pcb *p){
+    stats_set_current_color(col);
+    stats_add_bpm(bpm);
+    if(!isnan(spo2)) stats_add_spo2(spo2);
+    stats_add_hrv(bpm * 0.5f, bpm * 0.6f, 12.5f);
+    stats_inc_color(col);
+    stats_add_anxiety(1 + (uint8_t)(bpm) % 4);
+    stats_add_energy(2);
+    stats_add_humor(3);
+    char path[64];
+    snprintf(path, sizeof path, "/survey_submit?ans=%s", ans);
+    CHECK(hc_get(&s_hc, p, path, &s_resp) && s_resp.status == 303);
+    uint16_t bits;
+    uint32_t tok;
+    CHECK(web_survey_peek(&bits, &tok));
+    web_assign_survey_token_to_color(tok, col);
+}
+
+static void test_stats_cbor(struct tcp_pcb *p){
+    stats_cbor_t s;
+
+    // sem dado nenhum: NaN nos floats, contagens 0
+    CHECK(hc_get(&s_hc, p, "/stats.cbor", &s_resp) && s_resp.status == 200);
+    CHECK(strstr(s_resp.head, "\r\nContent-Type: application/cbor\r\n") != NULL);
+    CHECK(rd_stats(s_resp.body, s_resp.body_len, &s));
+    CHECK(s.ver == 1 && isnan(s.all.bpm) && s.all.bpm_n == 0 && s.bpm_live == 0.0f && isnan(s.spo2_live));
+
+    add_session(STAT_COLOR_VERDE, 71.5f, 97.0f, "1010110011", p);
+    add_session(STAT_COLOR_AMARELO, 88.25f, 95.5f, "0000111100", p);
+    add_session(STAT_COLOR_AMARELO, 92.0f, NAN, "1111111111", p);
+    add_session(STAT_COLOR_VERMELHO, 121.0f, 91.0f, "0110000001", p);
+    web_set_oxi_live(75.5f, NAN);
+
+    CHECK(hc_get(&s_hc, p, "/stats.cbor", &s_resp) && s_resp.status == 200);
+    CHECK(rd_stats(s_resp.body, s_resp.body_len, &s));
+    CHECK(s.sid == stats_get_sample_id());
+    CHECK(s.bpm_live == 75.5f && isnan(s.spo2_live));
+    char etag[48];
+    snprintf(etag, sizeof etag, "\r\nETag: \"sc-%lx\"\r\n", (unsigned long)s.sid);
+    CHECK(strstr(s_resp.head, etag) != NULL);
+
+    stats_snapshot_t snap;
+    stats_get_snapshot(&snap);
+    CHECK(group_eq_snapshot(&s.all, &snap));
+    CHECK(s.all.svy_n == 4 && s.all.bpm_n == 4 && s.all.cores[1] == 2);
+    for(int c = 0; c < STAT_COLOR_COUNT; c++){
+        stats_get_snapshot_by_color((stat_color_t)c, &snap);
+        CHECK(group_eq_snapshot(&s.col[c], &snap));
+    }
+    CHECK(s.col[STAT_COLOR_AMARELO].svy_n == 2 && s.col[STAT_COLOR_AMARELO].yes[4] == 2 &&
+          s.col[STAT_COLOR_AMARELO].last_bits == 0x3FF);
+
+    // mesmos valores do /stats.json, geral e por cor
+    CHECK(hc_get(&s_hc, p, "/stats.json", &s_resp) && s_resp.status == 200);
+    CHECK(jnum(s_resp.body, "sample_id") == s.sid && near(jnum(s_resp.body, "bpm_live"), s.bpm_live, 0.0005) &&
+          near(jnum(s_resp.body, "spo2_live"), s.spo2_live, 0.05));
+    CHECK(group_eq_json(&s.all, s_resp.body));
+    CHECK(jnum(s_resp.body, "web_tx_drops") == web_tx_drops());   // saiu do OLED, vem aqui
+    for(int c = 0; c < STAT_COLOR_COUNT; c++){
+        char path[40];
+        snprintf(path, sizeof path, "/stats.json?color=%s", k_color_q[c]);
+        CHECK(hc_get(&s_hc, p, path, &s_resp) && s_resp.status == 200);
+        if(!group_eq_json(&s.col[c], s_resp.body)){
+            fprintf(stderr, "%s: /stats.cbor difere do JSON: %s\n", k_color_q[c], s_resp.body);
+            g_fails++;
+        }
+    }
+}
+
+// ====== Tamanho e custo: 1 /stats.cbor contra 4 /stats.json ======
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(struct tcp_pcb *p, int reps){
+    static const char *const k_json[] = {
+        "/stats.json", "/stats.json?color=verde", "/stats.json?color=amarelo", "/stats.json?color=vermelho",
+    };
+    size_t cb_body = 0, cb_wire = 0, js_body = 0, js_wire = 0;
+    double t0 = now_ns();
+    for(int i = 0; i < reps; i++){
+        if(!hc_get(&s_hc, p, "/stats.cbor", &s_resp) || s_resp.status != 200){ g_fails++; return; }
+        cb_body = s_resp.body_len; cb_wire = s_resp.wire_len;
+    }
+    double t_cb = (now_ns() - t0) / reps;
+    t0 = now_ns();
+    for(int i = 0; i < reps; i++){
+        js_body = js_wire = 0;
+        for(int k = 0; k < 4; k++){
+            if(!hc_get(&s_hc, p, k_json[k], &s_resp) || s_resp.status != 200){ g_fails++; return; }
+            js_body += s_resp.body_len; js_wire += s_resp.wire_len;
+        }
+    }
+    double t_js = (now_ns() - t0) / reps;
+    printf("geral + 3 cores: /stats.cbor %zu B (%zu na conexao), %.1f us | 4x /stats.json %zu B (%zu na conexao), %.1f us"
+           " => %.2fx menor, %.1fx mais rapido (host, servidor + lwIP simulado)\n",
+           cb_body, cb_wire, t_cb * 1e-3, js_body, js_wire, t_js * 1e-3,
+           (double)js_wire / cb_wire, t_js / t_cb);
+    CHECK(cb_body < js_body);
+}
+
+int main(int argc, char **argv){
+    bool full = argc > 1 && !strcmp(argv[1], "--bench");
+
+    test_rfc_vectors();
+    test_roundtrip(full ? 200000 : 20000);
+
+    web_ap_start();
+    struct tcp_pcb *p = sim_tcp_connect();
+    CHECK(p != NULL);
+    if(!p) return 1;
+    test_stats_cbor(p);
+    bench(p, full ? 20000 : 500);
+    CHECK(sim_tcp_state(p) == SIM_TCP_OPEN && sim_net_misuse() == 0);
+
+    if(!g_fails) printf("test_cbor: ok\n");
+    return g_fails ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+// Vetores dourados do estimador de BPM (ac_estimate_bpm). Compilado duas
+// vezes: OXI_FIXED_POINT=0 (double, gera e confere os vetores) e =1 (Q15,
+// confere contra os do double). Cada caso é uma janela sintética
+// reprodutível (taxa, BPM, ruído, semente, nº de amostras: parcial ou cheia).
+// Nos dois builds o BPM também tem que cair perto do BPM do sinal: o
+// double não vira referência de si mesmo (erro de oitava não entra).
+//
+// Uso: test_golden vetores.csv            confere
+//      test_golden --write vetores.csv    regrava (só no build double)
+#include "oximetro.c"
+#include "check.h"
+
+// Q15: |dBPM| e |dq| máximos aceitos contra o double
+#define TOL_BPM_Q15   0.02f
+#define TOL_Q_Q15     0.001f
+#define TOL_BPM_F64   0.0005f
+#define TOL_Q_F64     0.00001f
+// |BPM - BPM do sinal| máximo (ruído 600 @100 Hz chega a ~2)
+#define TOL_BPM_TRUE  3.0f
+
+typedef struct {
+    uint16_t sr; uint8_t avg; uint16_t pw;
+    float    bpm, noise;
+    uint32_t seed;
+    int      n;               // amostras na janela (0 = cheia)
+} gcase_t;
+
+static uint32_t s_rng;
+static uint32_t rnd(void){ s_rng = s_rng*1664525u + 1013904223u; return s_rng >> 8; }
+
+// roda o caso; false se o estimador não devolveu nada
+static bool run_case(const gcase_t *c, float *bpm, float *q){
+    g_is30102 = true;
+    oxi_config_t cfg = { c->sr, c->avg, c->pw };
+    if(!cfg_resolve(&cfg, &cfg)) return false;
+    cfg_apply(&cfg);
+    ac_reset();
+    s_rng = c->seed;
+    int n = c->n ? c->n : ac_len;
+    // 2 janelas antes do trecho medido: testa também a janela deslizando
+    int pre = (c->n == 0) ? 2 * ac_len : 0;
+    for(int i = 0; i < pre + n; i++){
+        double t = (double)i / fs_hz, ph = 2.0*3.14159265358979*c->bpm/60.0*t;
+        double w = sin(ph) + 0.35*sin(2.0*ph + 0.6);
+        double nz = c->noise * (((double)(rnd() % 2001) - 1000.0) / 1000.0);
+        ac_push((int32_t)lround(smooth_len * (100000.0 - 900.0*w + nz)));
+    }
+    return ac_estimate_bpm(bpm, q);
+}
+
+static int write_vectors(const char *path){
+#if OXI_FIXED_POINT
+    (void)path;
+    fprintf(stderr, "--write só no build double (OXI_FIXED_POINT=0)\n");
+    return 2;
+#else
+    static const uint16_t CFG[3][3] = { {200, 8, 411}, {400, 8, 411}, {800, 8, 215} };   // 25/50/100 Hz
+    static char out[16384];
+    size_t len = 0;
+    uint32_t seed = 1;
+    int rows = 0, bad = 0;
+    for(int ci = 0; ci < 3; ci++){
+        for(float b = 42.0f; b <= 178.0f; b += 17.0f){
+            for(int v = 0; v < 3; v++){
+                gcase_t c = { CFG[ci][0], (uint8_t)CFG[ci][1], CFG[ci][2], b, v == 2 ? 600.0f : 60.0f, seed++, 0 };
+                // v=1: janela parcial (logo acima do mínimo)
+                if(v == 1){
+                    oxi_config_t cfg = { c.sr, c.avg, c.pw };
+                    g_is30102 = true; cfg_resolve(&cfg, &cfg); cfg_apply(&cfg);
+                    c.n = ac_min + (ac_len - ac_min) / 3;
+                }
+                float bpm, q;
+                if(!run_case(&c, &bpm, &q)){
+                    fprintf(stderr, "%d Hz, %.1f bpm, semente %lu: sem estimativa\n", fs_hz, c.bpm, (unsigned long)c.seed);
+                    bad++;
+                    continue;
+                }
+                // vetor errado não vira dourado
+                if(fabsf(bpm - c.bpm) > TOL_BPM_TRUE){
+                    fprintf(stderr, "%d Hz, %.1f bpm, semente %lu: estimador deu %.4f\n", fs_hz, c.bpm,
+                            (unsigned long)c.seed, bpm);
+                    bad++;
+                }
+                len += (size_t)snprintf(out + len, sizeof out - len, "%u,%u,%u,%.1f,%.0f,%lu,%d,%.4f,%.6f\n",
+                                        c.sr, c.avg, c.pw, c.bpm, c.noise, (unsigned long)c.seed, c.n, bpm, q);
+                rows++;
+            }
+        }
+    }
+    if(bad || len >= sizeof out){
+        fprintf(stderr, "%d vetores fora de ±%.0f bpm do sinal: %s não foi regravado\n", bad, TOL_BPM_TRUE, path);
+        return 1;
+    }
+    FILE *f = fopen(path, "w");
+    if(!f){ perror(path); return 2; }
+    fprintf(f, "# gerado por test_golden --write (estimador double, |bpm_out - bpm| <= %.0f)\n", TOL_BPM_TRUE);
+    fprintf(f, "sr,avg,pw,bpm,noise,seed,n,bpm_out,q_out\n");
+    fputs(out, f);
+    fclose(f);
+    printf("%d vetores em %s\n", rows, path);
+    return 0;
+#endif
+}
+
+int main(int argc, char **argv){
+    if(argc == 3 && !strcmp(argv[1], "--write")) return write_vectors(argv[2]);
+    if(argc != 2){ fprintf(stderr, "uso: test_golden [--write] vetores.csv\n"); return 2; }
+
+    FILE *f = fopen(argv[1], "r");
+    if(!f){ perror(argv[1]); return 2; }
+    const float tol_b = OXI_FIXED_POINT ? TOL_BPM_Q15 : TOL_BPM_F64;
+    const float tol_q = OXI_FIXED_POINT ? TOL_Q_Q15 : TOL_Q_F64;
+    char line[256];
+    int rows = 0;
+    float worst_b = 0, worst_q = 0, worst_t = 0;
+    while(fgets(line, sizeof line, f)){
+        unsigned sr, avg, pw, n;
+        unsigned long seed;
+        float bpm_in, noise, gb, gq, bpm, q;
+        if(sscanf(line, "%u,%u,%u,%f,%f,%lu,%u,%f,%f", &sr, &avg, &pw, &bpm_in, &noise, &seed, &n, &gb, &gq) != 9) continue;
+        gcase_t c = { (uint16_t)sr, (uint8_t)avg, (uint16_t)pw, bpm_in, noise, (uint32_t)seed, (int)n };
+        rows++;
+        if(!run_case(&c, &bpm, &q)){
+            fprintf(stderr, "linha %d: sem estimativa\n", rows);
+            g_fails++;
+            continue;
+        }
+        float db = fabsf(bpm - gb), dq = fabsf(q - gq), dt = fabsf(bpm - bpm_in);
+        if(db > worst_b) worst_b = db;
+        if(dq > worst_q) worst_q = dq;
+        if(dt > worst_t) worst_t = dt;
+        if(db > tol_b || dq > tol_q){
+            fprintf(stderr, "linha %d (%u Hz, %.1f bpm, n=%u): %.4f/%.6f contra %.4f/%.6f\n",
+                    rows, sr / avg, bpm_in, n, bpm, q, gb, gq);
+            g_fails++;
+        }
+        // contra o sinal, não só contra o double (pega vetor dourado errado)
+        if(dt > TOL_BPM_TRUE || fabsf(gb - bpm_in) > TOL_BPM_TRUE){
+            fprintf(stderr, "linha %d (%u Hz, %.1f bpm, n=%u): %.4f (dourado %.4f) longe do sinal\n",
+                    rows, sr / avg, bpm_in, n, bpm, gb);
+            g_fails++;
+        }
+    }
+    fclose(f);
+    CHECK(rows > 0);
+    printf("%s: %d vetores, pior |dBPM| %.4f, pior |dq| %.6f, pior |BPM - sinal| %.2f\n",
+           OXI_FIXED_POINT ? "Q15" : "double", rows, worst_b, worst_q, worst_t);
+    if(!g_fails) printf("test_golden: ok\n");
+    return g_fails ? 1 : 0;
+}
@@ -0,0 +1,338 @@
+// Parser incremental de request (http_req.c): requests válidos e malformados
+// (400/414/431), qualquer fatiamento dá o mesmo resultado que o buffer
+// inteiro (byte a byte e todo ponto de corte), pipelining, query e
+// Accept-Encoding. Depois um fuzz com bytes aleatórios em fatias aleatórias
+// que confere que o parser nunca escreve fora do http_req_t (guardas dos
+// dois lados) e deixa todo campo terminado em '\0' dentro do tamanho.
+//
+// Uso: test_http_req [--bench]   (--bench: custo por request no host, MB/s e req/s)
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "http_req.h"
+#include "check.h"
+
+// request típico do Chrome no Android p/ o /stats.json
+static const char k_browser[] =
+    "GET /stats.json?color=verde HTTP/1.1\r\n"
+    "Host: 192.168.4.1\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (Linux; Android 14; Pixel 7) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/120.0.0.0 Mobile Safari/537.36\r\n"
+    "Accept: */*\r\n"
+    "Referer: http://192.168.4.1/\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: pt-BR,pt;q=0.9,en-US;q=0.8,en;q=0.7\r\n"
+    "If-None-Match: \"st-2a-9\"\r\n"
+    "\r\n";
+
+#define GUARD 0xA5
+typedef struct {
+    uint8_t    pre[32];
+    http_req_t r;
+    uint8_t    post[32];
+} guarded_t;
+
+static void g_reset(guarded_t *g){
+    memset(g->pre, GUARD, sizeof g->pre);
+    memset(g->post, GUARD, sizeof g->post);
+    http_req_reset(&g->r);
+}
+
+static bool terminated(const char *s, size_t size){ return memchr(s, '\0', size) != NULL; }
+
+// guardas intactas e todo campo com '\0' dentro do tamanho
+static bool g_sane(const guarded_t *g){
+    for(size_t i = 0; i < sizeof g->pre; i++) if(g->pre[i] != GUARD || g->post[i] != GUARD) return false;
+    const http_req_t *r = &g->r;
+    return terminated(r->tok, sizeof r->tok) && terminated(r->path, sizeof r->path) &&
+           terminated(r->query, sizeof r->query) && terminated(r->inm, sizeof r->inm) &&
+           terminated(r->conn, sizeof r->conn) && terminated(r->wskey, sizeof r->wskey) &&
+           terminated(r->upgrade, sizeof r->upgrade) && terminated(r->wsver, sizeof r->wsver) &&
+           terminated(r->aenc, sizeof r->aenc) && r->total <= HTTP_REQ_MAX + 1 &&
+           r->st <= HTTP_REQ_DONE && (r->err == 0 || r->err == 400 || r->err == 414 || r->err == 431);
+}
+
+// alimenta em fatias de 'step' bytes (0 = tudo de uma vez); devolve quanto usou
+static size_t feed(http_req_t *r, const char *d, size_t n, size_t step){
+    size_t used = 0;
+    while(used < n && !http_req_done(r)){
+        size_t c = (step && step < n - used) ? step : n - used;
+        size_t k = http_req_feed(r, d + used, c);
+        CHECK(k <= c);
+        used += k;
+        if(k < c) break;                 // parou no fim do request
+    }
+    return used;
+}
+
+static http_req_t parse(const char *s, size_t *used){
+    http_req_t r;
+    http_req_reset(&r);
+    size_t u = feed(&r, s, strlen(s), 0);
+    if(used) *used = u;
+    return r;
+}
+
+static uint16_t status_of(const char *s){
+    http_req_t r = parse(s, NULL);
+    return http_req_done(&r) ? r.err : 0xFFFF;
+}
+
+// byte a byte e cada ponto de corte em 2 fatias: mesmo estado final
+static void check_slicing(const char *s){
+    size_t n = strlen(s), u0, u;
+    http_req_t whole = parse(s, &u0), r;
+    http_req_reset(&r);
+    u = feed(&r, s, n, 1);
+    CHECK(u == u0 && !memcmp(&r, &whole, sizeof r));
+    int bad = 0;
+    for(size_t cut = 1; cut < n; cut++){
+        http_req_reset(&r);
+        u = http_req_feed(&r, s, cut);
+        if(u == cut && !http_req_done(&r)) u += http_req_feed(&r, s + cut, n - cut);
+        if(u != u0 || memcmp(&r, &whole, sizeof r)) bad++;
+    }
+    CHECK(bad == 0);
+}
+
+static void test_valid(void){
+    size_t used;
+    http_req_t r = parse(k_browser, &used);
+    CHECK(http_req_done(&r) && r.err == 0 && used == strlen(k_browser));
+    CHECK(r.method == HTTP_M_GET && !r.http10);
+    CHECK(!strcmp(r.path, "/stats.json") && !strcmp(r.query, "color=verde"));
+    CHECK(!strcmp(r.conn, "keep-alive") && !strcmp(r.inm, "\"st-2a-9\"") && !strcmp(r.aenc, "gzip, deflate"));
+
+    r = parse("HEAD / HTTP/1.0\r\n\r\n", NULL);
+    CHECK(http_req_done(&r) && !r.err && r.method == HTTP_M_HEAD && r.http10 && !strcmp(r.path, "/"));
+    r = parse("POST /x HTTP/1.1\r\n\r\n", NULL);
+    CHECK(http_req_done(&r) && !r.err && r.method == HTTP_M_OTHER);
+
+    // LF sem CR, nome em outra caixa, valor sem espaço, dobra obsoleta ignorada
+    r = parse("GET /ws HTTP/1.1\nSEC-WEBSOCKET-KEY:abc\n folded\nConnection:  Upgrade\n\n", NULL);
+    CHECK(http_req_done(&r) && !r.err && !strcmp(r.wskey, "abc") && !strcmp(r.conn, "Upgrade"));
+
+    // handshake WS: Upgrade e versão; Connection/Upgrade são listas de tokens
+    r = parse("GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: keep-alive, Upgrade\r\n"
+              "Sec-WebSocket-Version: 13\r\n\r\n", NULL);
+    CHECK(http_req_done(&r) && !r.err && !strcmp(r.upgrade, "websocket") && !strcmp(r.wsver, "13"));
+    CHECK(http_req_has_token(r.conn, "upgrade") && http_req_has_token(r.conn, "keep-alive"));
+    CHECK(http_req_has_token("Upgrade ", "upgrade") && http_req_has_token(" x ,\tUPGRADE", "upgrade"));
+    CHECK(!http_req_has_token("Upgrades", "upgrade") && !http_req_has_token("", "upgrade") &&
+          !http_req_has_token("up grade", "upgrade"));
+
+    // valor longo: truncado no campo, request segue válido
+    char big[256];
+    snprintf(big, sizeof big, "GET / HTTP/1.1\r\nIf-None-Match: \"%0100d\"\r\n\r\n", 7);
+    r = parse(big, NULL);
+    CHECK(http_req_done(&r) && !r.err && strlen(r.inm) == sizeof r.inm - 1);
+
+    // nome de cabeçalho longo que não é nosso
+    snprintf(big, sizeof big, "GET / HTTP/1.1\r\nX-%060d: 1\r\nConnection: close\r\n\r\n", 0);
+    r = parse(big, NULL);
+    CHECK(http_req_done(&r) && !r.err && !strcmp(r.conn, "close"));
+
+    // incompleto: não termina, consome tudo
+    r = parse("GET /oled.json HTTP/1.1\r\nHost: x\r\n", &used);
+    CHECK(!http_req_done(&r) && used == 34);
+}
+
+static void test_malformed(void){
+    CHECK(status_of("get / HTTP/1.1\r\n\r\n") == 400);
+    CHECK(status_of(" / HTTP/1.1\r\n\r\n") == 400);
+    CHECK(status_of("GETTINGLONG / HTTP/1.1\r\n\r\n") == 400);
+    CHECK(status_of("GET stats HTTP/1.1\r\n\r\n") == 400);
+    CHECK(status_of("GET /\r\n\r\n") == 400);                    // HTTP/0.9
+    CHECK(status_of("GET /?a\r\n\r\n") == 400);
+    CHECK(status_of("GET / HTTP/2.0\r\n\r\n") == 400);
+    CHECK(status_of("GET / HTTP/1.10\r\n\r\n") == 400);
+    CHECK(status_of("GET / HTTP/1.1\r\nNoColon\r\n\r\n") == 400);
+    CHECK(status_of("GET / HTTP/1.1\r\n\rX") == 400);
+
+    char s[HTTP_REQ_MAX + 256];
+    snprintf(s, sizeof s, "GET /%0*d HTTP/1.1\r\n\r\n", HTTP_PATH_MAX - 2, 0);   // cabe (39 + '\0')
+    CHECK(status_of(s) == 0);
+    snprintf(s, sizeof s, "GET /%0*d HTTP/1.1\r\n\r\n", HTTP_PATH_MAX - 1, 0);
+    CHECK(status_of(s) == 414);
+    snprintf(s, sizeof s, "GET /?%0*d HTTP/1.1\r\n\r\n", HTTP_QUERY_MAX - 1, 0);
+    CHECK(status_of(s) == 0);
+    snprintf(s, sizeof s, "GET /?%0*d HTTP/1.1\r\n\r\n", HTTP_QUERY_MAX, 0);
+    CHECK(status_of(s) == 414);
+
+    // cabeçalhos somando mais que HTTP_REQ_MAX: 431 no byte que passa
+    int n = snprintf(s, sizeof s, "GET / HTTP/1.1\r\n");
+    while(n < HTTP_REQ_MAX) n += snprintf(s + n, sizeof s - n, "X-Pad: %060d\r\n", 0);
+    snprintf(s + n, sizeof s - n, "\r\n");
+    size_t used;
+    http_req_t r = parse(s, &used);
+    CHECK(http_req_done(&r) && r.err == 431 && used == HTTP_REQ_MAX + 1);
+    // exatamente no limite passa
+    n = snprintf(s, sizeof s, "GET / HTTP/1.1\r\nX-Pad: ");
+    memset(s + n, 'a', HTTP_REQ_MAX - n - 4);
+    memcpy(s + HTTP_REQ_MAX - 4, "\r\n\r\n", 5);
+    CHECK(strlen(s) == HTTP_REQ_MAX && status_of(s) == 0);
+}
+
+static void test_slicing(void){
+    static const char *k_cases[] = {
+        k_browser,
+        "GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n",
+        "HEAD /survey HTTP/1.0\n\n",
+        "GET / HTTP/1.1\r\nNoColon\r\n\r\n",
+        "GET /" "0123456789012345678901234567890123456789" " HTTP/1.1\r\n\r\n",
+    };
+    for(size_t i = 0; i < sizeof k_cases / sizeof k_cases[0]; i++) check_slicing(k_cases[i]);
+}
+
+static void test_pipelining(void){
+    char s[512];
+    int n1 = snprintf(s, sizeof s, "GET /oled.json HTTP/1.1\r\nConnection: keep-alive\r\n\r\n");
+    int n2 = snprintf(s + n1, sizeof s - n1, "HEAD /stats.json HTTP/1.1\r\n\r\nGET /");
+    http_req_t r;
+    http_req_reset(&r);
+    size_t u = http_req_feed(&r, s, (size_t)(n1 + n2));
+    CHECK(http_req_done(&r) && !r.err && u == (size_t)n1 && !strcmp(r.path, "/oled.json"));
+    http_req_reset(&r);
+    u += http_req_feed(&r, s + u, (size_t)(n1 + n2) - u);
+    CHECK(http_req_done(&r) && !r.err && r.method == HTTP_M_HEAD && !strcmp(r.path, "/stats.json"));
+    CHECK((size_t)(n1 + n2) - u == 5);   // "GET /" fica p/ o próximo
+}
+
+static void test_query(void){
+    http_req_t r = parse("GET /survey_submit?ans=1010101010&t=1234&color= HTTP/1.1\r\n\r\n", NULL);
+    char v[16];
+    CHECK(http_req_query(&r, "ans", v, sizeof v) && !strcmp(v, "1010101010"));
+    CHECK(http_req_query(&r, "t", v, sizeof v) && !strcmp(v, "1234"));
+    CHECK(!http_req_query(&r, "an", v, sizeof v) && !http_req_query(&r, "x", v, sizeof v));
+    CHECK(http_req_query(&r, "color", v, sizeof v) && !v[0]);
+    CHECK(http_req_query(&r, "ans", v, 5) && !strcmp(v, "1010"));
+}
+
+static void test_accept_encoding(void){
+    static const struct { const char *v; bool gz; } k_ae[] = {
+        { "", true }, { "gzip, deflate, br", true }, { "identity", false }, { "GZip", true },
+        { "deflate, gzip;q=0", false }, { "gzip;q=0.000", false }, { "gzip;q=0.5", true },
+        { "*", true }, { "*;q=0", false }, { "*;q=0, gzip", true }, { "gzip;q=0, *", false },
+        { "x-gzip", false }, { "br;q=1.0, gzip ; q=0.1", true }, { "gzip;level=1;q=0", false },
+        { "gzip;q=0.01", true },
+    };
+    for(size_t i = 0; i < sizeof k_ae / sizeof k_ae[0]; i++){
+        char s[128];
+        snprintf(s, sizeof s, "GET / HTTP/1.1\r\n%s%s%s\r\n", k_ae[i].v[0] ? "Accept-Encoding: " : "",
+                 k_ae[i].v, k_ae[i].v[0] ? "\r\n" : "");
+        http_req_t r = parse(s, NULL);
+        if(http_req_accepts_gzip(&r) != k_ae[i].gz){
+            fprintf(stderr, "Accept-Encoding \"%s\": esperado %d\n", k_ae[i].v, k_ae[i].gz);
+            g_fails++;
+        }
+    }
+}
+
+// ====== Fuzz ======
+static uint32_t s_rng = 20240611;
+static uint32_t rnd(void){ s_rng = s_rng*1664525u + 1013904223u; return s_rng >> 8; }
+
+static const char *const k_frag[] = {
+    "GET ", "HEAD ", "POST ", "/", "stats.json", "?", "color=", "verde", "&", " HTTP/1.1", " HTTP/1.0",
+    "\r\n", "\n", "\r", ":", " ", "\t", "Connection", "If-None-Match", "Sec-WebSocket-Key",
+    "Accept-Encoding", "gzip;q=0", "keep-alive", "\"st-1-9\"", "X-Long-Header-Name-That-Is-Not-Ours",
+    "dGhlIHNhbXBsZSBub25jZQ==dGhlIHNhbXBsZSBub25jZQ==",
+};
+#define N_FRAG (sizeof k_frag / sizeof k_frag[0])
+
+// metade: request válido com alguns bytes trocados/cortado; metade: fragmentos + lixo
+static size_t fuzz_input(char *buf, size_t cap){
+    size_t n = 0;
+    if(rnd() & 1){
+        n = strlen(k_browser);
+        memcpy(buf, k_browser, n);
+        for(int m = (int)(rnd() % 4); m > 0; m--) buf[rnd() % n] = (char)rnd();
+        if(rnd() % 4 == 0) n = rnd() % n;
+        return n;
+    }
+    int parts = (int)(rnd() % 200);
+    for(int j = 0; j < parts; j++){
+        if(rnd() % 5 == 0){ if(n < cap) buf[n++] = (char)rnd(); continue; }
+        const char *f = k_frag[rnd() % N_FRAG];
+        size_t l = strlen(f);
+        if(n + l > cap) break;
+        memcpy(buf + n, f, l);
+        n += l;
+    }
+    return n;
+}
+
+static void test_fuzz(int iters){
+    static char buf[3 * HTTP_REQ_MAX];
+    static guarded_t g, w;
+    int bad = 0, differ = 0;
+    long done = 0, errs = 0;
+    for(int it = 0; it < iters; it++){
+        size_t n = fuzz_input(buf, sizeof buf);
+        g_reset(&w);
+        size_t uw = feed(&w.r, buf, n, 0);
+        g_reset(&g);
+        size_t used = 0;
+        while(used < n && !http_req_done(&g.r)){
+            size_t c = 1 + rnd() % 64;
+            if(c > n - used) c = n - used;
+            size_t k = http_req_feed(&g.r, buf + used, c);
+            if(k > c) bad++;
+            used += k;
+            if(k < c) break;
+        }
+        if(!g_sane(&g) || !g_sane(&w)) bad++;
+        if(used != uw || memcmp(&g.r, &w.r, sizeof g.r)) differ++;
+        if(http_req_done(&g.r)){ done++; if(g.r.err) errs++; }
+    }
+    printf("fuzz: %d entradas, %ld completas (%ld com erro), %d fora dos limites, %d divergem do buffer inteiro\n",
+           iters, done, errs, bad, differ);
+    CHECK(bad == 0 && differ == 0);
+}
+
+// ====== Benchmark ======
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static volatile uint32_t s_sink;   // segura o resultado fora do otimizador
+
+static void bench(size_t step, int reqs){
+    const size_t n = strlen(k_browser);
+    http_req_t r;
+    double t0 = now_ns();
+    for(int i = 0; i < reqs; i++){
+        http_req_reset(&r);
+        feed(&r, k_browser, n, step);
+        s_sink += r.err + (uint8_t)r.path[1];
+    }
+    double dt = now_ns() - t0;
+    printf("request de %zu B em fatias de %4zu B: %7.1f ns/req, %8.0f req/s, %6.1f MB/s\n",
+           n, step ? step : n, dt / reqs, reqs / (dt * 1e-9), (double)n * reqs / (dt * 1e-3));
+}
+
+int main(int argc, char **argv){
+    bool full = argc > 1 && !strcmp(argv[1], "--bench");
+
+    test_valid();
+    test_malformed();
+    test_slicing();
+    test_pipelining();
+    test_query();
+    test_accept_encoding();
+    test_fuzz(full ? 200000 : 20000);
+
+    int reqs = full ? 1000000 : 20000;
+    bench(0, reqs);
+    bench(536, reqs);     // MSS mínimo
+    bench(1, reqs / 10);
+
+    if(!g_fails) printf("test_http_req: ok\n");
+    return g_fails ? 1 : 0;
+}
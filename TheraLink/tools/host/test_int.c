@@ -0,0 +1,95 @@
+// Modo INT + DMA do oximetro.c contra o MAX30102 simulado: o A_FULL desce o
+// INT, a IRQ do GPIO dispara a rajada DMA e o fim dela (DMA_IRQ_1) entrega
+// 17 amostras ao ring. As rajadas têm que seguir vindo sozinhas, sem o
+// watchdog, a 25/50/100 Hz e com o AGC mexendo nos LEDs no meio; sem
+// overflow da FIFO, ring cheio ou disputa do barramento. Com o INT solto o
+// watchdog drena por polling antes da FIFO (32 amostras) encher.
+//
+// Uso: test_int trace.csv
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "oximetro.h"
+#include "sim.h"
+#include "check.h"
+
+#define SDA_PIN  4
+#define SCL_PIN  5
+#define INT_PIN  6
+#define LOOP_MS  1          // laço do core 1
+#define TOL_BPM  3.0f
+
+static const sim_trace_t *s_tr;
+
+// roda o trace inteiro (sem parar no DONE: as rajadas seguem até o fim)
+static void run(const char *name, uint16_t sr, uint16_t pw, bool int_wired, uint8_t led_rec){
+    sim_trace_t tr = *s_tr;
+    tr.led_ir = tr.led_red = led_rec;          // gravação com outro LED: o AGC corrige
+    sim_max_attach(&tr);
+    sim_max_int_pin(int_wired ? INT_PIN : -1);
+    uint32_t conf0 = sim_i2c_conflicts();
+
+    oxi_config_t cfg = { sr, 8, pw };
+    CHECK(oxi_start(&cfg));
+    const uint64_t t0 = sim_now_us(), end = t0 + (uint64_t)(sim_trace_ms(&tr) - 500) * 1000;
+    float bpm = NAN;
+    while(sim_now_us() < end){
+        oxi_poll(to_ms_since_boot(get_absolute_time()));
+        if(oxi_get_state() == OXI_DONE && isnan(bpm)){
+            bpm = oxi_get_bpm_final();
+            CHECK(oxi_start(NULL));           // medição nova: segue nas rajadas
+        }
+        sim_advance_us(LOOP_MS * 1000);
+    }
+    oxi_timing_t tm;
+    oxi_get_timing(&tm);
+    oxi_agc_t agc;
+    oxi_get_agc(&agc);
+    uint32_t ovf = oxi_get_fifo_overflows(), conf = sim_i2c_conflicts() - conf0;
+    oxi_abort();
+
+    oxi_config_t c;
+    oxi_get_config(&c);
+    int fs = c.sample_rate_hz / c.avg;
+    uint32_t ms = tm.poll_calls * LOOP_MS;     // duração da 2ª medição
+    printf("%-22s %3d Hz: %4lu rajadas (%5lu amostras em %5lu ms), watchdog %lu, ovf %lu, ring %lu, "
+           "dma_err %lu, conflitos %lu, agc %u passos, bpm %.1f\n",
+           name, fs, (unsigned long)tm.batches, (unsigned long)tm.samples, (unsigned long)ms,
+           (unsigned long)tm.irq_fallbacks, (unsigned long)ovf, (unsigned long)tm.ring_drops,
+           (unsigned long)tm.dma_errors, (unsigned long)conf, agc.steps, bpm);
+
+    // a 2ª medição começa do zero: as contas valem a partir do oxi_start() dela
+    CHECK(tm.irq_mode);
+    CHECK(ovf == 0 && tm.ring_drops == 0 && tm.dma_errors == 0 && conf == 0);
+    CHECK(!isnan(bpm) && fabsf(bpm - tr.bpm) <= TOL_BPM);
+    if(int_wired){
+        CHECK(tm.irq_fallbacks == 0);
+        // só rajadas de 17: todas as amostras do período chegaram por DMA
+        CHECK(tm.samples == tm.batches * 17);
+        CHECK(tm.samples + 17 + 2 >= (uint32_t)((uint64_t)fs * tm.poll_calls * LOOP_MS / 1000));
+    }else{
+        CHECK(tm.irq_fallbacks > 0);
+    }
+}
+
+int main(int argc, char **argv){
+    if(argc != 2){ fprintf(stderr, "uso: test_int trace.csv\n"); return 2; }
+    sim_trace_t tr;
+    if(!sim_trace_load(&tr, argv[1])){ fprintf(stderr, "%s: trace invalido\n", argv[1]); return 2; }
+    s_tr = &tr;
+
+    CHECK(oxi_init(i2c0, SDA_PIN, SCL_PIN, NULL));
+    CHECK(oxi_enable_int(INT_PIN));
+
+    run("INT", 400, 411, true, tr.led_ir);
+    run("INT", 200, 411, true, tr.led_ir);
+    run("INT", 800, 215, true, tr.led_ir);
+    run("INT + AGC", 400, 411, true, 0x30);
+    run("INT + AGC", 800, 215, true, 0x30);
+    run("INT solto (watchdog)", 800, 215, false, tr.led_ir);
+    run("INT solto (watchdog)", 200, 411, false, tr.led_ir);
+
+    sim_trace_free(&tr);
+    if(!g_fails) printf("test_int: ok\n");
+    return g_fails ? 1 : 0;
+}
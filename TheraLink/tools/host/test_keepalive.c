@@ -0,0 +1,169 @@
+// HTTP/1.1 persistente no web_ap.c: várias respostas na mesma conexão,
+// Connection: close e HTTP/1.0 fecham, pipeline (vários requests no mesmo
+// segmento e request partido entre segmentos) respondido em ordem, e o
+// keep-alive parado fecha pelo tcp_poll. Depois o benchmark de requests/s:
+// conexão nova por request, keep-alive e pipeline de 8, por rota.
+//
+// No host o custo de abrir conexão é quase nada; o que pesa no AP é a ida e
+// volta (SYN + cada janela que precisa de ACK). Por isso sai também o nº de
+// idas e voltas por request e os requests/s que isso dá com um RTT de 30 ms.
+//
+// Uso: test_keepalive [--bench]   (--bench: mais requests por medida)
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "web_ap.h"
+#include "http_client.h"
+#include "check.h"
+
+#define RTT_MS  30.0       // Wi-Fi 2.4 GHz congestionado
+#define PIPE_N  8
+
+static http_client_t s_hc;
+static http_resp_t   s_resp;
+
+static int send_str(struct tcp_pcb *p, const char *s){ return sim_tcp_send(p, s, strlen(s)); }
+
+static void test_keepalive(void){
+    struct tcp_pcb *p = sim_tcp_connect();
+    CHECK(p != NULL);
+    if(!p) return;
+    for(int i = 0; i < 20; i++){
+        CHECK(hc_get(&s_hc, p, i & 1 ? "/oled.json" : "/stats.json", &s_resp) && s_resp.status == 200);
+        CHECK(strstr(s_resp.head, "\r\nConnection: keep-alive\r\n") != NULL);
+    }
+    CHECK(hc_get(&s_hc, p, "/", &s_resp) && s_resp.status == 200 && s_resp.body_len > 1000);
+    CHECK(sim_tcp_state(p) == SIM_TCP_OPEN);
+
+    // pipeline: 3 no mesmo segmento, respondidos em ordem
+    CHECK(send_str(p, "GET /oled.json HTTP/1.1\r\n\r\nGET /survey_state.json HTTP/1.1\r\n\r\n"
+                      "HEAD /stats.cbor HTTP/1.1\r\n\r\n") == 0);
+    CHECK(hc_read(&s_hc, p, false, &s_resp) && s_resp.status == 200 && strstr(s_resp.body, "\"l1\""));
+    CHECK(hc_read(&s_hc, p, false, &s_resp) && s_resp.status == 200 && strstr(s_resp.body, "\"mode\""));
+    CHECK(hc_read(&s_hc, p, true, &s_resp) && s_resp.status == 200 &&
+          strstr(s_resp.head, "\r\nContent-Type: application/cbor\r\n"));
+    CHECK(s_hc.len == 0 && sim_tcp_pending(p) == 0);
+
+    // request partido entre segmentos, o 2º colado no fim do 1º
+    CHECK(send_str(p, "GET /oled.js") == 0 && sim_tcp_pending(p) == 0);
+    CHECK(send_str(p, "on HTTP/1.1\r\nHost: x\r\n\r\nGET /survey_state") == 0);
+    CHECK(hc_read(&s_hc, p, false, &s_resp) && s_resp.status == 200 && strstr(s_resp.body, "\"l1\""));
+    CHECK(send_str(p, ".json HTTP/1.1\r\n\r\n") == 0);
+    CHECK(hc_read(&s_hc, p, false, &s_resp) && s_resp.status == 200 && strstr(s_resp.body, "\"mode\""));
+
+    // parado: o poll fecha (não no 1º tick)
+    sim_tcp_poll(p);
+    CHECK(sim_tcp_state(p) == SIM_TCP_OPEN);
+    for(int i = 0; i < 20 && sim_tcp_state(p) == SIM_TCP_OPEN; i++) sim_tcp_poll(p);
+    CHECK(sim_tcp_state(p) == SIM_TCP_CLOSED);
+    sim_tcp_free(p);
+    s_hc.len = 0;
+}
+
+static void test_close(void){
+    static const char *const k_req[] = {
+        "GET /oled.json HTTP/1.1\r\nConnection: close\r\n\r\n",
+        "GET /oled.json HTTP/1.0\r\n\r\n",
+        "GET /stats.json HTTP/1.0\r\n\r\n",         // HTTP/1.0: corpo cru até fechar
+    };
+    for(size_t i = 0; i < sizeof k_req / sizeof k_req[0]; i++){
+        struct tcp_pcb *p = sim_tcp_connect();
+        CHECK(p && send_str(p, k_req[i]) == 0);
+        CHECK(hc_read(&s_hc, p, false, &s_resp) && s_resp.status == 200 && s_resp.body[0] == '{');
+        CHECK(strstr(s_resp.head, "\r\nConnection: close\r\n") != NULL);
+        CHECK(sim_tcp_state(p) == SIM_TCP_CLOSED);
+        sim_tcp_free(p);
+        s_hc.len = 0;
+    }
+}
+
+// ====== Benchmark ======
+typedef struct { double ns; uint32_t rtts; int reqs; } run_t;
+
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static char s_req[PIPE_N * 128];
+
+static int make_req(char *out, size_t cap, const char *path, bool close){
+    return snprintf(out, cap, "GET %s HTTP/1.1\r\nHost: 192.168.4.1\r\nAccept-Encoding: gzip\r\n%s\r\n",
+                    path, close ? "Connection: close\r\n" : "");
+}
+
+// conexão nova por request: SYN/SYN-ACK conta 1 ida e volta
+static run_t run_close(const char *path, int n){
+    run_t r = { 0, 0, 0 };
+    int len = make_req(s_req, sizeof s_req, path, true);
+    double t0 = now_ns();
+    for(int i = 0; i < n; i++){
+        struct tcp_pcb *p = sim_tcp_connect();
+        s_hc.len = 0; s_hc.rtts = 0;
+        if(!p || sim_tcp_send(p, s_req, (size_t)len) != 0 || !hc_read(&s_hc, p, false, &s_resp) ||
+           s_resp.status != 200 || sim_tcp_state(p) != SIM_TCP_CLOSED){ g_fails++; break; }
+        sim_tcp_free(p);
+        r.rtts += 1 + s_hc.rtts;
+        r.reqs++;
+    }
+    r.ns = now_ns() - t0;
+    return r;
+}
+
+// uma conexão; batch requests por segmento (1 = keep-alive sem pipeline)
+static run_t run_keep(const char *path, int n, int batch){
+    run_t r = { 0, 1, 0 };
+    int len = 0;
+    for(int k = 0; k < batch; k++) len += make_req(s_req + len, sizeof s_req - len, path, false);
+    struct tcp_pcb *p = sim_tcp_connect();
+    s_hc.len = 0; s_hc.rtts = 0;
+    double t0 = now_ns();
+    for(int i = 0; p && i < n; i += batch){
+        if(sim_tcp_send(p, s_req, (size_t)len) != 0){ g_fails++; break; }
+        for(int k = 0; k < batch; k++){
+            if(!hc_read(&s_hc, p, false, &s_resp) || s_resp.status != 200){ g_fails++; goto out; }
+            r.reqs++;
+        }
+    }
+out:
+    r.ns = now_ns() - t0;
+    r.rtts += s_hc.rtts;
+    if(p){ CHECK(sim_tcp_state(p) == SIM_TCP_OPEN); sim_tcp_fin(p); sim_tcp_free(p); }
+    return r;
+}
+
+static void report(const char *path, const char *mode, run_t r){
+    if(!r.reqs) return;
+    double rtt_req = (double)r.rtts / r.reqs;
+    printf("%-12s %-16s %8.2f us/req %9.0f req/s (host) %5.2f RTT/req %6.1f req/s @%.0f ms\n",
+           path, mode, r.ns * 1e-3 / r.reqs, r.reqs / (r.ns * 1e-9), rtt_req, 1000.0 / (rtt_req * RTT_MS), RTT_MS);
+}
+
+static void bench(int n){
+    static const char *const k_paths[] = { "/oled.json", "/stats.json", "/" };
+    for(size_t i = 0; i < sizeof k_paths / sizeof k_paths[0]; i++){
+        const char *path = k_paths[i];
+        run_t c = run_close(path, n), k = run_keep(path, n, 1), pl = run_keep(path, n, PIPE_N);
+        report(path, "close", c);
+        report(path, "keep-alive", k);
+        report(path, "pipeline x8", pl);
+        CHECK(c.reqs == n && k.reqs == n && pl.reqs >= n);
+        CHECK(k.rtts < c.rtts && pl.rtts <= k.rtts);
+    }
+}
+
+int main(int argc, char **argv){
+    bool full = argc > 1 && !strcmp(argv[1], "--bench");
+
+    web_ap_start();
+    web_display_set_lines("TheraLink", "Pronto", "", "");
+    test_keepalive();
+    test_close();
+    bench(full ? 20000 : 400);
+    CHECK(sim_net_misuse() == 0);
+
+    if(!g_fails) printf("test_keepalive: ok\n");
+    return g_fails ? 1 : 0;
+}
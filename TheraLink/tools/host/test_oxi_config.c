@@ -0,0 +1,62 @@
+// /oxi_config pelo web_ap.c: sem query mostra a config em uso (vinda do
+// status do core 1) e nada pendente; com query o pedido fica pendente até o
+// laço principal consumir (uma vez só, como o main.c faz antes do
+// oxi_core1_configure); valor não numérico ou fora da faixa => 400 e nada
+// muda; só GET.
+#include <stdio.h>
+#include <string.h>
+#include "web_ap.h"
+#include "http_client.h"
+#include "check.h"
+
+static http_client_t s_hc;
+static http_resp_t   s_resp;
+
+static bool get(struct tcp_pcb *p, const char *path, int status){
+    return hc_get(&s_hc, p, path, &s_resp) && s_resp.status == status;
+}
+
+int main(void){
+    web_ap_start();
+    struct tcp_pcb *p = sim_tcp_connect();
+    CHECK(p != NULL);
+    if(!p) return 1;
+    uint16_t sr, pw; uint8_t avg;
+
+    // antes de detectar o sensor: tudo 0
+    CHECK(get(p, "/oxi_config", 200));
+    CHECK(!strcmp(s_resp.body, "{\"sr\":0,\"avg\":0,\"pw\":0,\"fs\":0,\"pending\":null}"));
+    CHECK(strstr(s_resp.head, "\r\nContent-Type: application/json") != NULL);
+    CHECK(!web_take_oxi_config(&sr, &avg, &pw));
+
+    web_set_oxi_config(400, 8, 411);
+    CHECK(get(p, "/oxi_config", 200));
+    CHECK(!strcmp(s_resp.body, "{\"sr\":400,\"avg\":8,\"pw\":411,\"fs\":50,\"pending\":null}"));
+
+    // pedido: pendente até consumir; campo ausente = 0 (padrão do sensor)
+    CHECK(get(p, "/oxi_config?sr=800&avg=8&pw=215", 200));
+    CHECK(!strcmp(s_resp.body, "{\"sr\":400,\"avg\":8,\"pw\":411,\"fs\":50,"
+                               "\"pending\":{\"sr\":800,\"avg\":8,\"pw\":215}}"));
+    CHECK(get(p, "/oxi_config?sr=200", 200) && strstr(s_resp.body, "\"pending\":{\"sr\":200,\"avg\":0,\"pw\":0}"));
+    CHECK(web_take_oxi_config(&sr, &avg, &pw) && sr == 200 && avg == 0 && pw == 0);
+    CHECK(!web_take_oxi_config(&sr, &avg, &pw));
+    web_set_oxi_config(200, 8, 411);
+    CHECK(get(p, "/oxi_config", 200) && strstr(s_resp.body, "\"fs\":25,\"pending\":null"));
+
+    // inválidos: 400 e nada pendente
+    static const char *const k_bad[] = {
+        "/oxi_config?sr=abc", "/oxi_config?sr=", "/oxi_config?sr=800&avg=8x",
+        "/oxi_config?pw=99999", "/oxi_config?avg=64", "/oxi_config?sr=-1",
+    };
+    for(size_t i = 0; i < sizeof k_bad / sizeof k_bad[0]; i++){
+        if(!get(p, k_bad[i], 400)) fprintf(stderr, "  %s: %d\n", k_bad[i], s_resp.status), g_fails++;
+    }
+    CHECK(!web_take_oxi_config(&sr, &avg, &pw));
+
+    CHECK(sim_tcp_send(p, "HEAD /oxi_config HTTP/1.1\r\n\r\n", 29) == 0);
+    CHECK(hc_read(&s_hc, p, true, &s_resp) && s_resp.status == 405);
+    CHECK(sim_tcp_state(p) == SIM_TCP_OPEN && sim_net_misuse() == 0);
+
+    if(!g_fails) printf("test_oxi_config: ok\n");
+    return g_fails ? 1 : 0;
+}
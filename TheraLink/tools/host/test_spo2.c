@@ -0,0 +1,48 @@
+// SpO2 por batimento (spo2_push/spo2_beat do oximetro.c): perfusão baixa
+// não pode virar leitura, perfusão normal dá a SpO2 da razão R.
+#include "oximetro.c"
+#include "check.h"
+
+#define FS 50
+
+// n batimentos de 60 bpm (1 por segmento), PI = AC/DC pico a pico, R = PI red / PI ir
+static void feed(float pi_ir, float r, int beats){
+    for(int i = 0; i < beats * FS; i++){
+        double w = sin(2.0 * 3.14159265358979 * i / FS);
+        int32_t ir  = (int32_t)lround(100000.0 - 0.5 * pi_ir * 100000.0 * w);
+        int32_t red = (int32_t)lround( 80000.0 - 0.5 * r * pi_ir * 80000.0 * w);
+        spo2_push(ir, red);
+    }
+}
+
+static void setup(void){
+    fs_hz = FS;
+    spo2_reset();
+    sp_seg_len = FS;
+}
+
+int main(void){
+    bool good;
+
+    // perfusão abaixo de SPO2_PI_MIN (0.1%): nenhum batimento aceito
+    setup();
+    feed(0.0004f, 0.5f, 12);
+    CHECK(isnan(oxi_get_spo2_live(&good)));
+    CHECK(!good);
+    CHECK(sp_good == 0);
+
+    // perfusão normal (2%), R = 0.5 => 110 - 25*0.5 = 97.5%
+    setup();
+    feed(0.02f, 0.5f, 12);
+    float v = oxi_get_spo2_live(&good);
+    CHECK(!isnan(v) && fabsf(v - 97.5f) < 1.0f);
+    CHECK(good);
+
+    // logo acima do limiar ainda passa
+    setup();
+    feed(0.0015f, 0.5f, 12);
+    CHECK(!isnan(oxi_get_spo2_live(NULL)));
+
+    if(!g_fails) printf("test_spo2: ok\n");
+    return g_fails ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+// WebSocket (/ws): chave do handshake contra o exemplo da RFC 6455, cabeçalho
+// de frame do servidor e o caminho inteiro pelo web_ap.c sobre o lwIP
+// simulado: handshake incompleto -> 400, versão != 13 -> 426 com a versão
+// suportada, Connection em lista ("keep-alive, Upgrade") aceito; 101 +
+// estado inicial, submit -> ack, ping -> pong, resposta
+// inválida -> err, frames partidos/juntos no mesmo segmento, frame sem
+// máscara -> close 1002 e close ecoado.
+#define _GNU_SOURCE      // memmem
+#include <stdio.h>
+#include <string.h>
+#include "ws.h"
+#include "web_ap.h"
+#include "sim.h"
+#include "check.h"
+
+static const char k_upgrade[] =
+    "GET /ws HTTP/1.1\r\nHost: 192.168.4.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+typedef struct { uint8_t op; size_t len; const char *pl; } frame_t;
+
+static char   s_out[16384];
+static size_t s_out_len;
+
+// pega tudo que o servidor escreveu e confirma (janela volta)
+static const char *drain(struct tcp_pcb *p){
+    s_out_len = sim_tcp_take(p, s_out, sizeof s_out - 1);
+    s_out[s_out_len] = '\0';
+    sim_tcp_ack(p);
+    return s_out;
+}
+
+// frames do servidor (sem máscara) a partir de 'at'; devolve quantos
+static int frames(size_t at, frame_t *f, int max){
+    int n = 0;
+    while(at + 2 <= s_out_len && n < max){
+        const uint8_t *b = (const uint8_t *)s_out + at;
+        size_t len = b[1] & 0x7F, h = 2;
+        if(len == 126){ len = (size_t)b[2] << 8 | b[3]; h = 4; }
+        if(!(b[0] & 0x80) || (b[1] & 0x80) || at + h + len > s_out_len) break;
+        f[n].op = b[0] & 0x0F; f[n].len = len; f[n].pl = s_out + at + h;
+        n++;
+        at += h + len;
+    }
+    return n;
+}
+
+static bool has_text(const frame_t *f, int n, const char *s){
+    for(int i = 0; i < n; i++)
+        if(f[i].op == WS_OP_TEXT && memmem(f[i].pl, f[i].len, s, strlen(s))) return true;
+    return false;
+}
+
+// frame do cliente (mascarado, FIN)
+static size_t client_frame(uint8_t *b, uint8_t op, const void *pl, size_t len){
+    static const uint8_t m[4] = { 0x37, 0xfa, 0x21, 0x3d };
+    b[0] = 0x80 | op;
+    b[1] = 0x80 | (uint8_t)len;
+    memcpy(b + 2, m, 4);
+    for(size_t i = 0; i < len; i++) b[6 + i] = ((const uint8_t *)pl)[i] ^ m[i & 3];
+    return 6 + len;
+}
+
+static int send_frame(struct tcp_pcb *p, uint8_t op, const char *s){
+    uint8_t b[6 + 125];
+    return sim_tcp_send(p, b, client_frame(b, op, s, strlen(s)));
+}
+
+// conecta e faz o handshake; s_out fica só com os frames iniciais
+static struct tcp_pcb *ws_open(void){
+    struct tcp_pcb *p = sim_tcp_connect();
+    CHECK(p && sim_tcp_send(p, k_upgrade, sizeof k_upgrade - 1) == 0);
+    drain(p);
+    return p;
+}
+
+static void test_accept_key(void){
+    char acc[WS_ACCEPT_LEN + 1];
+    ws_accept_key("dGhlIHNhbXBsZSBub25jZQ==", acc);   // RFC 6455, 1.3
+    CHECK(!strcmp(acc, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo="));
+    ws_accept_key("x3JJHMbDL1EzLkh9GBhXDw==", acc);
+    CHECK(!strcmp(acc, "HSmrc0sMlYUkAGmm5OPpG2HaGWk="));
+}
+
+static void test_frame_header(void){
+    uint8_t h[4];
+    CHECK(ws_frame_header(h, WS_OP_TEXT, 0) == 2 && h[0] == 0x81 && h[1] == 0);
+    CHECK(ws_frame_header(h, WS_OP_PONG, 125) == 2 && h[0] == 0x8A && h[1] == 125);
+    CHECK(ws_frame_header(h, WS_OP_BIN, 126) == 4 && h[0] == 0x82 && h[1] == 126 && h[2] == 0 && h[3] == 126);
+    CHECK(ws_frame_header(h, WS_OP_TEXT, 1000) == 4 && h[1] == 126 && h[2] == 0x03 && h[3] == 0xE8);
+}
+
+// handshake: resposta do servidor a um GET /ws com os cabeçalhos dados
+static const char *handshake(const char *hdrs){
+    char req[512];
+    snprintf(req, sizeof req, "GET /ws HTTP/1.1\r\nHost: 192.168.4.1\r\n%s\r\n", hdrs);
+    struct tcp_pcb *p = sim_tcp_connect();
+    CHECK(p && sim_tcp_send(p, req, strlen(req)) == 0);
+    drain(p);
+    if(p && !strncmp(s_out, "HTTP/1.1 101 ", 13)){
+        const char code[2] = { 0x03, (char)0xE8 };
+        uint8_t cl[8];
+        sim_tcp_send(p, cl, client_frame(cl, WS_OP_CLOSE, code, 2));
+    }else CHECK(!p || sim_tcp_state(p) != SIM_TCP_OPEN);   // recusa fecha
+    sim_tcp_free(p);
+    return s_out;
+}
+
+static void test_handshake(void){
+#define KEY "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+#define V13 "Sec-WebSocket-Version: 13\r\n"
+    static const char *const k_bad[] = {
+        KEY V13,                                                        // sem Upgrade/Connection
+        "Connection: Upgrade\r\n" KEY V13,                              // sem Upgrade
+        "Upgrade: websocket\r\n" KEY V13,                               // sem Connection
+        "Upgrade: websocket\r\nConnection: keep-alive\r\n" KEY V13,     // Connection sem upgrade
+        "Upgrade: h2c\r\nConnection: Upgrade\r\n" KEY V13,              // outro protocolo
+        "Upgrade: websocket\r\nConnection: Upgrade\r\n" V13,            // sem chave
+        "Upgrade: websocketx\r\nConnection: Upgrades\r\n" KEY V13,      // token, não prefixo
+    };
+    for(size_t i = 0; i < sizeof k_bad / sizeof k_bad[0]; i++){
+        if(strncmp(handshake(k_bad[i]), "HTTP/1.1 400 ", 13)){
+            fprintf(stderr, "  handshake %zu: %.40s\n", i, s_out);
+            g_fails++;
+        }
+    }
+    static const char *const k_ver[] = {
+        "Upgrade: websocket\r\nConnection: Upgrade\r\n" KEY,                              // sem versão
+        "Upgrade: websocket\r\nConnection: Upgrade\r\n" KEY "Sec-WebSocket-Version: 8\r\n",
+        "Upgrade: websocket\r\nConnection: Upgrade\r\n" KEY "Sec-WebSocket-Version: 130\r\n",
+    };
+    for(size_t i = 0; i < sizeof k_ver / sizeof k_ver[0]; i++){
+        handshake(k_ver[i]);
+        CHECK(!strncmp(s_out, "HTTP/1.1 426 ", 13) && strstr(s_out, "\r\nSec-WebSocket-Version: 13\r\n"));
+    }
+    // como o Firefox manda; caixa e espaços não importam
+    CHECK(!strncmp(handshake("Upgrade: websocket\r\nConnection: keep-alive, Upgrade\r\n" KEY V13),
+                   "HTTP/1.1 101 ", 13));
+    CHECK(!strncmp(handshake("upgrade: WebSocket\r\nconnection:upgrade \r\n" KEY "sec-websocket-version: 13\r\n"),
+                   "HTTP/1.1 101 ", 13));
+#undef KEY
+#undef V13
+}
+
+static void test_session(void){
+    frame_t f[16];
+    int n;
+
+    struct tcp_pcb *a = sim_tcp_connect();
+    CHECK(a && sim_tcp_send(a, k_upgrade, sizeof k_upgrade - 1) == 0);
+    drain(a);
+    CHECK(!strncmp(s_out, "HTTP/1.1 101 ", 13));
+    CHECK(strstr(s_out, "\r\nSec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != NULL);
+    const char *eoh = strstr(s_out, "\r\n\r\n");
+    CHECK(eoh != NULL);
+    if(!eoh) return;
+    n = frames((size_t)(eoh + 4 - s_out), f, 16);
+    CHECK(has_text(f, n, "\"t\":\"mode\",\"mode\":1"));
+    CHECK(has_text(f, n, "\"t\":\"oled\",\"l1\":\"Responda no painel\""));
+
+    // submit -> ack com o token que o core 0 vê
+    CHECK(send_frame(a, WS_OP_TEXT, "ans=1010101010") == 0);
+    drain(a);
+    n = frames(0, f, 16);
+    uint16_t bits; uint32_t tok;
+    CHECK(web_survey_peek(&bits, &tok));
+    char ack[48];
+    snprintf(ack, sizeof ack, "{\"t\":\"ack\",\"token\":%lu}", (unsigned long)tok);
+    CHECK(has_text(f, n, ack));
+
+    CHECK(send_frame(a, WS_OP_PING, "hi") == 0);
+    drain(a);
+    n = frames(0, f, 16);
+    CHECK(n == 1 && f[0].op == WS_OP_PONG && f[0].len == 2 && !memcmp(f[0].pl, "hi", 2));
+
+    CHECK(send_frame(a, WS_OP_TEXT, "ans=xyz") == 0);
+    drain(a);
+    n = frames(0, f, 16);
+    CHECK(n == 1 && has_text(f, n, "{\"t\":\"err\"}"));
+
+    // OLED mudou: push p/ quem está aberto
+    web_display_set_lines("Recomendacao:", "Pegue a pulseira", "Amarelo", "");
+    drain(a);
+    n = frames(0, f, 16);
+    CHECK(has_text(f, n, "\"l3\":\"Amarelo\""));
+
+    // 2a conexão: um frame partido em dois segmentos + dois frames no mesmo segmento
+    struct tcp_pcb *b = ws_open();
+    uint8_t buf[64];
+    size_t l1 = client_frame(buf, WS_OP_PING, "p1", 2);
+    size_t l2 = client_frame(buf + l1, WS_OP_PING, "p2", 2);
+    size_t l3 = client_frame(buf + l1 + l2, WS_OP_PING, "p3", 2);
+    CHECK(sim_tcp_send(b, buf, 3) == 0);
+    CHECK(sim_tcp_pending(b) == 0);
+    CHECK(sim_tcp_send(b, buf + 3, l1 + l2 + l3 - 3) == 0);
+    drain(b);
+    n = frames(0, f, 16);
+    CHECK(n == 3);
+    for(int i = 0; i < n && i < 3; i++){
+        char want[3] = { 'p', (char)('1' + i), 0 };
+        CHECK(f[i].op == WS_OP_PONG && f[i].len == 2 && !memcmp(f[i].pl, want, 2));
+    }
+
+    // sem máscara: close 1002 e fecha
+    const uint8_t unmasked[3] = { 0x81, 0x01, 'a' };
+    sim_tcp_send(b, unmasked, sizeof unmasked);
+    drain(b);
+    n = frames(0, f, 16);
+    CHECK(n == 1 && f[0].op == WS_OP_CLOSE && f[0].len == 2 && (uint8_t)f[0].pl[0] == 0x03 && (uint8_t)f[0].pl[1] == 0xEA);
+    CHECK(sim_tcp_state(b) != SIM_TCP_OPEN);
+
+    // close do cliente: eco do código e fecha
+    const char code[2] = { 0x03, (char)0xE8 };
+    uint8_t cl[8];
+    sim_tcp_send(a, cl, client_frame(cl, WS_OP_CLOSE, code, 2));
+    drain(a);
+    n = frames(0, f, 16);
+    CHECK(n == 1 && f[0].op == WS_OP_CLOSE && f[0].len == 2 && !memcmp(f[0].pl, code, 2));
+    CHECK(sim_tcp_state(a) == SIM_TCP_CLOSED);
+
+    sim_tcp_free(a);
+    sim_tcp_free(b);
+}
+
+int main(void){
+    test_accept_key();
+    test_frame_header();
+
+    web_ap_start();
+    web_display_set_lines("Responda no painel", "Abrir /survey", "[SURVEY]", "");
+    web_set_survey_mode(true);
+    test_handshake();
+    test_session();
+    CHECK(sim_net_misuse() == 0);
+
+    if(!g_fails) printf("test_ws: ok\n");
+    return g_fails ? 1 : 0;
+}